@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+
+/*
+  Compressed ROMs: gzip files and zip archives (stored or deflate entries).
+
+  read_file() hands anything named .gz / .zip with the matching signature to
+  extract_rom(), which inflates the ROM straight into a buffer sized from the
+  archive's own length field -- and never grown past it -- and checks it against
+  the archive's CRC-32. In a zip the first .gb / .gbc entry is the one loaded.
+
+  inflate() is a plain RFC 1951 decoder: a bit buffer refilled 8 bytes at a time and
+  Huffman tables resolving codes of up to 10 bits in a single lookup -- longer
+  codes, which are rare, fall back to walking the canonical code bit by bit.
+*/
+namespace Umibozu::Archive {
+  enum class FORMAT : u8 { NONE, GZIP, ZIP };
+
+  [[nodiscard]] FORMAT detect(std::string_view path, std::span<const u8> bytes);
+
+  // the ROM inside `archive`; throws std::runtime_error on damaged archives, CRC
+  // mismatches and zips without a .gb / .gbc entry
+  [[nodiscard]] std::vector<u8> extract_rom(std::span<const u8> archive, FORMAT format, std::string* entry_name = nullptr);
+
+  // largest cartridge ROM (512 banks); archives declaring more are rejected before inflating
+  inline constexpr size_t MAX_ROM_SIZE = 0x800000;
+
+  // raw DEFLATE stream; output past `limit` bytes -- the size the archive declares --
+  // throws as soon as it is produced
+  [[nodiscard]] std::vector<u8> inflate(std::span<const u8> deflate, size_t limit = SIZE_MAX);
+}  // namespace Umibozu::Archive
@@ -5,10 +5,16 @@ struct APU;
 #include "common.hpp"
 #include "io_defs.hpp"
 #include "joypad.hpp"
+#include "dirty.hpp"
 #include "ppu.hpp"
+#include "provenance.hpp"
+#include "telemetry.hpp"
 struct Timer;
 #include "timer.hpp"
 struct PPU;
+struct CartMapper;
+struct CheatEngine;
+struct SaveFlusher;
 #include "mapper.hpp"
 #include "ppu.hpp"
 
@@ -24,6 +30,14 @@ enum class INTERRUPT_TYPE : u8 {
 
 enum class SYSTEM_MODE : u8 { DMG, CGB = 0xC0 };
 
+// Slow-path handlers for pages that can't be served by a direct load/store
+enum class PAGE_HANDLER : u8 {
+  UNMAPPED,  // open bus
+  MAPPER,    // MBC registers, disabled cart RAM, RTC
+  OAM,       // 0xFE00 - 0xFEFF: OAM + unusable area
+  HIGH,      // 0xFF00 - 0xFFFF: IO, HRAM, IE
+};
+
 union PaletteSpecification {
   u8 v;
   struct {
@@ -37,11 +51,13 @@ struct Bus {
   SYSTEM_MODE mode = SYSTEM_MODE::DMG;
 
   Joypad joypad;
-  Cartridge* cart = nullptr;
-  PPU* ppu        = nullptr;
-  Timer* timer    = nullptr;
-  Mapper* mapper  = nullptr;
-  APU* apu        = nullptr;
+  Cartridge* cart     = nullptr;
+  PPU* ppu            = nullptr;
+  Timer* timer        = nullptr;
+  CartMapper* mapper  = nullptr;
+  APU* apu            = nullptr;
+  CheatEngine* cheats = nullptr;
+  SaveFlusher* saver  = nullptr;
   // WRAM Bank
   u8 svbk = 0;
 
@@ -50,6 +66,12 @@ struct Bus {
 
   bool cpu_is_halted = false;
 
+  // M-cycles left in the running OAM DMA -- the CPU only reaches 0xFF00 - 0xFFFF meanwhile
+  u8 oam_dma_cycles = 0;
+
+  // M-cycles the CPU is held for by VRAM DMA blocks, paid before the next instruction
+  u16 dma_stall_cycles = 0;
+
   // BCPS
   PaletteSpecification bcps = {};
   PaletteSpecification ocps = {};
@@ -66,7 +88,7 @@ struct Bus {
   std::array<u8, 0x40> bg_palette_ram;
   std::array<u8, 0x40> obj_palette_ram;
 
-  bool hidden_stat = should_raise_mode_0() || should_raise_mode_1() || should_raise_mode_2() || should_raise_ly_lyc();
+  bool hidden_stat = false;  // recomputed by update_hidden_stat(), `ppu` and `io` are not set up yet here
 
   void update_hidden_stat() { hidden_stat = should_raise_mode_0() || should_raise_mode_1() || should_raise_mode_2() || should_raise_ly_lyc(); }
 
@@ -88,13 +110,88 @@ struct Bus {
 
   [[nodiscard]] std::string get_label(u16 addr);
 
-  u8 read8(const u16 address);
-  void write8(const u16 address, const u8 value);
+  // Memory map -- one entry per 256-byte page of the address space. A page either
+  // points straight at its current backing memory or is nullptr, in which case
+  // the access goes through the page's handler slot.
+  std::array<u8*, 0x100> read_page              = {};
+  std::array<u8*, 0x100> write_page             = {};
+  std::array<PAGE_HANDLER, 0x100> read_handler  = {};
+  std::array<PAGE_HANDLER, 0x100> write_handler = {};
+
+  void map_read(u16 address, u32 length, u8* memory, PAGE_HANDLER fallback = PAGE_HANDLER::UNMAPPED);
+  void map_write(u16 address, u32 length, u8* memory, PAGE_HANDLER fallback = PAGE_HANDLER::UNMAPPED);
+
+  void map_vram();
+  void map_wram();
+
+  // Watched RAM pages are moved from write_page to traced_page, so their stores take
+  // the slow path: every store while the region's write provenance is enabled, and
+  // the first store per dirty generation otherwise.
+  WriteProvenance provenance;
+  DirtyTracker dirty;
+  std::array<u8*, 0x100> traced_page = {};
+
+  void set_provenance(SHADOW_REGION region, bool enabled);
+  void record_write(SHADOW_REGION region, size_t offset);
+
+  // closes the running dirty generation, see dirty.hpp
+  u64 dirty_checkpoint();
+
+  [[nodiscard]] static SHADOW_REGION shadow_region(u16 address);
+  [[nodiscard]] static DIRTY_REGION dirty_region(SHADOW_REGION region) {
+    return region == SHADOW_REGION::VRAM ? DIRTY_REGION::VRAM : region == SHADOW_REGION::WRAM ? DIRTY_REGION::WRAM : DIRTY_REGION::EXT_RAM;
+  }
+  [[nodiscard]] size_t backing_offset(SHADOW_REGION region, const u8* backing) const;
+  void route_write_page(u8 page);
+
+  // per-page access and bank-switch counters, see telemetry.hpp
+  MemoryTelemetry telemetry;
+
+  u8 read8(const u16 address) {
+#ifdef UMIBOZU_TELEMETRY
+    if (telemetry.enabled) [[unlikely]] telemetry.count_read(address);
+#endif
+    if (const u8* page = read_page[address >> 8]) [[likely]] {
+      return page[address & 0xFF];
+    }
+    return read_slow(address);
+  }
+
+  void write8(const u16 address, const u8 value) {
+#ifdef UMIBOZU_TELEMETRY
+    if (telemetry.enabled) [[unlikely]] telemetry.count_write(address);
+#endif
+    if (u8* page = write_page[address >> 8]) [[likely]] {
+      page[address & 0xFF] = value;
+      return;
+    }
+    write_slow(address, value);
+  }
+
+  u8 read_slow(const u16 address);
+  void write_slow(const u16 address, const u8 value);
+
+  // IO registers -- one handler per register, indexed by the low address byte
+  // (0x00 - 0x7F, IE at 0xFF). A nullptr slot is plain storage in `io`. The tables
+  // are rebuilt by reset() for the current mode, so CGB-only registers on DMG are
+  // constant open-bus / ignored handlers instead of mode checks on every access.
+  using IoRead  = u8 (*)(Bus&, u8 reg);
+  using IoWrite = void (*)(Bus&, u8 reg, u8 value);
+
+  std::array<IoRead, 0x100> io_read_table   = {};
+  std::array<IoWrite, 0x100> io_write_table = {};
+
+  void init_io_handlers();
 
   u8 io_read(const u16 address);
   void io_write(const u16 address, const u8 value);
 
+  void start_oam_dma(u8 source_page);
   void init_hdma(u16 length);
+  // HBlank entry: copy the next HDMA block if a transfer is running
+  void hdma_hblank();
+  // copy one 16-byte block HDMA1/2 -> VRAM HDMA3/4, returns whether blocks remain
+  bool vram_dma_block();
   void terminate_hdma();
   void reset();
 
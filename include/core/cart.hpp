@@ -3,12 +3,15 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
 #include "common.hpp"
+#include "io.hpp"
 namespace Umibozu {
   class Cartridge {
    private:
-    std::string get_title(std::span<const u8>) const;
-    
+    static std::string get_title(std::span<const u8>);
+
+   public:
     struct Info {
       std::string title;
       std::string mapper_string;
@@ -17,15 +20,35 @@ namespace Umibozu {
       u16 rom_banks;
       u16 ram_banks;
       u8 destination_code;
+      u8 cgb_flag;
     };
 
-   public:
+    // header fields of an image at least 0x150 bytes long; `path` is left empty
+    static Info parse_header(std::span<const u8> image);
+
     void print_cart_info();
     void set_cart_info();
-    std::vector<u8> memory;
-    std::array<u8, 0x100000> ext_ram;
+    // the ROM image -- a read-only view into `image`, which is usually an mmap of the file
+    std::span<const u8> memory;
+    std::shared_ptr<const MappedFile> image;
+    std::string patch_path;  // IPS / BPS / UPS applied on top of info.path, empty if none
+    // cartridge RAM as the header sizes it -- 512 bytes on MBC2, empty when there is none.
+    // Backed by `ext_ram_buffer`, or by `ext_ram_mapping` when the .sav is mapped.
+    std::span<u8> ext_ram;
+    // the 48-byte clock footer stored right after the RAM on carts with an RTC
+    std::span<u8> rtc_footer;
+    // ext_ram followed by rtc_footer, i.e. the .sav file's contents
+    std::span<u8> save_image;
+    std::vector<u8> ext_ram_buffer;
+    std::unique_ptr<SharedMapping> ext_ram_mapping;
     Info info;
 
+    [[nodiscard]] size_t ext_ram_size() const;
+    // RAM plus the RTC footer
+    [[nodiscard]] size_t save_size() const;
+    [[nodiscard]] bool has_battery() const;
+    [[nodiscard]] bool has_rtc() const;
+
     u8 read8(u64);
   };
 } 
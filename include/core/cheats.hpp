@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+
+struct Bus;
+
+/*
+  Game Genie and GameShark codes.
+
+  Game Genie (ABC-DEF-GHI, or ABC-DEF without a compare) patches ROM. When a
+  bank window is mapped, every 256-byte page holding an active patch whose
+  compare byte matches the bank is copied into an overlay buffer and the copy is
+  mapped in its place -- reads stay on the page-table fast path either way.
+
+  GameShark (TTVVAAAA: type, value, little-endian address) writes RAM once per
+  frame, from PPU::set_ppu_mode(VBLANK). Type 9X targets WRAM bank X on CGB.
+
+  Codes are loaded from cheats/<title>.cht, one per line: "<code> [name]", a
+  leading '-' marks the code disabled, '#' starts a comment line.
+*/
+struct Cheat {
+  enum class TYPE : u8 { GAME_GENIE, GAMESHARK };
+
+  TYPE type = TYPE::GAME_GENIE;
+  std::string code;
+  std::string name;
+  bool enabled = true;
+
+  u16 address = 0;
+  u8 value    = 0;
+  std::optional<u8> compare;  // Game Genie: only patch banks holding this byte
+  u8 gs_type = 0;             // GameShark: 0x01 plain write, 0x9X WRAM bank X
+
+  [[nodiscard]] static std::optional<Cheat> parse(std::string_view code);
+};
+
+struct CheatEngine {
+  std::vector<Cheat> cheats;
+  std::string path;
+
+  // replaces every code with the contents of `path`; a missing file means no codes
+  void load(const std::string& path);
+  bool save() const;
+
+  bool add(std::string_view code, std::string_view name = {});
+  void remove(size_t index);
+
+  // call after codes were added, removed or toggled: re-maps both ROM windows
+  void apply_rom(Bus& bus);
+
+  // Mapper::map_rom hook -- overlay patched pages of the window just mapped
+  void overlay_rom(Bus& bus, u16 window_address, const u8* window);
+
+  // VBlank hook -- GameShark writes
+  void apply_ram(Bus& bus) const;
+
+  [[nodiscard]] bool has_rom_patches() const { return rom_patches; }
+
+ private:
+  bool rom_patches = false;
+
+  // one overlay page per ROM page (0x0000 - 0x7FFF)
+  std::array<std::array<u8, 0x100>, 0x80> overlay = {};
+
+  void update_flags();
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <array>
+#include <span>
+#include <string>
+
+#include "common.hpp"
+
+/*
+  CRC-32 (IEEE, as used by zip, gzip, BPS and UPS) and SHA-1 over whole images.
+
+  Both pick a kernel at runtime: CRC-32 folds 64 bytes at a time with carry-less
+  multiplies (PCLMULQDQ) and SHA-1 runs on the SHA extensions when the host has
+  them. Everything else -- and the tail the wide kernels leave -- goes through the
+  portable slicing-by-8 table and the reference SHA-1 rounds.
+*/
+namespace Umibozu::Checksum {
+  using Sha1 = std::array<u8, 20>;
+
+  // `crc` continues a previous call, so a stream can be hashed in pieces
+  [[nodiscard]] u32 crc32(std::span<const u8> bytes, u32 crc = 0);
+  [[nodiscard]] Sha1 sha1(std::span<const u8> bytes);
+
+  [[nodiscard]] u32 crc32_portable(std::span<const u8> bytes, u32 crc = 0);
+  [[nodiscard]] Sha1 sha1_portable(std::span<const u8> bytes);
+
+  // whether crc32() / sha1() use the host's vector kernels
+  [[nodiscard]] bool crc32_accelerated();
+  [[nodiscard]] bool sha1_accelerated();
+
+  [[nodiscard]] std::string to_hex(std::span<const u8> bytes);
+}  // namespace Umibozu::Checksum
@@ -86,6 +86,8 @@ namespace Umibozu {
 
     // Memory R/W
     [[nodiscard]] u8 read8(const u16 address);
+    // read8 of an opcode, through the provenance and telemetry hooks every fetch goes through
+    [[nodiscard]] u8 fetch_opcode(const u16 address);
     [[nodiscard]] u16 read16(const u16 address);
     [[nodiscard]] u8 peek(const u16 address) const;
     void write8(const u16 address, const u8 value);
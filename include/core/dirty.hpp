@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include "common.hpp"
+
+/*
+  Dirty-page tracking for the memories behind the bus.
+
+  Every 256-byte page of a backing store carries the generation it was last
+  written in. A consumer closes the running generation with checkpoint() and
+  later asks which pages changed since then -- this looks at page stamps only,
+  never at the memory itself.
+
+  The bus keeps pages that are clean in the running generation off the direct
+  write path: the first store to such a page goes through write_slow, stamps it
+  and puts the page back on the fast path until the next checkpoint.
+*/
+enum class DIRTY_REGION : u8 { VRAM, WRAM, OAM, EXT_RAM, COUNT };
+
+struct DirtyTracker {
+  // pages per backing store: 2 x 8 KiB VRAM, 8 x 4 KiB WRAM, OAM, cart RAM
+  static constexpr std::array<size_t, (size_t)DIRTY_REGION::COUNT> PAGES = {0x40, 0x80, 0x01, 0x1000};
+
+  DirtyTracker() {
+    for (size_t region = 0; region < PAGES.size(); region++) {
+      stamps[region].assign(PAGES[region], 0);
+    }
+  }
+
+  // generation that writes are currently stamped with, starts at 1
+  [[nodiscard]] u64 generation() const { return current; }
+
+  void mark(DIRTY_REGION region, size_t page) {
+    stamps[(size_t)region][page] = current;
+    last_write[(size_t)region]   = current;
+  }
+
+  void mark_range(DIRTY_REGION region, size_t offset, size_t length) {
+    for (size_t page = offset >> 8; page <= (offset + length - 1) >> 8; page++) {
+      mark(region, page);
+    }
+  }
+
+  void mark_all() {
+    for (size_t region = 0; region < PAGES.size(); region++) {
+      std::fill(stamps[region].begin(), stamps[region].end(), current);
+      last_write[region] = current;
+    }
+  }
+
+  [[nodiscard]] bool clean(DIRTY_REGION region, size_t page) const { return stamps[(size_t)region][page] != current; }
+
+  // generation of the latest write anywhere in `region`
+  [[nodiscard]] u64 last_written(DIRTY_REGION region) const { return last_write[(size_t)region]; }
+
+  [[nodiscard]] bool changed_since(DIRTY_REGION region, size_t page, u64 since) const { return stamps[(size_t)region][page] > since; }
+
+  // pages of `region` written after generation `since` was closed
+  [[nodiscard]] std::vector<u32> changed_since(DIRTY_REGION region, u64 since) const {
+    std::vector<u32> pages;
+    if (last_write[(size_t)region] <= since) return pages;
+
+    const std::vector<u64>& region_stamps = stamps[(size_t)region];
+    for (u32 page = 0; page < region_stamps.size(); page++) {
+      if (region_stamps[page] > since) pages.push_back(page);
+    }
+    return pages;
+  }
+
+  // closes the running generation and returns it -- pass it to changed_since() later.
+  // Only advances the counter: the bus re-arms its fast-path pages (Bus::dirty_checkpoint).
+  u64 advance() { return current++; }
+
+ private:
+  u64 current = 1;
+  std::array<std::vector<u64>, (size_t)DIRTY_REGION::COUNT> stamps;
+  std::array<u64, (size_t)DIRTY_REGION::COUNT> last_write = {};
+};
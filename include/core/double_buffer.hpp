@@ -3,6 +3,8 @@
 #include "common.hpp"
 
 struct DoubleBuffer {
+    static constexpr size_t PIXELS = 160 * 144;
+
     u16* write_buf = nullptr;
     u16* disp_buf  = nullptr;
 
@@ -2,8 +2,11 @@
 
 #include "bus.hpp"
 #include "cart.hpp"
+#include "cheats.hpp"
 #include "cpu.hpp"
 #include "io.hpp"
+#include "mappers.hpp"
+#include "save_flusher.hpp"
 #include "SDL3/SDL_audio.h"
 
 #include <atomic>
@@ -14,18 +17,40 @@ struct GB {
   Bus bus;
   APU apu;
   Cartridge cart;
+  CartMapper mapper;
+  CheatEngine cheats;
+  SaveFlusher saver;  // battery RAM to disk in the background, unless the .sav is mapped
 
   GB();
   ~GB();
 
   void load_cart(const File&);
+  // `rom` with an IPS, BPS or UPS patch applied (and cached) first; throws if it doesn't fit
+  void load_cart(const File& rom, const File& patch);
   void init_hw_regs(SYSTEM_MODE);
 
   std::atomic<bool> active = true;
 
+  // keep battery RAM in a shared mapping of the .sav, so stores reach the file as they
+  // happen instead of being written out on exit; takes effect on the next load_cart
+  bool mapped_saves = false;
+
+  // on load, run the cartridge clock forward by the host time since the save was written
+  bool rtc_host_time = true;
+
   void save_game();
   void load_save_game();
   void system_loop();
 
   void reset();
+
+  // what this instance costs: its own state plus its share of the ROM image
+  struct MemoryReport {
+    size_t instance    = 0;  // sizeof(GB), the PPU's frame buffers and cartridge RAM
+    size_t rom         = 0;  // size of the ROM image
+    size_t rom_sharers = 1;  // cartridges holding the same image
+
+    [[nodiscard]] size_t per_instance() const { return instance + rom / rom_sharers; }
+  };
+  [[nodiscard]] MemoryReport memory_report() const;
 };
\ No newline at end of file
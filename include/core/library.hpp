@@ -0,0 +1,72 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "common.hpp"
+
+/*
+  Indexed ROM library.
+
+  scan() walks the given directories for ROMs (.gb / .gbc, or a .gz / .zip holding
+  one) and compares each one's size and mtime against the index; only new or
+  changed files are read. Those are mapped (or extracted), header-parsed (Cartridge::parse_header) and hashed on a pool of worker
+  threads. A rescan of an unchanged tree is a directory walk and nothing more.
+
+  The index is a small binary file (save() / load()), replaced atomically, so the
+  library is searchable as soon as it is loaded.
+*/
+namespace Umibozu {
+  class RomLibrary {
+   public:
+    struct Entry {
+      std::string path;
+      i64 mtime = 0;  // filesystem clock ticks, only ever compared for equality
+      u64 size  = 0;
+
+      std::string title;
+      u8 mapper_id        = 0;
+      u16 rom_banks       = 0;
+      u16 ram_banks       = 0;
+      u8 cgb_flag         = 0;
+      u8 destination_code = 0;
+
+      u32 crc32           = 0;
+      Checksum::Sha1 sha1 = {};
+
+      std::string key;  // lowercase title and file name, not stored in the index
+
+      [[nodiscard]] bool cgb() const { return cgb_flag == 0x80 || cgb_flag == 0xC0; }
+      [[nodiscard]] bool cgb_only() const { return cgb_flag == 0xC0; }
+    };
+
+    struct Filter {
+      std::string text            = {};  // case-insensitive substring of the title or the file name
+      std::optional<bool> cgb     = {};  // CGB-enhanced (or CGB-only) carts, or DMG-only ones
+      std::optional<u8> mapper_id = {};  // cartridge type byte
+    };
+
+    struct ScanStats {
+      size_t files        = 0;  // ROMs under the roots
+      size_t indexed      = 0;  // read and hashed by this scan
+      size_t reused       = 0;  // unchanged since the index was written
+      size_t removed      = 0;  // gone, unreadable or too small for a header
+      double milliseconds = 0;
+    };
+
+    // replace the library with the ROMs under `roots`; threads == 0 uses every core.
+    // Paths are canonical, so a file reached through overlapping roots or a symlink is indexed once.
+    ScanStats scan(const std::vector<std::string>& roots, unsigned threads = 0);
+
+    // false (and an empty library) if the index is missing or unreadable
+    bool load(const std::string& index_path);
+    bool save(const std::string& index_path) const;
+
+    [[nodiscard]] std::vector<const Entry*> search(const Filter& filter) const;
+    [[nodiscard]] const std::vector<Entry>& entries() const { return items; }
+
+   private:
+    std::vector<Entry> items;  // sorted by path
+  };
+}  // namespace Umibozu
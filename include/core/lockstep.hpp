@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+
+#include "common.hpp"
+#include "gb.hpp"
+
+namespace Umibozu {
+
+  /*
+    Experimental multi-instance interpreter.
+
+    N GB instances, usually running the same ROM, are stepped one instruction at a time.
+    The register file of every lane lives here in structure-of-arrays form; while
+    the lanes agree on PC, register-only opcodes (LD r,r / ALU A,r / INC / DEC ...)
+    are executed once for all lanes (AVX2 when the host supports it).
+    Lanes that diverge -- in PC, or in the opcode at it (banks, cheats) -- and any
+    opcode touching memory or control flow, go through the scalar SM83 path and
+    rejoin the vector group once they agree again.
+
+    Each lane keeps its own bus, PPU, timer and cartridge -- only the fetch /
+    operand M-cycles are ticked per lane, so timing is identical to running the
+    instances on their own.
+  */
+  struct Lockstep {
+    static constexpr size_t LANE_WIDTH = 32;  // lanes per 256-bit vector
+
+    explicit Lockstep(std::span<GB *> lanes);
+
+    // one instruction on every lane
+    void step();
+
+    // step until every lane has produced at least `frames` more frames
+    void run_frames(u64 frames);
+
+    // write the SoA registers back into each lane's SM83 (debugging / inspection)
+    void sync_to_lanes();
+
+    [[nodiscard]] size_t lane_count() const { return gbs.size(); }
+    [[nodiscard]] u64 frames(size_t lane) const { return frame_count[lane]; }
+
+    // cleared to force the portable kernels on AVX2 hosts
+    bool use_avx2 = false;
+
+    u64 vector_steps = 0;  // lane-instructions executed through the vector path
+    u64 scalar_steps = 0;  // lane-instructions executed through SM83::run_instruction
+
+   private:
+    std::vector<GB *> gbs;
+    size_t padded = 0;
+
+    // SM83 register encoding order: B, C, D, E, H, L, (HL), A -- slot 6 is unused
+    std::array<std::vector<u8>, 8> r8;
+    std::vector<u8> F;
+    std::vector<u16> SP;
+    std::vector<u16> PC;
+
+    std::vector<u8> mask;     // 0xFF for lanes taking part in the current vector step
+    std::vector<u8> operand;  // per-lane immediate / source operand
+    std::vector<u64> frame_count;
+
+    void load_lane(size_t lane);
+    void store_lane(size_t lane);
+    void scalar_step(size_t lane);
+    void count_frame(size_t lane);
+
+    [[nodiscard]] bool vector_eligible(size_t lane) const;
+    void execute_vector(u8 opcode);
+  };
+}  // namespace Umibozu
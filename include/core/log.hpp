@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+#include "common.hpp"
+
+/*
+  Leveled, per-category logging.
+
+  Every category has a compile-time minimum level. A message below it is discarded
+  by `if constexpr`, so neither the formatting nor its arguments are evaluated.
+  Enabled messages are formatted on the calling thread into a fixed-size slot of a
+  lock-free ring buffer, and a background thread writes them to stdout. When the ring
+  is full the message is dropped and counted rather than blocking the emulator.
+  ERROR messages are the exception: they are never dropped, and the caller waits
+  until they are written, so one logged right before an assert or abort is not lost.
+
+  Levels: 0 TRACE, 1 DEBUG, 2 INFO, 3 WARN, 4 ERROR, 5 OFF
+    -DUMIBOZU_LOG_LEVEL=n           minimum for every category (default INFO)
+    -DUMIBOZU_LOG_LEVEL_<CAT>=n     override for one category, e.g. UMIBOZU_LOG_LEVEL_DMA=0
+*/
+
+#ifndef UMIBOZU_LOG_LEVEL
+#define UMIBOZU_LOG_LEVEL 2
+#endif
+
+#define UMIBOZU_LOG_CATEGORIES(X) \
+  X(CPU)                          \
+  X(BUS)                          \
+  X(PPU)                          \
+  X(APU)                          \
+  X(DMA)                          \
+  X(MAPPER)                       \
+  X(CART)                         \
+  X(GB)                           \
+  X(FRONTEND)
+
+enum class LOG_LEVEL : u8 { TRACE, DEBUG, INFO, WARN, ERROR, OFF };
+
+#define UMIBOZU_LOG_ENUM(name) name,
+enum class LOG_CATEGORY : u8 { UMIBOZU_LOG_CATEGORIES(UMIBOZU_LOG_ENUM) COUNT };
+#undef UMIBOZU_LOG_ENUM
+
+// per-category overrides fall back to the global level
+#ifndef UMIBOZU_LOG_LEVEL_CPU
+#define UMIBOZU_LOG_LEVEL_CPU UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_BUS
+#define UMIBOZU_LOG_LEVEL_BUS UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_PPU
+#define UMIBOZU_LOG_LEVEL_PPU UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_APU
+#define UMIBOZU_LOG_LEVEL_APU UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_DMA
+#define UMIBOZU_LOG_LEVEL_DMA UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_MAPPER
+#define UMIBOZU_LOG_LEVEL_MAPPER UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_CART
+#define UMIBOZU_LOG_LEVEL_CART UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_GB
+#define UMIBOZU_LOG_LEVEL_GB UMIBOZU_LOG_LEVEL
+#endif
+#ifndef UMIBOZU_LOG_LEVEL_FRONTEND
+#define UMIBOZU_LOG_LEVEL_FRONTEND UMIBOZU_LOG_LEVEL
+#endif
+
+namespace Log {
+  static constexpr size_t MESSAGE_SIZE = 240;
+
+#define UMIBOZU_LOG_MIN_LEVEL(name) static_cast<LOG_LEVEL>(UMIBOZU_LOG_LEVEL_##name),
+  static constexpr LOG_LEVEL MIN_LEVEL[] = {UMIBOZU_LOG_CATEGORIES(UMIBOZU_LOG_MIN_LEVEL)};
+#undef UMIBOZU_LOG_MIN_LEVEL
+
+  template <LOG_CATEGORY category, LOG_LEVEL level>
+  inline constexpr bool enabled = level != LOG_LEVEL::OFF && level >= MIN_LEVEL[static_cast<u8>(category)];
+
+  // copy an already formatted message into the ring; false if it was full. ERROR
+  // messages are written before this returns.
+  bool push(LOG_CATEGORY category, LOG_LEVEL level, std::string_view message);
+
+  template <typename... Args>
+  void write(LOG_CATEGORY category, LOG_LEVEL level, fmt::format_string<Args...> format, Args&&... args) {
+    char buffer[MESSAGE_SIZE];
+    auto result = fmt::format_to_n(buffer, MESSAGE_SIZE, format, std::forward<Args>(args)...);
+    push(category, level, std::string_view(buffer, std::min<size_t>(result.size, MESSAGE_SIZE)));
+  }
+
+  // block until everything queued so far has been written
+  void flush();
+
+  // messages lost to a full ring since startup
+  [[nodiscard]] u64 dropped();
+}  // namespace Log
+
+#define LOG(category, level, ...)                                                  \
+  do {                                                                             \
+    if constexpr (Log::enabled<LOG_CATEGORY::category, LOG_LEVEL::level>) {        \
+      Log::write(LOG_CATEGORY::category, LOG_LEVEL::level, __VA_ARGS__);           \
+    }                                                                              \
+  } while (0)
+
+#define LOG_TRACE(category, ...) LOG(category, TRACE, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG(category, DEBUG, __VA_ARGS__)
+#define LOG_INFO(category, ...)  LOG(category, INFO, __VA_ARGS__)
+#define LOG_WARN(category, ...)  LOG(category, WARN, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG(category, ERROR, __VA_ARGS__)
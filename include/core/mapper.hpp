@@ -1,16 +1,28 @@
 #pragma once
+#include <array>
+
 #include "bus.hpp"
 #include "common.hpp"
 #include "rtc.hpp"
 
-static constexpr u32 CLOCK_SPEED = 4194304;
-
 enum class WRITING_MODE { RTC, RAM };
 
+/*
+  State and bank windows shared by every MBC.
+
+  A concrete mapper only decodes its control registers: `control_write` updates the
+  register state and `remap` turns that state into bank numbers via map_rom/map_ram.
+  The resulting base pointers are mirrored into the bus page table, so ordinary
+  ROM/RAM accesses never reach the mapper; the ones that do (HDMA sources, disabled
+  or register-backed RAM) are a single pointer + offset here.
+
+  Mappers whose RAM window isn't plain memory (RTC, IR, 4-bit RAM) can shadow
+  `ram_read`/`ram_write`, which only run on the slow path.
+*/
 class Mapper {
   public:
-  virtual ~Mapper() {};
-  static inline Bus* bus     = nullptr;
+  explicit Mapper(Bus* bus) : bus(bus) {}
+  Bus* bus                   = nullptr;
   u8 id                      = 0x00;
   u8 banking_mode            = 0;
   u16 rom_bank               = 0;
@@ -20,23 +32,33 @@ class Mapper {
   // RTC & RAM banks share the same enable bit
   bool rtc_ext_ram_enabled = false;
 
-  // RTC -- refactor: is better if this is abstracted away, too much cluster.
-  RTC_INSTANCE rtc_latched, rtc_actual = {};
+  // MBC3 clock; only cartridges with a timer use it, and it is saved after their RAM
+  RealTimeClock rtc;
 
-  void increment_internal_clock(u8 amount, const u16& RTC_DAY) {
-    if (!rtc_ext_ram_enabled) return;
-    if ((RTC_DAY & (1 << 14)) != 0) return;
+  // 0x0000 - 0x3FFF, 0x4000 - 0x7FFF
+  std::array<const u8*, 2> rom_window = {};
+  // 0xA000 - 0xBFFF, nullptr while disabled or not backed by RAM
+  u8* ram_window = nullptr;
+  // offset mask inside the RAM window -- smaller than 0x1FFF for mirrored RAM
+  u16 ram_window_mask = 0x1FFF;
+  // false routes RAM stores through ram_write (e.g. MBC2 nibble RAM)
+  bool ram_direct_writes = true;
 
-    rtc_actual.internal_clock += amount;
+  u8 rom_read(const u16 address) const {
+    const u8* window = rom_window[address >> 14];
+    return window != nullptr ? window[address & 0x3FFF] : 0xFF;
+  }
+
+  u8 ram_read(const u16 address) const { return ram_window != nullptr ? ram_window[address & ram_window_mask] : 0xFF; }
 
-    if (rtc_actual.internal_clock == CLOCK_SPEED) {
-      rtc_actual.tick();
-      rtc_actual.internal_clock = 0;
-    }
+  void ram_write(const u16 address, const u8 value) {
+    if (ram_window != nullptr) ram_window[address & ram_window_mask] = value;
   }
 
-  virtual u8 read8(const u16 address)                    = 0;
-  virtual void write8(const u16 address, const u8 value) = 0;
+  protected:
+  // point a 16 KiB ROM window (0 or 1) at `bank`, wrapping by the image size
+  void map_rom(u8 window, u32 bank);
+  // point the RAM window at `bank` of cart RAM, wrapping by the header bank count
+  void map_ram(u32 bank, u16 mask = 0x1FFF, bool direct_writes = true);
+  void unmap_ram();
 };
-
-Mapper* get_mapper_by_id(u8 mapper_id);
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include <type_traits>
+#include <variant>
+
+#include "common.hpp"
+#include "mapper.hpp"
+#include "mappers/huc1.hpp"
+#include "mappers/mbc1.hpp"
+#include "mappers/mbc2.hpp"
+#include "mappers/mbc3.hpp"
+#include "mappers/mbc5.hpp"
+#include "mappers/rom_only.hpp"
+
+// The cartridge's MBC, stored by value. Banked accesses read the shared bank windows
+// through `base`; only control writes and the RAM slow path dispatch on the concrete
+// type, as a std::visit jump on the variant index rather than a virtual call.
+// `std::monostate` means no cart has been loaded.
+struct CartMapper {
+  std::variant<std::monostate, ROM_ONLY, MBC1, MBC2, MBC3, MBC5, HuC1> kind;
+  Mapper* base = nullptr;
+
+  void load(u8 mapper_id, Bus* bus);
+
+  [[nodiscard]] bool loaded() const { return base != nullptr; }
+
+  // common MBC state (banks, id, RTC) -- nullptr when nothing is loaded
+  [[nodiscard]] Mapper* get() const { return base; }
+
+  u8 read8(const u16 address) {
+    if (address <= 0x7FFF) {
+      return base != nullptr ? base->rom_read(address) : 0xFF;
+    }
+
+    return std::visit(
+        [address](auto& mapper) -> u8 {
+          if constexpr (std::is_same_v<std::decay_t<decltype(mapper)>, std::monostate>) {
+            return 0xFF;
+          } else {
+            return mapper.ram_read(address);
+          }
+        },
+        kind);
+  }
+
+  void write8(const u16 address, const u8 value) {
+    std::visit(
+        [address, value](auto& mapper) {
+          if constexpr (!std::is_same_v<std::decay_t<decltype(mapper)>, std::monostate>) {
+            if (address <= 0x7FFF) {
+              mapper.control_write(address, value);
+              mapper.remap();
+            } else {
+              mapper.ram_write(address, value);
+            }
+          }
+        },
+        kind);
+  }
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "mapper.hpp"
+// Hudson HuC1 -- MBC1-like banking plus an IR port that replaces RAM at 0xA000 - 0xBFFF
+class HuC1 : public Mapper {
+ public:
+  explicit HuC1(Bus* bus) : Mapper(bus) {
+    rom_bank = 1;
+    remap();
+  }
+
+  bool ir_mode = false;
+
+  void remap() {
+    map_rom(0, 0);
+    map_rom(1, rom_bank);
+
+    if (ir_mode) {
+      unmap_ram();
+    } else {
+      map_ram(ram_bank);
+    }
+  }
+
+  void control_write(const u16 address, const u8 value) {
+    if (address <= 0x1FFF) {
+      ir_mode = (value & 0xF) == 0xE;
+      return;
+    }
+    if (address >= 0x2000 && address <= 0x3FFF) {
+      rom_bank = value & 0x3F;
+      return;
+    }
+    if (address >= 0x4000 && address <= 0x5FFF) {
+      ram_bank = value & 0x3;
+      return;
+    }
+  }
+
+  // no IR light is ever received; the LED output is ignored
+  u8 ram_read(const u16 address) const { return ir_mode ? 0xC0 : Mapper::ram_read(address); }
+};
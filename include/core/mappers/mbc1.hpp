@@ -0,0 +1,44 @@
+#pragma once
+#include "mapper.hpp"
+class MBC1 : public Mapper {
+ public:
+  explicit MBC1(Bus* bus) : Mapper(bus) { remap(); }
+
+  void remap() {
+    map_rom(0, 0);
+    map_rom(1, rom_bank == 0 ? 1 : rom_bank);
+
+    if (rtc_ext_ram_enabled) {
+      map_ram(banking_mode == 0 ? 0 : ram_bank);
+    } else {
+      unmap_ram();
+    }
+  }
+
+  void control_write(const u16 address, const u8 value) {
+    if (address <= 0x1FFF) {
+      if ((value & 0xF) == 0xA) {
+        rtc_ext_ram_enabled = true;
+      } else {
+        rtc_ext_ram_enabled = false;
+      }
+      return;
+    }
+
+    if (address >= 0x2000 && address <= 0x3FFF) {
+      rom_bank = (value & (bus->cart->info.rom_banks - 1));
+      // rom_bank &= bus->cart->info.rom_banks;
+      return;
+    }
+    if (address >= 0x4000 && address <= 0x5FFF) {
+      if (bus->cart->info.ram_banks >= 4) {
+        ram_bank = value & 0x3;
+      }
+      return;
+    }
+    if (address >= 0x6000 && address <= 0x7FFF) {
+      banking_mode = value & 0x1;
+      return;
+    }
+  }
+};
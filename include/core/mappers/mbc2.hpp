@@ -0,0 +1,36 @@
+#pragma once
+#include "mapper.hpp"
+// 512 x 4-bit built-in RAM, mirrored across 0xA000 - 0xBFFF
+class MBC2 : public Mapper {
+ public:
+  explicit MBC2(Bus* bus) : Mapper(bus) {
+    rom_bank = 1;
+    remap();
+  }
+
+  // reads come straight from the page table; stores go through ram_write to keep the upper nibble set
+  void remap() {
+    map_rom(0, 0);
+    map_rom(1, rom_bank);
+
+    if (rtc_ext_ram_enabled) {
+      map_ram(0, 0x1FF, false);
+    } else {
+      unmap_ram();
+    }
+  }
+
+  void control_write(const u16 address, const u8 value) {
+    if (address > 0x3FFF) return;
+
+    // address bit 8 selects between the RAM enable and ROM bank registers
+    if ((address & 0x100) == 0) {
+      rtc_ext_ram_enabled = (value & 0xF) == 0xA;
+    } else {
+      rom_bank = value & 0xF;
+      if (rom_bank == 0) rom_bank = 1;
+    }
+  }
+
+  void ram_write(const u16 address, const u8 value) { Mapper::ram_write(address, value | 0xF0); }
+};
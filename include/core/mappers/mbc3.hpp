@@ -0,0 +1,90 @@
+#pragma once
+#include "mapper.hpp"
+class MBC3 : public Mapper {
+ public:
+  explicit MBC3(Bus* bus) : Mapper(bus) {
+    rom_bank = 1;
+    remap();
+  }
+
+  // RAM is only mapped in RAM mode; RTC registers go through ram_read/ram_write
+  void remap() {
+    map_rom(0, 0);
+    map_rom(1, rom_bank);
+
+    if (rtc_ext_ram_enabled && register_mode == WRITING_MODE::RAM && ram_bank < 8) {
+      map_ram(ram_bank);
+    } else {
+      unmap_ram();
+    }
+  }
+
+  void control_write(const u16 address, const u8 value) {
+    if (address <= 0x1FFF) {
+      if ((value & 0xF) == 0xA) {
+        rtc_ext_ram_enabled = true;
+      } else {
+        rtc_ext_ram_enabled = false;
+      }
+
+      return;
+    }
+
+    if (address >= 0x2000 && address <= 0x3FFF) {
+      if (value == 0) {
+        rom_bank = 1;
+        return;
+      }
+
+      rom_bank = value & (bus->cart->info.rom_banks - 1);
+      // fmt::println("new rom bank: {:d}", rom_bank);
+
+      return;
+    }
+
+    if (address >= 0x4000 && address <= 0x5FFF) {
+      if (value <= 0x7) {
+        register_mode = WRITING_MODE::RAM;
+        ram_bank      = value;
+      }
+      if (value >= 0x08 && value <= 0x0C) {
+        register_mode = WRITING_MODE::RTC;
+        rtc_register  = (RTC_REGISTER)value;
+      }
+
+      return;
+    }
+
+    if (address >= 0x6000 && address <= 0x7FFF) {
+      // 0x00 then 0x01 copies the running clock into the readable registers
+      if (value == 0x01 && last_latch_write == 0x00 && has_clock()) {
+        rtc.latch(bus->timer->clock);
+      }
+      last_latch_write = value;
+      return;
+    }
+  }
+
+  u8 ram_read(const u16 address) const {
+    if (register_mode == WRITING_MODE::RTC) {
+      return rtc_ext_ram_enabled && has_clock() ? rtc.read(rtc_register) : 0xFF;
+    }
+
+    return Mapper::ram_read(address);
+  }
+
+  void ram_write(const u16 address, const u8 value) {
+    if (register_mode == WRITING_MODE::RTC) {
+      if (rtc_ext_ram_enabled && has_clock()) rtc.write(rtc_register, value, bus->timer->clock);
+      return;
+    }
+
+    Mapper::ram_write(address, value);
+  }
+
+ private:
+  RTC_REGISTER rtc_register = RTC_REGISTER::RTC_SECOND_TIME;
+  u8 last_latch_write       = 0xFF;
+
+  [[nodiscard]] bool has_clock() const { return bus->cart->has_rtc(); }
+};
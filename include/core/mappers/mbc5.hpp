@@ -0,0 +1,52 @@
+#pragma once
+#include "mapper.hpp"
+class MBC5 : public Mapper {
+ public:
+  explicit MBC5(Bus* bus) : Mapper(bus) {
+    rom_bank = 1;
+    remap();
+  }
+
+  void remap() {
+    map_rom(0, 0);
+    map_rom(1, rom_bank);
+
+    if (rtc_ext_ram_enabled) {
+      map_ram(ram_bank);
+    } else {
+      unmap_ram();
+    }
+  }
+
+  void control_write(const u16 address, const u8 value) {
+    if (address <= 0x1FFF) {
+      if ((value & 0xF) == 0xA) {
+        rtc_ext_ram_enabled = true;
+      } else {
+        rtc_ext_ram_enabled = false;
+      }
+      return;
+    }
+
+    if (address >= 0x2000 && address <= 0x2FFF) {
+      rom_bank = value & (bus->cart->info.rom_banks - 1);
+      return;
+    }
+    if (address >= 0x3000 && address <= 0x3FFF) {
+      if (value & 0x1) {
+        rom_bank |= (1 << 8);
+      } else {
+        rom_bank &= ~(1 << 8);
+      }
+
+      return;
+    }
+
+    if (address >= 0x4000 && address <= 0x5FFF) {
+      if (value < 0xF) {
+        ram_bank = value;
+      }
+      return;
+    }
+  }
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "mapper.hpp"
+class ROM_ONLY : public Mapper {
+ public:
+  explicit ROM_ONLY(Bus* bus) : Mapper(bus) {
+    if (bus->cart->info.ram_banks > 0) {
+      rtc_ext_ram_enabled = true;
+    }
+    remap();
+  }
+
+  void remap() {
+    map_rom(0, 0);
+    map_rom(1, 1);
+
+    if (rtc_ext_ram_enabled) {
+      map_ram(0);
+    } else {
+      unmap_ram();
+    }
+  }
+
+  // no registers -- writes to ROM are ignored
+  void control_write(const u16, const u8) {}
+};
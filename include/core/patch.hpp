@@ -0,0 +1,31 @@
+#pragma once
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "io.hpp"
+
+/*
+  IPS, BPS and UPS patches.
+
+  apply() decodes the patch front to back in one pass, writing straight into the
+  output image: IPS records land on a copy of the source, BPS actions and UPS XOR
+  hunks fill a buffer allocated at the target size up front. BPS and UPS carry
+  CRC-32s of the source, the target and the patch itself -- all three are checked,
+  and a mismatch throws rather than producing a half-right ROM.
+
+  apply_cached() keys the result by the CRC-32 of the ROM and the SHA-1 of the patch
+  and keeps it under `cache_dir`, so loading the same pair again maps the patched
+  image like any other ROM file.
+*/
+namespace Umibozu::Patch {
+  enum class FORMAT : u8 { IPS, BPS, UPS, UNKNOWN };
+
+  [[nodiscard]] FORMAT detect(std::span<const u8> patch);
+
+  // throws std::runtime_error on malformed patches and checksum mismatches
+  [[nodiscard]] std::vector<u8> apply(std::span<const u8> source, std::span<const u8> patch);
+
+  [[nodiscard]] File apply_cached(const File& rom, const File& patch, const std::string& cache_dir = "cache/patched");
+}  // namespace Umibozu::Patch
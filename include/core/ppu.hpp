@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <bitset>
 
 #include "stopwatch.hpp"
 
@@ -8,8 +9,9 @@ struct Bus;
 #include "bus.hpp"
 #include "common.hpp"
 #include "double_buffer.hpp"
+#include "tile_cache.hpp"
 
-class Mapper;
+struct CartMapper;
 #include "mapper.hpp"
 
 static constexpr u16 WHITE               = 0x6BFC;
@@ -17,6 +19,8 @@ static constexpr u16 LIGHTGREY           = 0x3B11;
 static constexpr u16 DARKGREY            = 0x29A6;
 static constexpr u16 BLACK               = 0x0000;
 static constexpr u16 VRAM_ADDRESS_OFFSET = 0x8000;
+static constexpr u16 SCREEN_WIDTH        = 160;
+static constexpr u16 SCREEN_HEIGHT       = 144;
 
 union LCDC {
   u8 value;
@@ -47,10 +51,6 @@ union Attribute_Data {
     bool priority    : 1;
   };
 };
-struct Tile {
-  std::array<std::array<Pixel, 8>, 8> pixel_data;
-  Attribute_Data cgb_attr_data;
-};
 
 enum class RENDERING_MODE { HBLANK = 0, VBLANK, OAM_SCAN, PIXEL_DRAW };
 
@@ -77,18 +77,6 @@ struct Sprite {
     this->value   = s_flags;
   }
 };
-struct Frame {
-  std::array<u8, 256 * 256> color_id;   // holds the current color id occupying this space in the frame, used to determine priority
-  std::array<bool, 256 * 256> bg_prio;  // used to determine priority, checks if background has bit 7 set -- https://gbdev.io/pandocs/Tile_Maps.html#bg-map-attributes-cgb-mode-only
-
-  void clear() {
-    color_id.fill(0);
-    bg_prio.fill(false);
-  }
-};
-
-enum class FLIP_AXIS { X, Y };
-
 typedef std::array<u16, 4> Palette;
 
 struct PPU {
@@ -99,47 +87,64 @@ struct PPU {
   void set_ppu_mode(RENDERING_MODE mode);
   void add_sprite_to_buffer(u8 spriteIndex);
   u8 get_sprite_size() const;
-  void flip(Tile &, FLIP_AXIS);
-  Tile active_tile;
-  u16 window_current_y    = 0;
-  u16 window_line_count   = 0;
-  u16 window_x_pos_offset = 0;
+  u16 window_current_y = 0;  // window lines drawn this frame, the window's own LY
   [[nodiscard]] u16 get_tile_bg_map_address_base() const;
   [[nodiscard]] u16 get_tile_window_map_address_base() const;
 
  public:
-  Frame frame;
+  // BG / window pixels of the line being drawn: colour index in bits 0-1, CGB BG-to-OBJ
+  // priority (https://gbdev.io/pandocs/Tile_Maps.html#bg-map-attributes-cgb-mode-only) in bit 7.
+  // Every pixel is rewritten by each line, so it never needs clearing.
+  static constexpr u8 BG_PRIORITY = 0x80;
+  std::array<u8, SCREEN_WIDTH> bg_line = {};
 
-  u16 *disp_buf  = new u16[256 * 256];
-  u16 *write_buf = new u16[256 * 256];
+  u16 *disp_buf  = new u16[SCREEN_WIDTH * SCREEN_HEIGHT]();
+  u16 *write_buf = new u16[SCREEN_WIDTH * SCREEN_HEIGHT]();
+  static constexpr size_t FRAME_BUFFER_BYTES = 2 * SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(u16);
 
   DoubleBuffer db = DoubleBuffer(disp_buf, write_buf);
 
+  // Caller memory to draw lines into instead of `db` (a locked streaming texture, say):
+  // line y starts at pixels + y * stride, stride in pixels. It is written line by line as
+  // the frame is drawn and never read, so it must stay valid until replaced; nullptr goes
+  // back to `db`, which is only swapped at VBlank while it is the target. The memory being
+  // replaced gets every line not drawn into it (LCD off, or on mid-frame) filled with white.
+  void set_output(u16 *pixels, size_t stride);
+  [[nodiscard]] u16 *output_line(u8 y) const { return output != nullptr ? output + y * output_stride : db.write_buf + y * SCREEN_WIDTH; }
+  u16 *output          = nullptr;
+  size_t output_stride = SCREEN_WIDTH;
+  std::bitset<SCREEN_HEIGHT> output_drawn;  // lines of `output` written since it was set
+
   RENDERING_MODE get_mode() const { return ppu_mode; }
 
   union LCDC lcdc{0x91};
   u16 dots       = 0;
   Bus *bus       = nullptr;
-  Mapper *mapper = nullptr;
+  CartMapper *mapper = nullptr;
 
   bool frame_queued = false;
   bool frame_skip   = false;
+  u64 frames        = 0;  // VBlanks since reset
 
   bool hdma_active     = false;
   u16 remaining_length = 0;
 
   bool stat_irq_fired_on_current_scanline = false;
 
-  u8 x_pos_offset = 0;
   void tick(u16 inc);
   [[nodiscard]] std::string get_mode_string() const;
 
-  void process_hdma_chunk();
   void increment_scanline() const;
 
-  // REFACTOR: i think these functions actually do the same thing, merge into one.
-  [[nodiscard]] Tile get_tile_data(u16 address, bool sprite = false) const;
-  [[nodiscard]] Tile get_tile_sprite_data(u16 index, bool sprite = false, u8 bank = 0) const;
+  Umibozu::TileCache tiles;
+  // tile cache index of a BG / window map entry, per LCDC.4 addressing
+  [[nodiscard]] u16 get_bg_tile_index(u8 map_entry) const;
+
+  // composites line LY: BG, window, then sprites, 160 pixels, one tile row fetched per tile
+  void render_scanline();
+  // BG / window pixels [from, to) of the line, read from `map_base` starting at map pixel (map_x, map_y)
+  void render_tile_span(u16 map_base, u8 map_x, u8 map_y, u8 from, u8 to, u16 *out);
+  void render_sprites(u16 *out);
 
   const std::array<u16, 4> shade_table = {WHITE, LIGHTGREY, DARKGREY, BLACK};
   bool window_enabled                  = false;
@@ -148,8 +153,7 @@ struct PPU {
   Stopwatch stopwatch;
   std::chrono::duration<double, std::milli> target_duration = std::chrono::duration<double, std::milli>(1000/59.7);
 
-  bool hdma_executed_on_scanline = false;
-  bool ly_is_lyc_latch           = false;
+  bool ly_is_lyc_latch = false;
 
   std::array<Palette, 8> DMG_BGP;
   std::array<Palette, 8> DMG_OBP;
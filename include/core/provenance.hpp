@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include "common.hpp"
+
+/*
+  Write provenance: "who wrote this byte".
+
+  A shadow of a memory region keeps, per byte, the last DEPTH CPU writes to it --
+  PC and bank of the writing instruction, frame, and the T-cycle within that
+  frame. The bus routes a region's pages through its write slow path only while
+  the region is enabled, so everything else keeps its direct page-table stores.
+  Shadow storage grows in 8 KiB steps as bytes of the region are written.
+
+  Offsets are into the region's backing store, not the CPU address space:
+  VRAM bank * 0x2000, WRAM bank * 0x1000, cart RAM bank * 0x2000, HRAM 0x00 - 0x7E.
+*/
+enum class SHADOW_REGION : u8 { VRAM, WRAM, HRAM, EXT_RAM, COUNT };
+
+struct WriteRecord {
+  u32 frame = 0;
+  u32 cycle = 0;  // T-cycles since the start of `frame`
+  u16 pc    = 0;  // address of the writing instruction
+  u16 bank  = 0;  // ROM bank (0x0000 - 0x7FFF) or WRAM bank (0xD000 - 0xDFFF) the PC was in
+};
+
+struct WriteProvenance {
+  static constexpr size_t DEPTH = 4;
+
+  // instruction being executed -- set by the CPU while any region is enabled
+  u16 pc = 0;
+
+  [[nodiscard]] bool any() const { return enabled_mask != 0; }
+  [[nodiscard]] bool enabled(SHADOW_REGION region) const { return enabled_mask & (1 << (u8)region); }
+
+  // disabling frees the region's shadow
+  void enable(SHADOW_REGION region, bool on);
+
+  void record(SHADOW_REGION region, size_t offset, const WriteRecord& write);
+
+  // most recent write first, at most DEPTH entries
+  [[nodiscard]] std::vector<WriteRecord> history(SHADOW_REGION region, size_t offset) const;
+
+  // forget every recorded write, regions stay enabled
+  void clear();
+
+ private:
+  struct Shadow {
+    std::vector<std::array<WriteRecord, DEPTH>> records;
+    std::vector<u8> next;   // slot the next write goes to
+    std::vector<u8> count;  // filled slots, up to DEPTH
+  };
+
+  u8 enabled_mask = 0;
+  std::array<Shadow, (size_t)SHADOW_REGION::COUNT> shadows;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "io.hpp"
+
+namespace Umibozu {
+  /*
+    Process-wide registry of immutable ROM images, keyed by their size and a hash of
+    their header; a key hit is confirmed by comparing the bytes.
+
+    Every GB running the same title holds a reference to one shared image instead
+    of its own copy. The registry only keeps weak references: an image is released
+    when the last cartridge using it is unloaded.
+  */
+  class RomRegistry {
+   public:
+    static RomRegistry& instance();
+
+    // the live image with the same contents as `image`, or `image` itself once registered
+    std::shared_ptr<const MappedFile> intern(std::shared_ptr<const MappedFile> image);
+
+    // same for bytes built in memory -- they are only copied if no live image matches
+    std::shared_ptr<const MappedFile> intern(std::span<const u8> bytes);
+
+    struct Stats {
+      size_t images     = 0;  // distinct live images
+      size_t bytes      = 0;  // their total size
+      size_t references = 0;  // cartridges holding them
+    };
+    [[nodiscard]] Stats stats();
+
+    [[nodiscard]] static u64 hash(std::span<const u8> bytes);
+
+    // size and a hash of the first HEADER_BYTES (entry point through the global checksum)
+    [[nodiscard]] static u64 key(std::span<const u8> bytes);
+    static constexpr size_t HEADER_BYTES = 0x150;
+
+   private:
+    std::mutex mutex;
+    std::unordered_multimap<u64, std::weak_ptr<const MappedFile>> images;
+
+    // caller holds `mutex`
+    std::shared_ptr<const MappedFile> find(u64 key, std::span<const u8> bytes);
+    void purge();  // drops images whose last cartridge is gone
+  };
+}  // namespace Umibozu
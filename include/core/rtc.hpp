@@ -1,81 +1,66 @@
 #pragma once
+#include <optional>
+#include <span>
+
 #include "common.hpp"
+
 enum class RTC_REGISTER { RTC_SECOND_TIME = 0x08, RTC_MINUTE_TIME = 0x09, RTC_HOUR_TIME = 0x0A, RTC_DAY_LOW = 0x0B, RTC_DAY_HIGH = 0x0C };
 
+// The five MBC3 clock registers as the game sees them.
 struct RTC_INSTANCE {
-  u64 internal_clock = 0;  // RTC only
-  RTC_REGISTER active_register = RTC_REGISTER::RTC_SECOND_TIME;
+  u8 second_time = 0;  // 6 bits
+  u8 minute_time = 0;  // 6 bits
+  u8 hour_time   = 0;  // 5 bits
+  u16 day        = 0;  // bits 0-8 day counter, bit 14 halt, bit 15 day counter carry
+
+  [[nodiscard]] bool halted() const { return (day & (1 << 14)) != 0; }
+
+  void write(RTC_REGISTER r, u8 v);
+  [[nodiscard]] u8 read(RTC_REGISTER r) const;
+
+  // one second, overflowing like the hardware: a field only carries when it reaches its
+  // limit (60 / 60 / 24), values the game wrote past that wrap at the field width instead
+  void tick();
+  void advance(u64 seconds);
+};
+
+/*
+  MBC3 real-time clock, computed lazily.
+
+  Nothing runs per cycle. The clock remembers the emulated time (`now`, T-cycles at
+  4 MiHz from Timer::clock) its registers were last brought up to, and only catches
+  up -- whole seconds in one step -- when the game latches it, writes a register,
+  or the save is written. While halted, the time passing is simply dropped.
 
+  The state persists in the 48-byte footer most emulators append to the .sav: the
+  current and the latched registers as little-endian u32s, then a 64-bit UNIX
+  timestamp. Loading can add the host time that passed since that timestamp, so the
+  clock keeps running while the emulator is closed.
+*/
+class RealTimeClock {
+ public:
+  static constexpr u64 TICKS_PER_SECOND = 4194304;
+  static constexpr size_t FOOTER_SIZE   = 48;
 
-  u8 second_time : 6 = 0;
-  u8 minute_time : 6 = 0;
-  u8 hour_time   : 5 = 0;
-  u16 day            = 0;
+  void latch(u64 now);
+  void write(RTC_REGISTER r, u8 value, u64 now);
+  [[nodiscard]] u8 read(RTC_REGISTER r) const { return latched.read(r); }
 
-  void write_to_active_reg(RTC_REGISTER r, u8 v, u64& internal_clock) {
-    switch (r) {
-      case RTC_REGISTER::RTC_SECOND_TIME: {
-        second_time    = v & 0b00111111;
-        internal_clock = 0;
-        break;
-      }
-      case RTC_REGISTER::RTC_MINUTE_TIME: {
-        minute_time = v & 0b00111111;
-        break;
-      }
-      case RTC_REGISTER::RTC_HOUR_TIME: {
-        hour_time = v & 0b00011111;
-        break;
-      }
-      case RTC_REGISTER::RTC_DAY_LOW: {
-        day &= 0b1111111100000000;
-        day |= (v & 0b11111111);
-        break;
-      }
-      case RTC_REGISTER::RTC_DAY_HIGH: {
-        day &= 0b0000000011111111;
-        day |= ((v & 0b11000001) << 8);
-        break;
-      }
-      default: {
-        fmt::println("[MAPPER] invalid rtc mode ({})", (u8)r);
-        exit(-1);
-      }
-    }
-  }
+  // the running registers as of `now`
+  [[nodiscard]] const RTC_INSTANCE& current(u64 now);
 
-  [[nodiscard]] u16 read_from_active_reg(RTC_REGISTER r) {
-    switch (r) {
-      case RTC_REGISTER::RTC_SECOND_TIME: return second_time;
-      case RTC_REGISTER::RTC_MINUTE_TIME: return minute_time;
-      case RTC_REGISTER::RTC_HOUR_TIME: return hour_time;
-      case RTC_REGISTER::RTC_DAY_LOW: return (day & 0xFF);
-      case RTC_REGISTER::RTC_DAY_HIGH: return (day >> 8);
-      default: assert(0);
-    }
-  }
+  void save(std::span<u8> footer, u64 now, i64 unix_time);
+  // all-zero footers (new saves, saves from before the clock) start the clock at zero;
+  // with `unix_time`, the time since the footer was written is added
+  void load(std::span<const u8> footer, u64 now, std::optional<i64> unix_time);
 
-  void tick() {
-    // fmt::println("[RTC] RTC_SECOND_TIME: {}", (u8)RTC_SECOND_TIME);
-    second_time += 1;
+  [[nodiscard]] static i64 unix_now();
 
-    if (second_time == 60) {
-      second_time = 0;
-      minute_time += 1;
-      if (minute_time == 60) {
-        minute_time = 0;
-        hour_time += 1;
+ private:
+  RTC_INSTANCE actual;
+  RTC_INSTANCE latched;
+  u64 base      = 0;  // emulated time `actual` is up to date with
+  u64 subsecond = 0;  // ticks into the current second
 
-        if (hour_time == 24) {
-          hour_time = 0;
-          if (day == 0x1ff) {
-            day &= ~0x1ff;
-            day |= (1 << 15);
-          } else {
-            day += 1;
-          }
-        }
-      }
-    }
-  }
-};
\ No newline at end of file
+  void catch_up(u64 now);
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+struct Bus;
+
+/*
+  Periodic battery-save writer.
+
+  poll() runs on the emulation thread once a frame. When `interval` has passed and
+  cartridge-RAM pages were written since the last snapshot (per the bus' dirty
+  stamps), those 256-byte pages are copied into a batch for the writer thread --
+  no disk I/O, and no waiting: if the writer is holding the batch, poll() tries
+  again next frame and the pages are still there to pick up.
+
+  Carts with a clock add its 48-byte footer to every batch, and flush() always
+  writes it.
+
+  The writer merges batches into its own copy of the save and replaces the file
+  atomically (write <path>.tmp, fsync, rename), so a crash leaves either the old
+  save or the new one, never a torn file. A write that fails is retried with the
+  next batch, and flush() / stop() rewrite the whole image if the last one failed.
+*/
+struct SaveFlusher {
+  SaveFlusher() = default;
+  ~SaveFlusher();
+
+  SaveFlusher(const SaveFlusher&)            = delete;
+  SaveFlusher& operator=(const SaveFlusher&) = delete;
+
+  // time between snapshots, read by poll()
+  std::chrono::milliseconds interval = std::chrono::seconds(1);
+
+  // take the current cartridge RAM as the saved state and start the writer
+  void start(Bus& bus, std::string path);
+
+  // write out anything already handed over and join the writer
+  void stop();
+
+  [[nodiscard]] bool running() const { return writer.joinable(); }
+
+  void poll(Bus& bus);
+
+  // snapshot now and block until it and everything handed over before is on disk --
+  // for the exit path, not the emulation loop
+  void flush(Bus& bus);
+
+  std::atomic<u64> files_written = 0;
+  std::atomic<u64> pages_written = 0;
+
+ private:
+  struct Page {
+    u32 offset;
+    std::array<u8, 0x100> bytes;
+  };
+
+  std::string path;
+  std::vector<u8> image;  // writer thread only, once started
+  u64 since = 0;          // dirty generation of the last snapshot
+  std::chrono::steady_clock::time_point last_poll;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable written;
+  std::vector<Page> pending;
+  u64 submitted     = 0;  // batches handed over / written, guarded by `mutex`
+  u64 completed     = 0;
+  bool stopping     = false;
+  bool write_failed = false;  // the last write did not reach the disk
+  bool retry        = false;  // write the image even without new pages
+  std::thread writer;
+
+  // with `mutex` held; `with_clock` queues the RTC footer even when no RAM changed
+  bool snapshot(Bus& bus, bool with_clock);
+  void write_loop();
+};
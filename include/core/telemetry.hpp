@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <string>
+
+#include "common.hpp"
+
+/*
+  Memory access telemetry.
+
+  Counts CPU reads, writes and opcode fetches per 256-byte page of the address
+  space, and writes / actual bank switches per MBC control register (0x0000,
+  0x2000, 0x4000, 0x6000). Counters are collected for the running frame and
+  rolled into `last_frame` and `total` at VBlank.
+
+  The hooks are only compiled in with -DUMIBOZU_TELEMETRY (CMake option of the
+  same name) and then still cost nothing but a branch until `enabled` is set.
+  A fetch is also counted as a read of its page.
+*/
+struct MemoryTelemetry {
+  static constexpr size_t PAGES         = 0x100;
+  static constexpr size_t MBC_REGISTERS = 4;
+
+  struct Counters {
+    std::array<u64, PAGES> reads                   = {};
+    std::array<u64, PAGES> writes                  = {};
+    std::array<u64, PAGES> fetches                 = {};
+    std::array<u64, MBC_REGISTERS> register_writes = {};
+    std::array<u64, MBC_REGISTERS> bank_switches   = {};
+
+    Counters& operator+=(const Counters& other);
+  };
+
+  bool enabled = false;
+
+  Counters frame;       // frame in progress
+  Counters last_frame;  // last completed frame
+  Counters total;       // every completed frame since reset()
+  u64 frames = 0;
+
+  void count_read(u16 address) { frame.reads[address >> 8]++; }
+  void count_write(u16 address) { frame.writes[address >> 8]++; }
+  void count_fetch(u16 address) { frame.fetches[address >> 8]++; }
+
+  // `switched` is whether the write moved a ROM or RAM bank window
+  void count_mapper_write(u16 address, bool switched) {
+    frame.register_writes[(address >> 13) & 3]++;
+    frame.bank_switches[(address >> 13) & 3] += switched;
+  }
+
+  void end_frame();
+  void reset();
+
+  // one row per page followed by one per MBC register, totals and last frame side by side
+  [[nodiscard]] std::string to_csv() const;
+  [[nodiscard]] std::string to_json() const;
+
+  bool write_csv(const std::string& path) const;
+  bool write_json(const std::string& path) const;
+};
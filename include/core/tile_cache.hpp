@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+
+#include "common.hpp"
+#include "tile_decode.hpp"
+
+struct Bus;
+
+/*
+  Decoded tiles of both VRAM banks, kept across scanlines.
+
+  A tile is decoded on first use -- all 8 rows, plus each row mirrored for X-flipped
+  attributes -- and stays valid until VRAM under it changes. The Y-flipped variant
+  is the same rows read bottom up, so row() takes the flip and picks the row for it.
+
+  Invalidation rides on the bus' dirty pages: every VRAM store (CPU, GDMA, HDMA)
+  stamps its page, and sync() drops the 16 tiles of each page stamped since the
+  last sync. The PPU syncs once per scanline, before it renders the line.
+*/
+namespace Umibozu {
+  class TileCache {
+   public:
+    // 0x8000-0x97FF: 384 tiles per bank, indexed by their offset / 16
+    static constexpr u16 TILES_PER_BANK = 384;
+
+    // row `y` (0-7, top down as displayed) of a tile, as TileDecode::Row: pixel 0 is the rightmost
+    [[nodiscard]] const TileDecode::Row& row(const Bus& bus, u8 bank, u16 tile, u8 y, bool x_flip, bool y_flip) {
+      const u16 slot = bank * TILES_PER_BANK + tile;
+      if (!valid[slot]) decode(bus, slot);
+      return rows[slot][x_flip][y_flip ? 7 - y : y];
+    }
+
+    void sync(Bus& bus);
+    void invalidate_all() { valid.fill(false); }
+
+   private:
+    using Rows = std::array<TileDecode::Row, 8>;
+
+    std::array<std::array<Rows, 2>, 2 * TILES_PER_BANK> rows;  // [slot][x_flip][y]
+    std::array<bool, 2 * TILES_PER_BANK> valid = {};
+    u64 since                                  = 0;  // dirty generation the cache is up to date with
+
+    void decode(const Bus& bus, u16 slot);
+  };
+}  // namespace Umibozu
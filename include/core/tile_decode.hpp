@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <cstring>
+
+#include "common.hpp"
+
+/*
+  2bpp tile row decoding.
+
+  A tile row is two bytes: bit i of the low byte is bit 0 of pixel i's colour index
+  and bit i of the high byte its bit 1 (pixel 0 being the rightmost one). SPREAD
+  moves bit i of a byte into byte i of a u64, so a whole row is two lookups, a
+  shift and an OR.
+
+  tile() decodes all 8 rows of a tile at once. With AVX2 that is two shuffles per
+  four rows; without it, eight row lookups.
+*/
+namespace Umibozu::TileDecode {
+  using Row = std::array<u8, 8>;
+
+  inline constexpr std::array<u64, 0x100> SPREAD = [] {
+    std::array<u64, 0x100> table = {};
+    for (u32 byte = 0; byte < 0x100; byte++) {
+      for (u32 bit = 0; bit < 8; bit++) {
+        if (byte & (1 << bit)) table[byte] |= u64{1} << (bit * 8);
+      }
+    }
+    return table;
+  }();
+
+  [[nodiscard]] inline Row row(u8 high_byte, u8 low_byte) {
+    const u64 pixels = SPREAD[low_byte] | (SPREAD[high_byte] << 1);
+    Row row;
+    std::memcpy(row.data(), &pixels, sizeof(row));
+    return row;
+  }
+
+  // the 16 bytes of a tile as laid out in VRAM (low, high per row) into 8 rows
+  void tile(const u8* bytes, Row* rows);
+  void tile_portable(const u8* bytes, Row* rows);
+
+  // whether tile() uses the AVX2 kernel
+  [[nodiscard]] bool accelerated();
+}  // namespace Umibozu::TileDecode
@@ -20,6 +20,10 @@ struct Timer {
   // TMA
   u8 modulo = 0x0;
 
+  // T-cycles at the single-speed rate since reset, unaffected by DIV resets -- the
+  // timebase of the cartridge clock
+  u64 clock = 0;
+
   void set_tac(const u8 value);
   void increment_div(const u8 value, bool);
   void reset_div(bool);
@@ -2,10 +2,13 @@
 
 #include <SDL3/SDL.h>
 
+#include <atomic>
+#include <thread>
 #include <unordered_map>
 
 #include "SDL3/SDL_keyboard.h"
 #include "core/gb.hpp"
+#include "core/library.hpp"
 #include "core/version.h"
 #include "imgui.h"
 #include "imgui_memory_edit.h"
@@ -23,8 +26,11 @@ struct State {
   bool ppu_info_open        = false;
   bool controls_window_open = false;
   bool memory_viewer_open   = false;
+  bool memory_heatmap_open  = false;
   bool io_info_open         = false;
   bool apu_info_open        = true;
+  bool cheats_window_open   = false;
+  bool library_open         = false;
 
   bool debug_windows_visible = false;
 
@@ -47,6 +53,10 @@ struct Settings {
     };
 
   } keybinds;
+
+  // directories the ROM library indexes, and where the index lives
+  std::vector<std::string> library_roots = {"roms"};
+  std::string library_index              = "library.idx";
 };
 
 struct Frontend {
@@ -56,12 +66,20 @@ struct Frontend {
   Settings settings;
   GB* gb                  = nullptr;
   SDL_AudioStream* stream = nullptr;
+  Umibozu::RomLibrary library;
+  bool library_loaded = false;
+
+  // scans run on their own thread over a copy of the library, swapped in once done
+  std::thread library_scanner;
+  std::atomic<bool> library_scanning = false;
+  Umibozu::RomLibrary scanned_library;
+  Umibozu::RomLibrary::ScanStats last_scan = {};
   SDL_FRect dst;
   SDL_FRect src = {
       .x = 0,
       .y = 0,
       .w = 160,
-      .h = 148,
+      .h = 144,
   };
 
   Uint32 start_ticks, end_ticks;
@@ -69,17 +87,26 @@ struct Frontend {
 
   int screenWidth, screenHeight;
 
-  char const* patterns[2] = {"*.gb", "*.gbc"};
+  char const* patterns[4]       = {"*.gb", "*.gbc", "*.gz", "*.zip"};
+  char const* patch_patterns[3] = {"*.ips", "*.bps", "*.ups"};
 
   void handle_events();
   void render_frame();
+  // hands the PPU the streaming texture's memory to draw the next frame into
+  void lock_frame_texture();
   void show_menubar();
   void show_viewport();
   void show_cpu_info();
   void show_apu_info();
   void show_memory_viewer();
+  void show_memory_heatmap();
   void show_ppu_info();
   void show_io_info();
+  void show_cheats();
+  void show_library();
+  void start_library_scan();
+  // joins a scan that has finished and takes its results; `wait` blocks for a running one
+  void finish_library_scan(bool wait);
   void dump_framebuffer();
   // void show_tile_maps();
   void show_controls_menu(bool* p_open);
@@ -1,35 +1,71 @@
 #pragma once
 #include <fstream>
-#include "common.hpp"
-#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
 #include <vector>
-struct File {
-  std::vector<u8> data;
-  u64 file_size;
-  std::string path;
-};
+
+#include "common.hpp"
 
 namespace Umibozu {
-  inline File read_file(std::string filename) {
-    std::ifstream file(filename, std::ios::binary);
+  // Read-only bytes of a file. Memory-mapped when the platform and the source allow
+  // it (regular, non-empty files); anything else -- pipes, special files, buffers
+  // built in memory -- is held in an owned buffer instead. Either way the bytes
+  // stay put for the lifetime of the object.
+  class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path);
+    explicit MappedFile(std::vector<u8> bytes);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::span<const u8> bytes() const { return {base, length}; }
+    [[nodiscard]] bool mapped() const { return mapping != nullptr; }
+
+   private:
+    const u8* base = nullptr;
+    size_t length  = 0;
+    void* mapping  = nullptr;
+    std::vector<u8> owned;
+  };
 
-    if (!file.good()) {
-      throw std::runtime_error(
-          fmt::format("io: failed to load file: {}", filename));
-    }
+  // Writable bytes of a file, resized to `size` and mapped shared, so stores reach the
+  // file without it being rewritten. Throws when the file can't be opened or mapped.
+  class SharedMapping {
+   public:
+    SharedMapping(const std::string& path, size_t size);
+    ~SharedMapping();
 
-    file.unsetf(std::ios::skipws);
-    std::streampos fileSize;
-    file.seekg(0, std::ios::end);
-    fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-    std::vector<u8> vec;
-    vec.reserve(fileSize);
+    SharedMapping(const SharedMapping&)            = delete;
+    SharedMapping& operator=(const SharedMapping&) = delete;
 
-    vec.insert(vec.begin(), std::istream_iterator<u8>(file),
-               std::istream_iterator<u8>());
+    [[nodiscard]] std::span<u8> bytes() const { return {base, length}; }
 
+    // write modified pages back now rather than whenever the kernel gets to them
+    void flush() const;
+
+   private:
+    u8* base      = nullptr;
+    size_t length = 0;
+  };
+}  // namespace Umibozu
+
+struct File {
+  std::vector<u8> data;  // owned bytes, for images built or patched in memory
+  u64 file_size;
+  std::string path;
+  std::shared_ptr<const Umibozu::MappedFile> mapping = nullptr;  // set by read_file, `data` is empty then
+
+  [[nodiscard]] std::span<const u8> bytes() const { return mapping != nullptr ? mapping->bytes() : std::span<const u8>(data); }
+};
+
+namespace Umibozu {
+  // maps `filename`; a .gz / .zip ROM is decompressed in memory instead (see archive.hpp)
+  File read_file(std::string filename);
 
-    return File{vec, static_cast<u64>(fileSize), filename};
-  }
-}  // namespace Umibozu
\ No newline at end of file
+  // replace `path` with `bytes` through <path>.tmp, synced before the rename, so readers
+  // and crashes only ever see the old file or the new one; false if any step failed
+  bool write_file_atomic(const std::string& path, std::span<const u8> bytes);
+}  // namespace Umibozu
@@ -6,6 +6,7 @@
 #include "bus.hpp"
 #include "common.hpp"
 #include "fmt/base.h"
+#include "log.hpp"
 #ifndef SYSTEM_TEST_MODE
 #include "frontend/window.hpp"
 #endif
@@ -58,7 +59,7 @@ void APU::write(IO_REG sndreg, u8 value) {
 
       if ((seq_current_step & 1) && (old_enable_bit == 0 && regs.channel_1.NR14.length_enable) && regs.channel_1.length_timer != 0) {
         regs.channel_1.length_timer--;
-        fmt::println("ticked off rising edge ch 1: {}", regs.channel_1.length_timer);
+        LOG_TRACE(APU, "ticked off rising edge ch 1: {}", regs.channel_1.length_timer);
         if (regs.channel_1.length_timer == 0) {
           regs.channel_1.channel_enabled = false;
         }
@@ -97,7 +98,7 @@ void APU::write(IO_REG sndreg, u8 value) {
 
       if ((seq_current_step & 1) && (old_enable_bit == 0 && regs.channel_2.NR24.length_enable) && regs.channel_2.length_timer != 0) {
         regs.channel_2.length_timer--;
-        fmt::println("ticked off rising edge ch 2: {}", regs.channel_2.length_timer);
+        LOG_TRACE(APU, "ticked off rising edge ch 2: {}", regs.channel_2.length_timer);
         if (regs.channel_2.length_timer == 0) {
           regs.channel_2.channel_enabled = false;
         }
@@ -133,7 +134,7 @@ void APU::write(IO_REG sndreg, u8 value) {
 
       if ((seq_current_step & 1) && (old_enable_bit == 0 && regs.channel_3.NR34.length_enable) && regs.channel_3.length_timer != 0) {
         regs.channel_3.length_timer--;
-        fmt::println("ticked off rising edge ch 3: {}", regs.channel_3.length_timer);
+        LOG_TRACE(APU, "ticked off rising edge ch 3: {}", regs.channel_3.length_timer);
         if (regs.channel_3.length_timer == 0 && (value & 1 << 7) == 0) {
           regs.channel_3.channel_enabled = false;
         }
@@ -195,7 +196,7 @@ void APU::write(IO_REG sndreg, u8 value) {
 
       if ((regs.NR52.value & (1 << 7)) == 0) {
         clear_apu_registers();
-        fmt::println("disabled APU -- clearing registers");
+        LOG_DEBUG(APU, "disabled APU -- clearing registers");
       }
 
       // rising edge on enabled bit APU resets frame sequencer
@@ -292,7 +293,7 @@ u8 APU::read(IO_REG sndreg) {
     }
 
     default: {
-      fmt::println("[APU] invalid register read: {:#04x}", (u8)sndreg);
+      LOG_WARN(APU, "invalid register read: {:#04x}", (u8)sndreg);
       return 0xFF;
     }
   }
@@ -313,7 +314,7 @@ void APU::step_seq() {
       regs.channel_1.length_timer--;
       // fmt::println("CHANNEL 1 LENGTH TIMER: {}", regs.CHANNEL_1.length_timer);
       if (regs.channel_1.length_timer == 0) {
-        fmt::println("[APU] disabled channel 1");
+        LOG_DEBUG(APU, "disabled channel 1");
         regs.channel_1.channel_enabled = false;
       }
     }
@@ -323,7 +324,7 @@ void APU::step_seq() {
       regs.channel_2.length_timer--;
       // fmt::println("CHANNEL 2 LENGTH TIMER: {}", regs.CHANNEL_2.length_timer);
       if (regs.channel_2.length_timer == 0) {
-        fmt::println("[APU] disabled channel 2");
+        LOG_DEBUG(APU, "disabled channel 2");
         regs.channel_2.channel_enabled = false;
       }
     }
@@ -333,7 +334,7 @@ void APU::step_seq() {
       regs.channel_3.length_timer--;
       // fmt::println("CHANNEL 3 LENGTH TIMER: {}", regs.CHANNEL_3.length_timer);
       if (regs.channel_3.length_timer == 0) {
-        fmt::println("[APU] disabled channel 3");
+        LOG_DEBUG(APU, "disabled channel 3");
         regs.channel_3.channel_enabled = false;
       }
     }
@@ -343,7 +344,7 @@ void APU::step_seq() {
       regs.channel_4.length_timer--;
       // fmt::println("CHANNEL 4 LENGTH TIMER: {}", regs.CHANNEL_4.length_timer);
       if (regs.channel_4.length_timer == 0) {
-        fmt::println("[APU] disabled channel 4");
+        LOG_DEBUG(APU, "disabled channel 4");
         regs.channel_4.channel_enabled = false;
       }
     }
@@ -555,7 +556,7 @@ void APU::ch1_trigger_event() {
     u32 new_frequency = calculate_sweep_freq();
 
     if (new_frequency > 2047) {
-      fmt::println("freq: {:#010x} -- disabled channel", new_frequency);
+      LOG_DEBUG(APU, "freq: {:#010x} -- disabled channel", new_frequency);
       regs.channel_1.channel_enabled = false;
     }
   }
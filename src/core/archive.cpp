@@ -0,0 +1,408 @@
+#include "archive.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include "checksum.hpp"
+#include "log.hpp"
+
+using namespace Umibozu;
+
+namespace {
+  [[noreturn]] void fail(std::string_view reason) { throw std::runtime_error(fmt::format("archive: {}", reason)); }
+
+  struct BitReader {
+    const u8* p;
+    const u8* end;
+    u64 bits    = 0;
+    int count   = 0;
+    int overrun = 0;  // zero bytes fed in past the end of the input
+
+    // top the buffer up to at least 57 bits
+    void refill() {
+      while (count <= 56) {
+        u64 byte = 0;
+        if (p < end) {
+          byte = *p++;
+        } else if (++overrun > 8) {
+          fail("deflate stream is truncated");
+        }
+        bits |= byte << count;
+        count += 8;
+      }
+    }
+
+    u32 take(int n) {
+      if (count < n) refill();
+      const u32 value = bits & ((u64{1} << n) - 1);
+      bits >>= n;
+      count -= n;
+      return value;
+    }
+
+    void consume(int n) {
+      bits >>= n;
+      count -= n;
+    }
+
+    void align() { consume(count % 8); }
+  };
+
+  constexpr int FAST_BITS = 10;
+
+  struct Huffman {
+    std::array<u16, 1 << FAST_BITS> fast;  // symbol << 4 | length, 0 when the code is longer
+    std::array<u16, 16> counts;            // codes per length
+    std::array<u16, 288> symbols;          // in canonical order
+
+    void build(const u8* lengths, int n) {
+      counts.fill(0);
+      fast.fill(0);
+      for (int i = 0; i < n; i++) {
+        counts[lengths[i]]++;
+      }
+      counts[0] = 0;
+
+      // over-subscribed sets can't be decoded; incomplete ones are allowed (single distance codes)
+      int left = 1;
+      for (int length = 1; length < 16; length++) {
+        left = (left << 1) - counts[length];
+        if (left < 0) fail("invalid Huffman code lengths");
+      }
+
+      std::array<u16, 16> offsets = {};
+      std::array<u16, 16> next_code = {};
+      for (int length = 1, code = 0; length < 16; length++) {
+        offsets[length]   = offsets[length - 1] + counts[length - 1];
+        code              = (code + counts[length - 1]) << 1;
+        next_code[length] = code;
+      }
+      offsets[0] = 0;
+
+      std::array<u16, 16> fill = offsets;
+      for (int symbol = 0; symbol < n; symbol++) {
+        const int length = lengths[symbol];
+        if (length == 0) continue;
+        symbols[fill[length]++] = symbol;
+
+        const u32 code = next_code[length]++;
+        if (length > FAST_BITS) continue;
+
+        // codes are stored MSB first but read LSB first -- index by the reversed code
+        u32 reversed = 0;
+        for (int bit = 0; bit < length; bit++) {
+          reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+        }
+        for (u32 index = reversed; index < fast.size(); index += 1u << length) {
+          fast[index] = (symbol << 4) | length;
+        }
+      }
+    }
+
+    int decode(BitReader& in) const {
+      if (in.count < 15) in.refill();
+
+      const u16 entry = fast[in.bits & ((1 << FAST_BITS) - 1)];
+      if (entry != 0) {
+        in.consume(entry & 0xF);
+        return entry >> 4;
+      }
+
+      // canonical walk for codes longer than the table
+      int code = 0, first = 0, index = 0;
+      for (int length = 1; length < 16; length++) {
+        code |= in.take(1);
+        const int count = counts[length];
+        if (code - first < count) return symbols[index + code - first];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+      }
+      fail("invalid Huffman code");
+    }
+  };
+
+  constexpr std::array<u16, 29> LENGTH_BASE = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  constexpr std::array<u8, 29> LENGTH_EXTRA = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  constexpr std::array<u16, 30> DISTANCE_BASE = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  constexpr std::array<u8, 30> DISTANCE_EXTRA = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+  constexpr std::array<u8, 19> CODE_LENGTH_ORDER = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+  // grows by doubling, but never past `limit`: a stream inflating to more than the
+  // archive declared fails right there instead of after exhausting memory
+  struct Output {
+    std::vector<u8> bytes;
+    size_t size  = 0;
+    size_t limit = SIZE_MAX;
+
+    void reserve(size_t extra) {
+      if (extra > limit - size) fail("inflates past the declared size");
+      if (size + extra > bytes.size()) bytes.resize(std::min(limit, std::max(bytes.size() * 2, size + extra)));
+    }
+  };
+
+  void inflate_block(BitReader& in, Output& out, const Huffman& literals, const Huffman& distances) {
+    while (true) {
+      const int symbol = literals.decode(in);
+
+      if (symbol < 256) {
+        out.reserve(1);
+        out.bytes[out.size++] = symbol;
+        continue;
+      }
+      if (symbol == 256) return;
+      if (symbol > 285) fail("invalid length code");
+
+      const u32 length        = LENGTH_BASE[symbol - 257] + in.take(LENGTH_EXTRA[symbol - 257]);
+      const int distance_code = distances.decode(in);
+      if (distance_code >= 30) fail("invalid distance code");
+      const u32 distance = DISTANCE_BASE[distance_code] + in.take(DISTANCE_EXTRA[distance_code]);
+      if (distance > out.size) fail("distance reaches before the start of the output");
+
+      // byte by byte: the source may overlap what is being written
+      out.reserve(length);
+      u8* to         = out.bytes.data() + out.size;
+      const u8* from = to - distance;
+      for (u32 i = 0; i < length; i++) {
+        to[i] = from[i];
+      }
+      out.size += length;
+    }
+  }
+
+  void read_dynamic_tables(BitReader& in, Huffman& literals, Huffman& distances) {
+    const int literal_count  = in.take(5) + 257;
+    const int distance_count = in.take(5) + 1;
+    const int code_count     = in.take(4) + 4;
+
+    std::array<u8, 19> code_lengths = {};
+    for (int i = 0; i < code_count; i++) {
+      code_lengths[CODE_LENGTH_ORDER[i]] = in.take(3);
+    }
+    Huffman code_lengths_code;
+    code_lengths_code.build(code_lengths.data(), 19);
+
+    std::array<u8, 286 + 30> lengths = {};
+    for (int i = 0; i < literal_count + distance_count;) {
+      const int symbol = code_lengths_code.decode(in);
+      int repeat       = 1;
+      u8 value         = 0;
+
+      switch (symbol) {
+        case 16: {
+          if (i == 0) fail("length repeat with nothing to repeat");
+          value  = lengths[i - 1];
+          repeat = 3 + in.take(2);
+          break;
+        }
+        case 17: {
+          repeat = 3 + in.take(3);
+          break;
+        }
+        case 18: {
+          repeat = 11 + in.take(7);
+          break;
+        }
+        default: {
+          value = symbol;
+          break;
+        }
+      }
+
+      if (i + repeat > literal_count + distance_count) fail("code lengths overflow the table");
+      std::fill_n(lengths.begin() + i, repeat, value);
+      i += repeat;
+    }
+
+    literals.build(lengths.data(), literal_count);
+    distances.build(lengths.data() + literal_count, distance_count);
+  }
+
+  u16 le16(std::span<const u8> bytes, size_t at) {
+    if (at + 2 > bytes.size()) fail("truncated header");
+    return bytes[at] | (bytes[at + 1] << 8);
+  }
+
+  u32 le32(std::span<const u8> bytes, size_t at) {
+    if (at + 4 > bytes.size()) fail("truncated header");
+    return le16(bytes, at) | ((u32)le16(bytes, at + 2) << 16);
+  }
+
+  bool is_rom_name(std::string_view name) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower.ends_with(".gb") || lower.ends_with(".gbc");
+  }
+
+  std::vector<u8> gunzip(std::span<const u8> archive, std::string* entry_name) {
+    if (archive.size() < 18 || archive[2] != 8) fail("not a deflate gzip stream");
+
+    const u8 flags = archive[3];
+    size_t at      = 10;
+    if (flags & 0x04) at += 2 + le16(archive, at);  // FEXTRA
+    if (flags & 0x08) {                             // FNAME
+      const size_t start = at;
+      while (at < archive.size() && archive[at] != 0) at++;
+      if (entry_name != nullptr) *entry_name = std::string(archive.begin() + start, archive.begin() + at);
+      at++;
+    }
+    if (flags & 0x10) {  // FCOMMENT
+      while (at < archive.size() && archive[at] != 0) at++;
+      at++;
+    }
+    if (flags & 0x02) at += 2;  // FHCRC
+    if (at + 8 > archive.size()) fail("truncated gzip header");
+
+    const u32 crc  = le32(archive, archive.size() - 8);
+    const u32 size = le32(archive, archive.size() - 4);  // modulo 2^32, plenty for a ROM
+    if (size > Archive::MAX_ROM_SIZE) fail("gzip declares more than any ROM holds");
+
+    std::vector<u8> rom = Archive::inflate(archive.subspan(at, archive.size() - 8 - at), size);
+    if (rom.size() != size || Checksum::crc32(rom) != crc) fail("gzip CRC mismatch");
+    return rom;
+  }
+
+  std::vector<u8> unzip_rom(std::span<const u8> archive, std::string* entry_name) {
+    // end of central directory: the last "PK\5\6" within the comment's reach of the end
+    if (archive.size() < 22) fail("zip has no central directory");
+    size_t eocd = archive.size() - 22;
+    while (le32(archive, eocd) != 0x06054B50) {
+      if (eocd == 0 || archive.size() - eocd > 22 + 0xFFFF) fail("zip has no central directory");
+      eocd--;
+    }
+
+    const u16 entries = le16(archive, eocd + 10);
+    size_t at         = le32(archive, eocd + 16);
+
+    for (u16 i = 0; i < entries; i++) {
+      if (le32(archive, at) != 0x02014B50) fail("damaged zip central directory");
+
+      const u16 method            = le16(archive, at + 10);
+      const u32 crc               = le32(archive, at + 16);
+      const u32 compressed_size   = le32(archive, at + 20);
+      const u32 size              = le32(archive, at + 24);
+      const u16 name_length       = le16(archive, at + 28);
+      const size_t local_header   = le32(archive, at + 42);
+      if (at + 46 + name_length > archive.size()) fail("damaged zip central directory");
+      const std::string_view name(reinterpret_cast<const char*>(archive.data()) + at + 46, name_length);
+      at += 46 + name_length + le16(archive, at + 30) + le16(archive, at + 32);
+
+      if (!is_rom_name(name)) continue;
+      if (size == 0xFFFFFFFF || compressed_size == 0xFFFFFFFF) fail("zip64 archives are not supported");
+      if (size > Archive::MAX_ROM_SIZE) fail(fmt::format("{}: declares more than any ROM holds", name));
+      if (le32(archive, local_header) != 0x04034B50) fail("damaged zip local header");
+
+      const size_t data = local_header + 30 + le16(archive, local_header + 26) + le16(archive, local_header + 28);
+      if (data + compressed_size > archive.size()) fail("zip entry runs past the end of the archive");
+      const std::span<const u8> stored = archive.subspan(data, compressed_size);
+
+      std::vector<u8> rom;
+      if (method == 0) {
+        rom.assign(stored.begin(), stored.end());
+      } else if (method == 8) {
+        rom = Archive::inflate(stored, size);
+      } else {
+        fail(fmt::format("{}: unsupported compression method {}", name, method));
+      }
+
+      if (rom.size() != size || Checksum::crc32(rom) != crc) fail(fmt::format("{}: CRC mismatch", name));
+      if (entry_name != nullptr) *entry_name = name;
+      return rom;
+    }
+
+    fail("zip has no .gb or .gbc entry");
+  }
+}  // namespace
+
+Archive::FORMAT Archive::detect(std::string_view path, std::span<const u8> bytes) {
+  std::string lower(path);
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+  if (lower.ends_with(".gz") && bytes.size() >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) return FORMAT::GZIP;
+  if (lower.ends_with(".zip") && bytes.size() >= 4 && le32(bytes, 0) == 0x04034B50) return FORMAT::ZIP;
+  return FORMAT::NONE;
+}
+
+std::vector<u8> Archive::extract_rom(std::span<const u8> archive, FORMAT format, std::string* entry_name) {
+  switch (format) {
+    case FORMAT::GZIP: {
+      return gunzip(archive, entry_name);
+    }
+    case FORMAT::ZIP: {
+      return unzip_rom(archive, entry_name);
+    }
+    case FORMAT::NONE: {
+      break;
+    }
+  }
+  return {archive.begin(), archive.end()};
+}
+
+std::vector<u8> Archive::inflate(std::span<const u8> deflate, size_t limit) {
+  BitReader in{deflate.data(), deflate.data() + deflate.size()};
+  Output out;
+  out.limit = limit;
+  out.bytes.resize(limit == SIZE_MAX ? 0x1000 : std::min(limit, MAX_ROM_SIZE));
+
+  static const auto fixed = [] {
+    std::array<Huffman, 2> tables;
+    std::array<u8, 288> lengths;
+    std::fill_n(lengths.begin(), 144, 8);
+    std::fill_n(lengths.begin() + 144, 112, 9);
+    std::fill_n(lengths.begin() + 256, 24, 7);
+    std::fill_n(lengths.begin() + 280, 8, 8);
+    tables[0].build(lengths.data(), 288);
+    std::fill_n(lengths.begin(), 30, 5);
+    tables[1].build(lengths.data(), 30);
+    return tables;
+  }();
+
+  Huffman literals;
+  Huffman distances;
+  bool last = false;
+
+  while (!last) {
+    last = in.take(1);
+
+    switch (in.take(2)) {
+      case 0: {  // stored
+        in.align();
+        const u16 length = in.take(16);
+        if ((u16)~in.take(16) != length) fail("stored block length mismatch");
+
+        out.reserve(length);
+        u32 copied = 0;
+        for (; copied < length && in.count > in.overrun * 8; copied++) {
+          out.bytes[out.size++] = in.take(8);
+        }
+        // the rest straight from the input once the bit buffer holds no more real bytes
+        const u32 rest = length - copied;
+        if (rest > (size_t)(in.end - in.p)) fail("stored block runs past the end");
+        std::memcpy(out.bytes.data() + out.size, in.p, rest);
+        in.p += rest;
+        out.size += rest;
+        break;
+      }
+      case 1: {
+        inflate_block(in, out, fixed[0], fixed[1]);
+        break;
+      }
+      case 2: {
+        read_dynamic_tables(in, literals, distances);
+        inflate_block(in, out, literals, distances);
+        break;
+      }
+      default: {
+        fail("invalid deflate block type");
+      }
+    }
+  }
+
+  if (in.count < in.overrun * 8) fail("deflate stream is truncated");
+
+  out.bytes.resize(out.size);
+  return std::move(out.bytes);
+}
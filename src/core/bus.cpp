@@ -1,10 +1,13 @@
 #include "core/bus.hpp"
 
+#include <cstring>
 #include <string>
 
 #include "common.hpp"
 #include "fmt/base.h"
 #include "io_defs.hpp"
+#include "log.hpp"
+#include "mappers.hpp"
 #include "ppu.hpp"
 
 void Bus::request_interrupt(INTERRUPT_TYPE t) { io[IF] |= (1 << (u8)t); }
@@ -50,457 +53,361 @@ bool Bus::should_raise_ly_lyc() const {
   return ly_interrupt_enabled && (io[LYC] == io[LY]);
 };
 
-u8 Bus::io_read(const u16 address) {
-  u8 io_addr = (address - 0xFF00);
+namespace {
+  // -- reads --------------------------------------------------------------------
 
-  if ((address - 0xFF00) >= 0x30 && (address - 0xFF00) <= 0x3F) {
-    // fmt::println("WAVE RAM READ");
-    return wave_ram.at(address - 0xFF30);
-  }
+  u8 read_open_bus(Bus&, u8) { return 0xFF; }
 
-  if (io_addr >= 0x10 && io_addr <= 0x2F) {
-    u8 result = apu->read(static_cast<IO_REG>(address - 0xFF00));
-    // fmt::println("APU read from: {} -> {:#02X}", get_label(address), result);
-    return result;
-  }
+  u8 read_wave_ram(Bus& bus, u8 reg) { return bus.wave_ram[reg - 0x30]; }
 
-  switch (address - 0xFF00) {
-    case HDMA1:
-    case HDMA2:
-    case HDMA3:
-    case HDMA4: {
-      fmt::println("[R] HDMA read");
-      break;
-    }
+  u8 read_apu(Bus& bus, u8 reg) { return bus.apu->read(static_cast<IO_REG>(reg)); }
 
-    case JOYPAD: {
-      switch ((io[JOYPAD] & 0x30) >> 4) {
-        case 0x1: {
-          return joypad.get_buttons();
-        }
-        case 0x2: {
-          return joypad.get_dpad();
-        }
-        case 0x3: {
-          return 0xF;
-        }
-        default: {
-          fmt::println("[JOYPAD] bad method bits");
-          assert(false);
-        }
+  u8 read_joypad(Bus& bus, u8) {
+    switch ((bus.io[JOYPAD] & 0x30) >> 4) {
+      case 0x1: {
+        return bus.joypad.get_buttons();
       }
-
-      break;
-    }
-    case DIV: {
-      return timer->get_div();
-    }
-    case TIMA: {
-      return timer->counter;
-    }
-    case TMA: {
-      return timer->modulo;
-    }
-    case LY: {
-      if (ppu->lcdc.lcd_ppu_enable == 0) {
-        // fmt::println(("reading LY when screen off"));
-        return 0;
+      case 0x2: {
+        return bus.joypad.get_dpad();
+      }
+      case 0x3: {
+        return 0xF;
+      }
+      default: {
+        LOG_ERROR(BUS, "joypad: bad method bits");
+        assert(false);
+        return bus.io[JOYPAD];
       }
-      return io[LY];
     }
+  }
 
-    case LCDC: {
-      return ppu->lcdc.value;
-    }
+  u8 read_div(Bus& bus, u8) { return bus.timer->get_div(); }
+  u8 read_tima(Bus& bus, u8) { return bus.timer->counter; }
+  u8 read_tma(Bus& bus, u8) { return bus.timer->modulo; }
+  u8 read_lcdc(Bus& bus, u8) { return bus.ppu->lcdc.value; }
 
-    case 0x27:
-    case 0x28:
-    case 0x29:
-    case 0x2A:
-    case 0x2B:
-    case 0x2C:
-    case 0x2D:
-    case 0x2E:
-    case 0x2F: {  // Audio has the range 0xFF10 to 0xFF30 however everything after
-                  // FF26 is not mapped to anything.
-      return 0xFF;
-    }
-    case STAT: {
-      if (ppu->lcdc.lcd_ppu_enable == 0) {
-        fmt::println("PPU is off, returning 0 in read");
-        io[LY] = 0;
-        return 0 | (1 << 7);
-      }
-      break;
-    }
-    case SVBK: {
-      // fmt::println("SVBK: {:#04x}", io[SVBK]);
-      break;
-    }
-    case VBK: {
-      // fmt::println("VBK: {:#04x}", io[VBK]);
-      break;
+  u8 read_ly(Bus& bus, u8) {
+    if (bus.ppu->lcdc.lcd_ppu_enable == 0) return 0;
+    return bus.io[LY];
+  }
+
+  u8 read_stat(Bus& bus, u8) {
+    if (bus.ppu->lcdc.lcd_ppu_enable == 0) {
+      LOG_TRACE(PPU, "PPU is off, returning 0 in read");
+      bus.io[LY] = 0;
+      return 0 | (1 << 7);
     }
-    case KEY1: {
-      if (mode == SYSTEM_MODE::DMG) return 0xFF;
+    return bus.io[STAT];
+  }
 
-      u8 speed = double_speed_mode ? 0x80 : 0;
+  u8 read_key1(Bus& bus, u8) {
+    u8 speed = bus.double_speed_mode ? 0x80 : 0;
+    return speed | (bus.io[KEY1] & 1);
+  }
 
-      // fmt::println("returning key1: {:08b}", (static_cast<u8>(speed)) | (io[KEY1] & 1));
-      return (static_cast<u8>(speed)) | (io[KEY1] & 1);
-    }
-    case HDMA5: {
-      fmt::println("HDMA5 read: {:08b}", io[HDMA5]);
-      break;
+  // -- writes -------------------------------------------------------------------
+
+  void write_ignored(Bus&, u8, u8) {}
+
+  void write_wave_ram(Bus& bus, u8 reg, u8 value) { bus.wave_ram[reg - 0x30] = value; }
+
+  void write_apu(Bus& bus, u8 reg, u8 value) { bus.apu->write(static_cast<IO_REG>(reg), value); }
+
+  void write_joypad(Bus& bus, u8, u8 value) {
+    // neither buttons nor d-pad selected
+    bus.io[JOYPAD] = value == 0x30 ? 0xFF : value;
+  }
+
+  void write_sc(Bus& bus, u8, u8 value) {
+    if (value == 0x01) {
+      LOG_DEBUG(BUS, "serial transfer completed");
+      bus.request_interrupt(INTERRUPT_TYPE::SERIAL);
     }
+    bus.io[SC] = value;
   }
 
-  return io.at(address - 0xFF00);
-}
+  void write_div(Bus& bus, u8, u8 value) {
+    bus.timer->reset_div(bus.double_speed_mode);
+    bus.io[DIV] = value;
+  }
 
-void Bus::io_write(const u16 address, const u8 value) {
-  // fmt::println("[W] {:010X} - {}", address, get_label(address));
-  u8 io_addr = (address - 0xFF00);
+  void write_tima(Bus& bus, u8, u8 value) {
+    bus.timer->overflow_update_queued = false;
+    bus.timer->counter                = value;
+    bus.io[TIMA]                      = value;
+  }
 
-  // wave ram
-  if (io_addr >= 0x30 && io_addr <= 0x3F) {
-    // fmt::println("WAVE RAM WRITE");
-    wave_ram.at(io_addr - 0x30) = value;
-    return;
+  void write_tma(Bus& bus, u8, u8 value) {
+    bus.timer->modulo = value;
+    bus.io[TMA]       = value;
   }
 
-  // apu registers
-  if (io_addr >= 0x10 && io_addr <= 0x2F) {
-    // fmt::println("APU write to: {:#04X} [{}] -> {:#02X}", address, get_label(address), value);
-    return apu->write(static_cast<IO_REG>(io_addr), value);
+  void write_tac(Bus& bus, u8, u8 value) {
+    bus.timer->set_tac(value);
+    bus.io[TAC] = value;
   }
 
-  switch (io_addr) {
-    case JOYPAD: {
-      if (value == 0x30) {  // BUTTONS NOR D-PAD SELECTED
-        io[JOYPAD] = 0xFF;
-        return;
-      }
-      break;
-    }
-    case SC: {
-      // DEPRECATED: doesn't have much use except for logging; remove when color
-      // is implemented & working
-      if (value == 0x81) {
-        // serial_port_buffer[serial_port_index++] =
-        // wram[SB]; std::string str_data(serial_port_buffer,
-        // SERIAL_PORT_BUFFER_SIZE); fmt::println("serial data: {}", str_data);
-      }
-      if (value == 0x01) {
-        fmt::println("transfer completed");
-        request_interrupt(INTERRUPT_TYPE::SERIAL);
-      }
-      break;
-    }
-    case DIV: {
-      timer->reset_div(double_speed_mode);
-      break;
-    }
-    case TIMA: {
-      if (timer->overflow_update_queued) {
-        timer->overflow_update_queued = false;
-      }
-      timer->counter = value;
+  void write_lcdc(Bus& bus, u8, u8 value) {
+    bus.ppu->lcdc.value = value;
+    bus.io[LCDC]        = value;
+  }
 
-      break;
-    }
-    case TMA: {
-      timer->modulo = value;
-      break;
-    }
-    case TAC: {
-      timer->set_tac(value);
-      break;
+  void write_stat(Bus& bus, u8, u8 value) {
+    LOG_TRACE(BUS, "STAT: {:08b} - {:#04X}", value, value);
+    bool old_hidden_stat = bus.hidden_stat;
+
+    bus.io[STAT] = (value & 0x78) + (u8)bus.ppu->get_mode();
+    bus.update_hidden_stat();
+
+    if (old_hidden_stat == 0 && bus.hidden_stat == 1) {
+      bus.request_interrupt(INTERRUPT_TYPE::LCD);
     }
-    case LCDC: {
-      // if ((io[LCDC] & 0x80) == 0 && (value & 0x80)) {  // PPU goes from off to on
-      //   io[LY] = 0;
-      //   ppu->dots   = 4;
-      // }
-      // if ((io[LCDC] & 0x80) && (value & 0x80) == 0) {
-      //   // LCDC turned off, latch LY=LYC
-      //   ppu->ly_is_lyc_latch = io[LY] == io[LYC];
-      // }
-      ppu->lcdc.value = value;
-      break;
+  }
+
+  void write_lyc(Bus& bus, u8, u8 value) {
+    bool old_hidden_stat = bus.hidden_stat;
+
+    bus.io[LYC] = value;
+    bus.update_hidden_stat();
+
+    if (old_hidden_stat == 0 && bus.hidden_stat == 1) {
+      bus.request_interrupt(INTERRUPT_TYPE::LCD);
     }
-    case STAT: {
-      fmt::println("STAT: {:08b} - {:#04X}", value, value);
-      u8 read_only_bits = value & 0x78;
+  }
 
-      bool old_hidden_stat = hidden_stat;
+  void write_dma(Bus& bus, u8, u8 value) {
+    bus.io[DMA] = value;
+    bus.start_oam_dma(value);
+  }
 
-      io[STAT] = read_only_bits + (u8)ppu->get_mode();
+  // BGP / OBP0 / OBP1 -- colour 0 of every DMG palette is always shade 0
+  void write_dmg_palette(Bus& bus, u8 reg, u8 value) {
+    Palette& palette = reg == BGP ? bus.ppu->DMG_BGP[0] : bus.ppu->DMG_OBP[reg - OBP0];
 
-      update_hidden_stat();
+    palette[0] = bus.ppu->shade_table[0];
+    palette[1] = bus.ppu->shade_table[(value & 0b00001100) >> 2];
+    palette[2] = bus.ppu->shade_table[(value & 0b00110000) >> 4];
+    palette[3] = bus.ppu->shade_table[(value & 0b11000000) >> 6];
 
-      if (old_hidden_stat == 0 && hidden_stat == 1) {
-        request_interrupt(INTERRUPT_TYPE::LCD);
-      }
+    bus.io[reg] = value;
+  }
 
-      return;
-    }
-    case LY: {  // read only
-      return;
-    }
-    case LYC: {
-      bool old_hidden_stat = hidden_stat;
+  // GBC-only IO
 
-      io[LYC] = value;
+  void write_vbk(Bus& bus, u8, u8 value) {
+    bus.vbk  = (value & 0x1);
+    bus.vram = &bus.vram_banks[bus.vbk];
+    bus.map_vram();
 
-      update_hidden_stat();
+    bus.io[VBK] = 0xFE + bus.vbk;
+  }
 
-      if (old_hidden_stat == 0 && hidden_stat == 1) {
-        request_interrupt(INTERRUPT_TYPE::LCD);
-      }
+  void write_svbk(Bus& bus, u8, u8 value) {
+    bus.svbk = (value & 0x7);
+    if (bus.svbk == 0) bus.svbk = 1;
 
-      break;
-    }
-    case DMA: {
-      u16 address = (value << 8);
-      // fmt::println("executing DMA");
-      for (size_t i = 0; i < 0xA0; i++) {
-        oam.at(i) = read8(address + i);
-      }
-      break;
-    }
-    case BGP: {
-      // if (mode == SYSTEM_MODE::CGB) {
-      //   return;
-      // }
-      // fmt::println("OBP0 write: {:08b}", value);
-      u8 id_0 = 0;
-      u8 id_1 = (value & 0b00001100) >> 2;
-      u8 id_2 = (value & 0b00110000) >> 4;
-      u8 id_3 = (value & 0b11000000) >> 6;
-
-      ppu->DMG_BGP[0][0] = ppu->shade_table[id_0];
-      ppu->DMG_BGP[0][1] = ppu->shade_table[id_1];
-      ppu->DMG_BGP[0][2] = ppu->shade_table[id_2];
-      ppu->DMG_BGP[0][3] = ppu->shade_table[id_3];
-      break;
-    }
-    case OBP0: {
-      // if (mode == SYSTEM_MODE::CGB) {
-      //   return;
-      // }
-      // fmt::println("OBP0 write: {:08b}", value);
-      u8 id_0 = 0;
-      u8 id_1 = (value & 0b00001100) >> 2;
-      u8 id_2 = (value & 0b00110000) >> 4;
-      u8 id_3 = (value & 0b11000000) >> 6;
-
-      ppu->DMG_OBP[0][0] = ppu->shade_table[id_0];
-      ppu->DMG_OBP[0][1] = ppu->shade_table[id_1];
-      ppu->DMG_OBP[0][2] = ppu->shade_table[id_2];
-      ppu->DMG_OBP[0][3] = ppu->shade_table[id_3];
-      break;
-    }
-    case OBP1: {
-      // if (mode == SYSTEM_MODE::CGB) {
-      //   return;
-      // }
-      u8 id_0 = 0;
-      u8 id_1 = (value & 0b00001100) >> 2;
-      u8 id_2 = (value & 0b00110000) >> 4;
-      u8 id_3 = (value & 0b11000000) >> 6;
-
-      ppu->DMG_OBP[1][0] = ppu->shade_table[id_0];
-      ppu->DMG_OBP[1][1] = ppu->shade_table[id_1];
-      ppu->DMG_OBP[1][2] = ppu->shade_table[id_2];
-      ppu->DMG_OBP[1][3] = ppu->shade_table[id_3];
-      break;
-    }
-    // GBC-only IO
-    case VBK: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
+    bus.wram = &bus.wram_banks[bus.svbk];
+    bus.map_wram();
 
-      vbk  = (value & 0x1);
-      vram = &vram_banks.at(vbk);
+    bus.io[SVBK] = 0xF8 + bus.svbk;
+  }
 
-      io[VBK] = 0xFE + vbk;
-      return;
-    }
-    case SVBK: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
+  void write_key1(Bus& bus, u8, u8) { bus.io[KEY1] |= 1; }
 
-      svbk = (value & 0x7);
-      if (svbk == 0) {
-        svbk = 1;
-      }
+  void write_hdma5(Bus& bus, u8, u8 value) {
+    LOG_DEBUG(DMA, "HDMA5 write: {:08b} (was {:08b})", value, bus.io[HDMA5]);
 
-      wram = &wram_banks.at(svbk);
+    bool dma_is_active    = (bus.io[HDMA5] & 0x80) == 0;
+    bool cancel_requested = (value & 0x80) == 0;
 
-      io[SVBK] = 0xF8 + svbk;
+    if (dma_is_active && cancel_requested) {
+      LOG_DEBUG(DMA, "HDMA terminated early");
+      bus.io[HDMA5] = value;
+      bus.terminate_hdma();
       return;
     }
-    case KEY1: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
 
-      io[KEY1] |= 1;
+    bool is_hdma = ((value & (1 << 7)) != 0);
+
+    u16 length = (1 + (value & 0x7f)) * 0x10;
+    u16 src    = ((bus.io[HDMA1] << 8) + bus.io[HDMA2]) & 0xfff0;
+    u16 dst    = ((bus.io[HDMA3] << 8) + bus.io[HDMA4]) & 0x1ff0;
 
+    LOG_DEBUG(DMA, "{}DMA src: {:#06x} dst: {:#06x} length: {:#x}", is_hdma ? "H" : "G", src, VRAM_ADDRESS_OFFSET + dst, length);
+
+    if (is_hdma) {
+      bus.init_hdma(length);
       return;
     }
-    case HDMA1: {
-      fmt::println("HDMA1: {:#010x}", value);
-      break;
-    }
-    case HDMA2: {
-      fmt::println("HDMA2: {:#010x}", value);
-      break;
-    }
-    case HDMA3: {
-      fmt::println("HDMA3: {:#010x}", value);
-      break;
-    }
-    case HDMA4: {
-      fmt::println("HDMA4: {:#010x}", value);
-      break;
+
+    // GDMA -- the CPU is held until every block has been copied
+    bus.io[HDMA5] = (length / 0x10) - 1;
+    while (bus.vram_dma_block()) {
     }
-    case HDMA5: {
-      if (mode != SYSTEM_MODE::CGB) return;
-      fmt::println("HDMA VALUE PRE-WRITE: {:08b}", io[HDMA5]);
-      fmt::println("writing HDMA5 -- {:08b}", value);
-
-      // fmt::println("[(G/H)DMA] initiatied with value: {:#08b}", value);
-      bool dma_is_active    = (io[HDMA5] & 0x80) == 0;  // hdma is active
-      bool cancel_requested = (value & 0x80) == 0;
-
-      if (dma_is_active && cancel_requested) {
-        fmt::println("[HDMA] terminated HDMA early");
-        io[HDMA5] = value;
-        terminate_hdma();
-        return;
-      }
+  }
 
-      bool is_hdma = ((value & (1 << 7)) != 0);
+  // BCPD / OCPD: store through the auto-incrementing index, then rebuild the palettes
+  void write_cgb_palette_data(Bus& bus, u8 reg, u8 value) {
+    const bool obj              = reg == OCPD;
+    PaletteSpecification& index = obj ? bus.ocps : bus.bcps;
+    std::array<u8, 0x40>& ram   = obj ? bus.obj_palette_ram : bus.bg_palette_ram;
+    std::array<Palette, 8>& out = obj ? bus.ppu->CGB_OBP : bus.ppu->CGB_BGP;
 
-      u16 length = (1 + (value & 0x7f)) * 0x10;
-      u16 src    = ((io[HDMA1] << 8) + io[HDMA2]) & 0xfff0;
-      u16 dst    = ((io[HDMA3] << 8) + io[HDMA4]) & 0x1ff0;
+    ram[index.address] = value;
+    if (index.auto_increment) index.address++;
 
-      fmt::println("[{}DMA] src:     {:#16x}", is_hdma ? "H" : "G", src);
-      fmt::println("[{}DMA] dst:     {:#16x} ({:#04x})", is_hdma ? "H" : "G", dst, VRAM_ADDRESS_OFFSET + dst);
-      fmt::println("[{}DMA] length:  {:#16x}", is_hdma ? "H" : "G", length);
+    for (size_t palette_id = 0; palette_id < 8; palette_id++) {
+      for (size_t color = 0; color < 4; color++) {
+        u8 p_low  = ram[(palette_id * 8) + (color * 2) + 0];
+        u8 p_high = ram[(palette_id * 8) + (color * 2) + 1];
 
-      if (!is_hdma) {  // GDMA
-        for (size_t index = 0; index < length; index++) {
-          u16 src_address = (src + index);
-          u8 src_data     = mapper->read8(src_address);
+        out[palette_id][color] = (p_high << 8) + p_low;
+      }
+    }
 
-          u16 vram_address = ((dst + index));
+    bus.io[reg] = value;
+  }
 
-          if (vram_address > 0x1FFF) {
-            // fmt::println("[GDMA] skipped GDMA");
-            io[HDMA5] = 0xFF;
-            exit(-1);
-            return;
-          }
-          fmt::println("[GDMA] addr: {:#16x} data: {:#04x} -> VRAM ADDRESS: {:#16x} ", src_address, src_data, 0x8000 + vram_address);
+  void write_bcps(Bus& bus, u8, u8 value) {
+    bus.bcps.v   = value;
+    bus.io[BCPS] = value;
+  }
 
-          vram->at(vram_address) = src_data;
-        }
-        fmt::println("[GDMA] complete");
-        src += length;
-        dst += length;
-
-        io[HDMA1] = (src >> 8);
-        io[HDMA2] = (src & 0xFF);
-        io[HDMA3] = (dst >> 8);
-        io[HDMA4] = (dst & 0xF0);
-        io[HDMA5] = 0xFF;
-        return;
-      } else {  // hblank dma
-        init_hdma(length);
+  void write_ocps(Bus& bus, u8, u8 value) {
+    bus.ocps.v   = value;
+    bus.io[OCPS] = value;
+  }
+}  // namespace
 
-        return;
-      }
-      break;
+void Bus::init_io_handlers() {
+  io_read_table  = {};
+  io_write_table = {};
+
+  // 0xFF10 - 0xFF26 is the APU, FF27 - FF2F is unmapped
+  for (u8 reg = 0x10; reg <= 0x2F; reg++) {
+    io_read_table[reg]  = read_apu;
+    io_write_table[reg] = write_apu;
+  }
+  for (u8 reg = 0x30; reg <= 0x3F; reg++) {
+    io_read_table[reg]  = read_wave_ram;
+    io_write_table[reg] = write_wave_ram;
+  }
+
+  io_read_table[JOYPAD] = read_joypad;
+  io_read_table[DIV]    = read_div;
+  io_read_table[TIMA]   = read_tima;
+  io_read_table[TMA]    = read_tma;
+  io_read_table[LCDC]   = read_lcdc;
+  io_read_table[STAT]   = read_stat;
+  io_read_table[LY]     = read_ly;
+
+  io_write_table[JOYPAD] = write_joypad;
+  io_write_table[SC]     = write_sc;
+  io_write_table[DIV]    = write_div;
+  io_write_table[TIMA]   = write_tima;
+  io_write_table[TMA]    = write_tma;
+  io_write_table[TAC]    = write_tac;
+  io_write_table[LCDC]   = write_lcdc;
+  io_write_table[STAT]   = write_stat;
+  io_write_table[LY]     = write_ignored;  // read only
+  io_write_table[LYC]    = write_lyc;
+  io_write_table[DMA]    = write_dma;
+  io_write_table[BGP]    = write_dmg_palette;
+  io_write_table[OBP0]   = write_dmg_palette;
+  io_write_table[OBP1]   = write_dmg_palette;
+
+  // GBC-only IO: open bus / ignored on DMG, so the handlers never check the mode
+  constexpr u8 CGB_REGISTERS[] = {KEY1, VBK, HDMA1, HDMA2, HDMA3, HDMA4, HDMA5, BCPS, BCPD, OCPS, OCPD, SVBK};
+
+  if (mode != SYSTEM_MODE::CGB) {
+    for (u8 reg : CGB_REGISTERS) {
+      io_read_table[reg]  = read_open_bus;
+      io_write_table[reg] = write_ignored;
     }
+    return;
+  }
 
-    case BCPS: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
+  io_read_table[KEY1] = read_key1;
 
-      bcps.v = value;
+  io_write_table[KEY1]  = write_key1;
+  io_write_table[VBK]   = write_vbk;
+  io_write_table[SVBK]  = write_svbk;
+  io_write_table[HDMA5] = write_hdma5;
+  io_write_table[BCPS]  = write_bcps;
+  io_write_table[BCPD]  = write_cgb_palette_data;
+  io_write_table[OCPS]  = write_ocps;
+  io_write_table[OCPD]  = write_cgb_palette_data;
+}
 
-      break;
-    }
-    case BCPD: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
-      bg_palette_ram[bcps.address] = value;
+u8 Bus::io_read(const u16 address) {
+  const u8 reg = address & 0xFF;
 
-      if (bcps.auto_increment) {
-        bcps.address++;
-      }
+  if (const IoRead handler = io_read_table[reg]) return handler(*this, reg);
+  return io[reg];
+}
 
-      for (size_t palette_id = 0; palette_id < 8; palette_id++) {
-        for (size_t color = 0; color < 4; color++) {
-          u8 p_low  = bg_palette_ram.at((palette_id * 8) + (color * 2) + 0);
-          u8 p_high = (bg_palette_ram.at((palette_id * 8) + (color * 2) + 1));
+void Bus::io_write(const u16 address, const u8 value) {
+  const u8 reg = address & 0xFF;
 
-          u16 f_color = (p_high << 8) + p_low;
+  if (const IoWrite handler = io_write_table[reg]) return handler(*this, reg, value);
+  io[reg] = value;
+}
 
-          ppu->CGB_BGP[palette_id][color] = f_color;
-        }
-      }
-      break;
-    }
-    case OCPS: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
-      ocps.v = value;
-      break;
-    }
-    case OCPD: {
-      if (mode != SYSTEM_MODE::CGB) {
-        return;
-      }
+void Bus::init_hdma(u16 length) {
+  io[HDMA5] = (length / 0x10) - 1;
+  LOG_DEBUG(DMA, "HDMA initialized, remaining blocks: {:#010x}", io[HDMA5]);
 
-      obj_palette_ram.at(ocps.address) = value;
-      if (ocps.auto_increment) {
-        ocps.address++;
-      }
+  // started inside HBlank: the first block goes out right away
+  if (ppu->ppu_mode == RENDERING_MODE::HBLANK && ppu->lcdc.lcd_ppu_enable) {
+    hdma_hblank();
+  }
+};
 
-      for (size_t palette_id = 0; palette_id < 8; palette_id++) {
-        for (size_t color = 0; color < 4; color++) {
-          u8 p_low  = obj_palette_ram.at((palette_id * 8) + (color * 2) + 0);
-          u8 p_high = (obj_palette_ram.at((palette_id * 8) + (color * 2) + 1));
+void Bus::hdma_hblank() {
+  if (mode != SYSTEM_MODE::CGB || (io[HDMA5] & 0x80) != 0 || cpu_is_halted) {
+    return;
+  }
 
-          ppu->CGB_OBP[palette_id][color] = (p_high << 8) + p_low;
-        }
-      }
-      break;
-    }
-    case IE: {
-      // fmt::println("new IE: {}", value);
-      break;
+  vram_dma_block();
+}
+
+bool Bus::vram_dma_block() {
+  u16 src = ((io[HDMA1] << 8) + io[HDMA2]) & 0xfff0;
+  u16 dst = ((io[HDMA3] << 8) + io[HDMA4]) & 0x1ff0;
+
+  // blocks are 16-byte aligned, so source and destination never straddle a page
+  u8* target = vram_banks[vbk].data() + dst;
+  if (const u8* source = read_page[src >> 8]) {
+    std::memcpy(target, source + (src & 0xFF), 0x10);
+  } else {
+    for (u16 index = 0; index < 0x10; index++) {
+      target[index] = read_slow(src + index);
     }
   }
 
-  io.at(address - 0xFF00) = value;
-};
+  dirty.mark(DIRTY_REGION::VRAM, (vbk * 0x2000 + dst) >> 8);
+
+  // 8 M-cycles per block, twice as many in double speed (same wall-clock time)
+  dma_stall_cycles += double_speed_mode ? 16 : 8;
+
+  src += 0x10;
+  dst += 0x10;
+
+  io[HDMA1] = (src >> 8);
+  io[HDMA2] = (src & 0xFF);
+  io[HDMA3] = (dst >> 8);
+  io[HDMA4] = (dst & 0xF0);
+
+  // done, or the destination ran off the end of VRAM
+  if ((io[HDMA5] & 0x7f) == 0 || dst > 0x1FFF) {
+    io[HDMA5] = 0xFF;
+    return false;
+  }
+
+  io[HDMA5]--;
+  return true;
+}
 
-void Bus::init_hdma(u16 length) {
-  io[HDMA5] = (length / 0x10) - 1;
-  fmt::println("HDMA initialized, remaining blocks: {:#010x}", io[HDMA5]);
-  // if (ppu->ppu_mode == RENDERING_MODE::HBLANK) ppu->process_hdma_chunk();
-};
 void Bus::terminate_hdma() {
   // fmt::println("HDMA terminated early.");
   io[HDMA5] |= (1 << 7);
@@ -508,108 +415,231 @@ void Bus::terminate_hdma() {
   // fmt::println("HDMA5: {:08b}", io[HDMA5]);
 };
 
-u8 Bus::read8(const u16 address) {
-  assert(cart != nullptr);
-  assert(vram != nullptr);
-  assert(wram != nullptr);
-
-  if (address <= 0x3FFF) {
-    return cart->read8(address);
-  }
-  if (address >= 0x4000 && address <= 0x7FFF) {
-    return mapper->read8(address);
-  }
-  if (address >= 0x8000 && address <= 0x9FFF) {
-    return vram->at((address - 0x8000));
-  }
-  if (address >= 0xA000 && address <= 0xBFFF) {
-    return mapper->read8(address);
-  }
-  if (address >= 0xC000 && address <= 0xCFFF) {
-    return wram_banks[0].at(address - 0xC000);
-  }
-  if (address >= 0xD000 && address <= 0xDFFF) {
-    return wram->at((address - 0xD000));
+void Bus::start_oam_dma(u8 source_page) {
+  // 0xE0 - 0xFF read the WRAM behind echo RAM, OAM and IO can't be a source
+  if (source_page >= 0xE0) {
+    source_page -= 0x20;
   }
 
-  if (address >= 0xE000 && address <= 0xFDFF) {
-    return read8((address & 0xDFFF));
-  }
-  if (address >= 0xFE00 && address <= 0xFE9F) {
-    return oam.at(address - 0xFE00);
+  // the whole block sits in one page: resolve it once and copy up front, the CPU is
+  // locked out of everything but 0xFF00 - 0xFFFF until the transfer would have finished
+  if (const u8* source = read_page[source_page]) {
+    std::memcpy(oam.data(), source, oam.size());
+  } else {
+    for (size_t i = 0; i < oam.size(); i++) {
+      oam[i] = read_slow((source_page << 8) + i);
+    }
   }
 
-  if (address >= 0xFEA0 && address <= 0xFEFF) {  // unused/illegal
-    return 0x00;
-  }
+  dirty.mark(DIRTY_REGION::OAM, 0);
+  oam_dma_cycles = 160;
+}
 
-  if ((address >= 0xFF00 && address <= 0xFF7F) || address == 0xFFFF) {
-    return io_read(address);
-  }
+void Bus::map_read(u16 address, u32 length, u8* memory, PAGE_HANDLER fallback) {
+  assert((address & 0xFF) == 0 && (length & 0xFF) == 0);
 
-  if (address >= 0xFF80 && address <= 0xFFFE) {
-    return hram.at(address - 0xFF80);
+  for (u32 offset = 0; offset < length; offset += 0x100) {
+    u8 page            = (address + offset) >> 8;
+    read_page[page]    = memory == nullptr ? nullptr : memory + offset;
+    read_handler[page] = fallback;
   }
-  if (address == 0xFFFF) {
-    return io.at(IE);
+}
+
+void Bus::map_write(u16 address, u32 length, u8* memory, PAGE_HANDLER fallback) {
+  assert((address & 0xFF) == 0 && (length & 0xFF) == 0);
+
+  for (u32 offset = 0; offset < length; offset += 0x100) {
+    u8 page             = (address + offset) >> 8;
+    write_page[page]    = memory == nullptr ? nullptr : memory + offset;
+    write_handler[page] = fallback;
+    traced_page[page]   = nullptr;
+
+    if (memory != nullptr) route_write_page(page);
   }
+}
 
-  throw std::runtime_error(fmt::format("[CPU] out of bounds CPU read: {:#04x}", address));
+SHADOW_REGION Bus::shadow_region(u16 address) {
+  if (address >= 0x8000 && address <= 0x9FFF) return SHADOW_REGION::VRAM;
+  if (address >= 0xA000 && address <= 0xBFFF) return SHADOW_REGION::EXT_RAM;
+  if (address >= 0xC000 && address <= 0xFDFF) return SHADOW_REGION::WRAM;
+  if (address >= 0xFF80 && address <= 0xFFFE) return SHADOW_REGION::HRAM;
+  return SHADOW_REGION::COUNT;
 }
 
-void Bus::write8(const u16 address, const u8 value) {
-  if (address <= 0x7FFF) {
-    mapper->write8(address, value);
-    return;
+size_t Bus::backing_offset(SHADOW_REGION region, const u8* backing) const {
+  switch (region) {
+    case SHADOW_REGION::VRAM: {
+      return backing - vram_banks[0].data();
+    }
+    case SHADOW_REGION::WRAM: {
+      return backing - wram_banks[0].data();
+    }
+    case SHADOW_REGION::EXT_RAM: {
+      return backing - cart->ext_ram.data();
+    }
+    case SHADOW_REGION::HRAM: {
+      return backing - hram.data();
+    }
+    case SHADOW_REGION::COUNT: {
+      break;
+    }
   }
+  return 0;
+}
 
-  if (address >= 0x8000 && address <= 0x9FFF) {
-    vram->at(address - 0x8000) = value;
-    return;
-  }
+void Bus::route_write_page(u8 page) {
+  u8* backing = write_page[page] != nullptr ? write_page[page] : traced_page[page];
+  if (backing == nullptr) return;
 
-  if (address >= 0xA000 && address <= 0xBFFF) {
-    mapper->write8(address, value);
-    return;
-  }
+  const SHADOW_REGION region = shadow_region(page << 8);
+  if (region != SHADOW_REGION::VRAM && region != SHADOW_REGION::WRAM && region != SHADOW_REGION::EXT_RAM) return;
 
-  if (address >= 0xC000 && address <= 0xCFFF) {
-    wram_banks[0].at(address - 0xC000) = value;
-    return;
-  }
+  // clean pages take one slow store per generation to get stamped, traced ones every store
+  const bool slow = provenance.enabled(region) || dirty.clean(dirty_region(region), backing_offset(region, backing) >> 8);
 
-  if (address >= 0xD000 && address <= 0xDFFF) {
-    wram->at(address - 0xD000) = value;
-    return;
+  write_page[page]  = slow ? nullptr : backing;
+  traced_page[page] = slow ? backing : nullptr;
+}
+
+u64 Bus::dirty_checkpoint() {
+  const u64 closed = dirty.advance();
+
+  for (u32 page = 0x80; page <= 0xFD; page++) {
+    if (write_page[page] != nullptr) route_write_page(page);
   }
+  return closed;
+}
 
-  if (address >= 0xE000 && address <= 0xFDFF) {
-    write8((address & 0xDFFF), value);
-    return;
+void Bus::set_provenance(SHADOW_REGION region, bool enabled) {
+  provenance.enable(region, enabled);
+
+  for (u32 page = 0; page < 0x100; page++) {
+    if (shadow_region(page << 8) == region) route_write_page(page);
   }
+}
 
-  if (address >= 0xFE00 && address <= 0xFE9F) {
-    oam.at(address - 0xFE00) = value;
-    return;
+void Bus::record_write(SHADOW_REGION region, size_t offset) {
+  // bank of the code doing the write: the mapped ROM bank, or the WRAM bank at 0xD000
+  const u16 pc = provenance.pc;
+  u16 bank     = 0;
+
+  if (pc <= 0x7FFF && mapper != nullptr && mapper->loaded() && mapper->get()->rom_window[pc >> 14] != nullptr) {
+    bank = (mapper->get()->rom_window[pc >> 14] - cart->memory.data()) / 0x4000;
+  } else if ((pc >= 0xD000 && pc <= 0xDFFF) || (pc >= 0xF000 && pc <= 0xFDFF)) {
+    bank = svbk == 0 ? 1 : svbk;
   }
 
-  if (address >= 0xFEA0 && address <= 0xFEFF) {  // unused/illegal
-    return;
+  provenance.record(region, offset,
+                    {
+                        .frame = (u32)ppu->frames,
+                        .cycle = (u32)(io[LY] * 456 + ppu->dots),
+                        .pc    = pc,
+                        .bank  = bank,
+                    });
+}
+
+void Bus::map_vram() {
+  map_read(0x8000, 0x2000, vram_banks[vbk].data());
+  map_write(0x8000, 0x2000, vram_banks[vbk].data());
+}
+
+void Bus::map_wram() {
+  u8 bank = svbk == 0 ? 1 : svbk;
+
+  map_read(0xC000, 0x1000, wram_banks[0].data());
+  map_write(0xC000, 0x1000, wram_banks[0].data());
+  map_read(0xD000, 0x1000, wram_banks[bank].data());
+  map_write(0xD000, 0x1000, wram_banks[bank].data());
+
+  // echo RAM mirrors 0xC000 - 0xDDFF
+  map_read(0xE000, 0x1000, wram_banks[0].data());
+  map_write(0xE000, 0x1000, wram_banks[0].data());
+  map_read(0xF000, 0xE00, wram_banks[bank].data());
+  map_write(0xF000, 0xE00, wram_banks[bank].data());
+}
+
+u8 Bus::read_slow(const u16 address) {
+  switch (read_handler[address >> 8]) {
+    case PAGE_HANDLER::MAPPER: {
+      return mapper != nullptr ? mapper->read8(address) : 0xFF;
+    }
+    case PAGE_HANDLER::OAM: {
+      if (address <= 0xFE9F) return oam[address - 0xFE00];
+      return 0x00;  // unused/illegal
+    }
+    case PAGE_HANDLER::HIGH: {
+      if (address >= 0xFF80 && address <= 0xFFFE) return hram[address - 0xFF80];
+      return io_read(address);
+    }
+    case PAGE_HANDLER::UNMAPPED: {
+      return 0xFF;
+    }
   }
 
-  if ((address >= 0xFF00 && address <= 0xFF7F) || address == 0xFFFF) {
-    // fmt::println("io write");
-    // fmt::println("write requested [{}] {:#04x} -> {:#02X}", bus->get_label(address), address, value);
-    return io_write(address, value);
-  };
+  throw std::runtime_error(fmt::format("[CPU] out of bounds CPU read: {:#04x}", address));
+}
+
+void Bus::write_slow(const u16 address, const u8 value) {
+  if (u8* traced = traced_page[address >> 8]) [[unlikely]] {
+    traced[address & 0xFF] = value;
 
-  if (address >= 0xFF80 && address <= 0xFFFE) {
-    hram.at(address - 0xFF80) = value;
+    const SHADOW_REGION region = shadow_region(address);
+    const size_t offset        = backing_offset(region, traced + (address & 0xFF));
+    dirty.mark(dirty_region(region), offset >> 8);
+
+    if (provenance.enabled(region)) {
+      record_write(region, offset);
+    } else {
+      // stamped for this generation: back on the direct path until the next checkpoint
+      write_page[address >> 8]  = traced;
+      traced_page[address >> 8] = nullptr;
+    }
     return;
   }
 
-  fmt::println("address: {:#010x}", address);
-  assert(0);
+  switch (write_handler[address >> 8]) {
+    case PAGE_HANDLER::MAPPER: {
+      if (mapper == nullptr) return;
+      if (address >= 0xA000 && mapper->loaded()) {
+        // RAM the mapper writes itself (MBC2 nibbles, ...) -- stamp the page it lands in
+        const Mapper* base = mapper->get();
+        if (base->ram_window != nullptr) {
+          dirty.mark(DIRTY_REGION::EXT_RAM, (base->ram_window - cart->ext_ram.data() + (address & base->ram_window_mask)) >> 8);
+        }
+      }
+#ifdef UMIBOZU_TELEMETRY
+      if (telemetry.enabled && address <= 0x7FFF && mapper->loaded()) [[unlikely]] {
+        const Mapper* base           = mapper->get();
+        std::array<const u8*, 2> rom = base->rom_window;
+        const u8* ram                = base->ram_window;
+
+        mapper->write8(address, value);
+        telemetry.count_mapper_write(address, base->rom_window != rom || base->ram_window != ram);
+        return;
+      }
+#endif
+      mapper->write8(address, value);
+      return;
+    }
+    case PAGE_HANDLER::OAM: {
+      if (address <= 0xFE9F) {
+        oam[address - 0xFE00] = value;
+        dirty.mark(DIRTY_REGION::OAM, 0);
+      }
+      return;
+    }
+    case PAGE_HANDLER::HIGH: {
+      if (address >= 0xFF80 && address <= 0xFFFE) {
+        hram[address - 0xFF80] = value;
+        if (provenance.enabled(SHADOW_REGION::HRAM)) [[unlikely]] record_write(SHADOW_REGION::HRAM, address - 0xFF80);
+        return;
+      }
+      return io_write(address, value);
+    }
+    case PAGE_HANDLER::UNMAPPED: {
+      return;
+    }
+  }
 }
 
 void Bus::reset() {
@@ -630,10 +660,30 @@ void Bus::reset() {
 
   hidden_stat = {};
 
+  oam_dma_cycles   = 0;
+  dma_stall_cycles = 0;
+
+  telemetry.reset();
+  provenance.clear();
+  dirty.mark_all();  // everything was just cleared
+
   svbk = 0;
   vbk  = 0;
 
-  fmt::println("[1] bus ptr on apu: {}", fmt::ptr(timer));
+  // cartridge pages stay unmapped until the mapper for the loaded cart maps its banks
+  map_read(0x0000, 0x8000, nullptr);
+  map_write(0x0000, 0x8000, nullptr, PAGE_HANDLER::MAPPER);
+  map_read(0xA000, 0x2000, nullptr, PAGE_HANDLER::MAPPER);
+  map_write(0xA000, 0x2000, nullptr, PAGE_HANDLER::MAPPER);
+  map_vram();
+  map_wram();
+  map_read(0xFE00, 0x100, nullptr, PAGE_HANDLER::OAM);
+  map_write(0xFE00, 0x100, nullptr, PAGE_HANDLER::OAM);
+  map_read(0xFF00, 0x100, nullptr, PAGE_HANDLER::HIGH);
+  map_write(0xFF00, 0x100, nullptr, PAGE_HANDLER::HIGH);
+  init_io_handlers();
+
+  LOG_TRACE(BUS, "timer ptr: {}", fmt::ptr(timer));
   timer->bus = this;
-  fmt::println("[1] bus ptr on apu: {}", fmt::ptr(timer->bus));
+  LOG_TRACE(BUS, "bus ptr on timer: {}", fmt::ptr(timer->bus));
 }
\ No newline at end of file
@@ -6,9 +6,11 @@
 
 #include "cart_constants.hpp"
 #include "fmt/core.h"
+#include "log.hpp"
+#include "rtc.hpp"
 using namespace Umibozu;
 
-std::string Cartridge::get_title(std::span<const u8> title_bytes) const {
+std::string Cartridge::get_title(std::span<const u8> title_bytes) {
   std::stringstream ss;
 
   for (auto& title_byte : title_bytes) {
@@ -22,21 +24,20 @@ std::string Cartridge::get_title(std::span<const u8> title_bytes) const {
 }
 
 void Cartridge::print_cart_info() {
-  fmt::println("[CART] title: {}", info.title.empty() ? "UNKNOWN" : info.title);
-  fmt::println("[CART] mapper string: {}", info.mapper_string);
-  fmt::println("[CART] rom banks: {:d}", info.rom_banks);
-  fmt::println("[CART] ram banks: {:d}", info.ram_banks);
-  fmt::println("[CART] region: {}",
-               info.destination_code ? "japan" : "overseas");
-  fmt::println("[CART] mem vec size: {}", memory.size());
+  LOG_INFO(CART, "title: {}", info.title.empty() ? "UNKNOWN" : info.title);
+  LOG_INFO(CART, "mapper string: {}", info.mapper_string);
+  LOG_INFO(CART, "rom banks: {:d}", info.rom_banks);
+  LOG_INFO(CART, "ram banks: {:d}", info.ram_banks);
+  LOG_INFO(CART, "region: {}", info.destination_code ? "japan" : "overseas");
+  LOG_INFO(CART, "mem vec size: {}", memory.size());
 }
 
-void Cartridge::set_cart_info() {
-  u8 mapper_id  = this->memory[0x147];
-  u16 rom_banks = 2 * (1 << memory[0x148]);
+Cartridge::Info Cartridge::parse_header(std::span<const u8> image) {
+  u8 mapper_id  = image[0x147];
+  u16 rom_banks = 2 * (1 << image[0x148]);
   u8 ram_banks = 0;
   
-  switch (memory[0x149]) {
+  switch (image[0x149]) {
     case 2: {
       ram_banks = 1;
       break;
@@ -58,15 +59,57 @@ void Cartridge::set_cart_info() {
     }
   }
 
-  u8 destination_code      = memory[0x14A];
+  u8 destination_code      = image[0x14A];
+
+  LOG_DEBUG(CART, "mapper id: {:#4x}", mapper_id);
+  const auto mapper_string = cart_types.find(mapper_id);
+
+  Info parsed;
+  parsed.title            = get_title(image.subspan(0x134, 16));
+  parsed.mapper_string    = mapper_string != cart_types.end() ? mapper_string->second : "UNKNOWN";
+  parsed.mapper_id        = mapper_id;
+  parsed.rom_banks        = rom_banks;
+  parsed.ram_banks        = ram_banks;
+  parsed.destination_code = destination_code;
+  parsed.cgb_flag         = image[0x143];
+  return parsed;
+}
+
+void Cartridge::set_cart_info() {
+  std::string path = std::move(info.path);
+  info             = parse_header(memory);
+  info.path        = std::move(path);
+}
+
+size_t Cartridge::ext_ram_size() const {
+  if (info.mapper_id == 0x05 || info.mapper_id == 0x06) return 0x200;  // MBC2: 512 x 4 bits built in
 
-  fmt::println("mapper id: {:#4x}", mapper_id);
-  info.title        = get_title(std::span<u8>(memory.begin() + 0x134, 16));
-  info.mapper_string    = cart_types.at(mapper_id);
-  info.mapper_id        = mapper_id;
-  info.rom_banks        = rom_banks;
-  info.ram_banks        = ram_banks;
-  info.destination_code = destination_code;
+  return info.ram_banks * 0x2000;
+}
+
+size_t Cartridge::save_size() const { return ext_ram_size() + (has_rtc() ? RealTimeClock::FOOTER_SIZE : 0); }
+
+bool Cartridge::has_rtc() const { return info.mapper_id == 0x0F || info.mapper_id == 0x10; }
+
+bool Cartridge::has_battery() const {
+  switch (info.mapper_id) {
+    case 0x03:
+    case 0x06:
+    case 0x09:
+    case 0x0D:
+    case 0x0F:
+    case 0x10:
+    case 0x13:
+    case 0x1B:
+    case 0x1E:
+    case 0x22:
+    case 0xFF: {
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
 }
 
 u8 Cartridge::read8(const u64 address) { return memory[address]; }
\ No newline at end of file
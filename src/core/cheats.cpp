@@ -0,0 +1,211 @@
+#include "core/cheats.hpp"
+
+#include <bitset>
+#include <filesystem>
+#include <fstream>
+
+#include "bus.hpp"
+#include "log.hpp"
+#include "mappers.hpp"
+
+namespace {
+  std::optional<u8> hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return std::nullopt;
+  }
+
+  // digits of `code` with separators dropped, nullopt on anything that isn't hex
+  std::optional<std::vector<u8>> hex_digits(std::string_view code) {
+    std::vector<u8> digits;
+    for (char c : code) {
+      if (c == '-' || c == ' ') continue;
+      std::optional<u8> digit = hex_digit(c);
+      if (!digit) return std::nullopt;
+      digits.push_back(*digit);
+    }
+    return digits;
+  }
+
+  // A GameShark store lands in RAM like any other and stamps its page dirty, but stays
+  // out of write provenance: that records CPU writes, and provenance.pc is whatever
+  // instruction the CPU was on when VBlank came.
+  void poke(Bus& bus, SHADOW_REGION region, u8* byte, u8 value) {
+    *byte = value;
+    if (region != SHADOW_REGION::HRAM) bus.dirty.mark(Bus::dirty_region(region), bus.backing_offset(region, byte) >> 8);
+  }
+}  // namespace
+
+std::optional<Cheat> Cheat::parse(std::string_view code) {
+  std::optional<std::vector<u8>> digits = hex_digits(code);
+  if (!digits) return std::nullopt;
+
+  const std::vector<u8>& d = *digits;
+  Cheat cheat;
+  cheat.code = std::string(code);
+
+  switch (d.size()) {
+    case 6:
+    case 9: {
+      // ABC-DEF-GHI: AB new data, address (F ^ 0xF) CDE, GI the compare byte
+      // rotated left by two and XORed with 0xBA, H unused
+      cheat.type    = TYPE::GAME_GENIE;
+      cheat.value   = (d[0] << 4) | d[1];
+      cheat.address = ((d[5] ^ 0xF) << 12) | (d[2] << 8) | (d[3] << 4) | d[4];
+
+      if (cheat.address > 0x7FFF) return std::nullopt;
+
+      if (d.size() == 9) {
+        u8 scrambled  = (d[6] << 4) | d[8];
+        cheat.compare = (u8)(((scrambled >> 2) | (scrambled << 6)) ^ 0xBA);
+      }
+      return cheat;
+    }
+    case 8: {
+      // TTVVAAAA
+      cheat.type    = TYPE::GAMESHARK;
+      cheat.gs_type = (d[0] << 4) | d[1];
+      cheat.value   = (d[2] << 4) | d[3];
+      cheat.address = (d[6] << 12) | (d[7] << 8) | (d[4] << 4) | d[5];
+
+      if (cheat.address < 0x8000) return std::nullopt;
+      return cheat;
+    }
+  }
+
+  return std::nullopt;
+}
+
+void CheatEngine::load(const std::string& path) {
+  this->path = path;
+  cheats.clear();
+
+  std::ifstream file(path);
+  std::string line;
+
+  while (std::getline(file, line)) {
+    std::string_view view = line;
+    while (!view.empty() && (view.back() == '\r' || view.back() == ' ')) view.remove_suffix(1);
+    if (view.empty() || view.front() == '#') continue;
+
+    bool enabled = view.front() != '-';
+    if (!enabled) view.remove_prefix(1);
+
+    size_t split          = view.find(' ');
+    std::string_view code = view.substr(0, split);
+    std::string_view name = split == std::string_view::npos ? std::string_view{} : view.substr(split + 1);
+
+    if (!add(code, name)) {
+      LOG_WARN(GB, "cheats: skipping invalid code '{}' in {}", code, path);
+      continue;
+    }
+    cheats.back().enabled = enabled;
+  }
+
+  update_flags();
+
+  if (!cheats.empty()) LOG_INFO(GB, "cheats: loaded {} code(s) from {}", cheats.size(), path);
+}
+
+bool CheatEngine::save() const {
+  if (path.empty()) return false;
+
+  std::filesystem::path parent = std::filesystem::path(path).parent_path();
+  if (!parent.empty() && !std::filesystem::exists(parent) && !std::filesystem::create_directories(parent)) {
+    LOG_ERROR(GB, "could not create cheat directory");
+    return false;
+  }
+
+  std::ofstream file(path, std::ios::trunc);
+  for (const Cheat& cheat : cheats) {
+    file << (cheat.enabled ? "" : "-") << cheat.code;
+    if (!cheat.name.empty()) file << ' ' << cheat.name;
+    file << '\n';
+  }
+  return file.good();
+}
+
+bool CheatEngine::add(std::string_view code, std::string_view name) {
+  std::optional<Cheat> cheat = Cheat::parse(code);
+  if (!cheat) return false;
+
+  cheat->name = std::string(name);
+  cheats.push_back(*cheat);
+  update_flags();
+  return true;
+}
+
+void CheatEngine::remove(size_t index) {
+  if (index >= cheats.size()) return;
+  cheats.erase(cheats.begin() + index);
+  update_flags();
+}
+
+void CheatEngine::update_flags() {
+  rom_patches = false;
+  for (const Cheat& cheat : cheats) {
+    rom_patches |= cheat.enabled && cheat.type == Cheat::TYPE::GAME_GENIE;
+  }
+}
+
+void CheatEngine::apply_rom(Bus& bus) {
+  update_flags();
+
+  const Mapper* mapper = bus.mapper != nullptr ? bus.mapper->get() : nullptr;
+  if (mapper == nullptr) return;
+
+  for (u8 window = 0; window < 2; window++) {
+    bus.map_read(window * 0x4000, 0x4000, const_cast<u8*>(mapper->rom_window[window]));
+    overlay_rom(bus, window * 0x4000, mapper->rom_window[window]);
+  }
+}
+
+void CheatEngine::overlay_rom(Bus& bus, u16 window_address, const u8* window) {
+  if (!rom_patches || window == nullptr) return;
+
+  std::bitset<0x40> copied;
+
+  for (const Cheat& cheat : cheats) {
+    if (!cheat.enabled || cheat.type != Cheat::TYPE::GAME_GENIE) continue;
+    if (cheat.address < window_address || cheat.address >= window_address + 0x4000) continue;
+
+    const u16 offset = cheat.address - window_address;
+    if (cheat.compare && window[offset] != *cheat.compare) continue;
+
+    const u8 page                   = cheat.address >> 8;
+    std::array<u8, 0x100>& overlaid = overlay[page];
+
+    if (!copied[offset >> 8]) {
+      std::copy_n(window + (offset & 0xFF00), 0x100, overlaid.begin());
+      bus.read_page[page] = overlaid.data();
+      copied[offset >> 8] = true;
+    }
+
+    overlaid[cheat.address & 0xFF] = cheat.value;
+  }
+}
+
+void CheatEngine::apply_ram(Bus& bus) const {
+  for (const Cheat& cheat : cheats) {
+    if (!cheat.enabled || cheat.type != Cheat::TYPE::GAMESHARK) continue;
+
+    const SHADOW_REGION region = Bus::shadow_region(cheat.address);
+    const bool banked          = (cheat.gs_type & 0xF0) == 0x90 && bus.mode == SYSTEM_MODE::CGB;
+    if (banked && cheat.address >= 0xD000 && cheat.address <= 0xDFFF) {
+      const u8 bank = std::max<u8>(cheat.gs_type & 0x7, 1);
+      poke(bus, region, &bus.wram_banks[bank][cheat.address - 0xD000], cheat.value);
+      continue;
+    }
+
+    // traced pages are plain RAM too, only routed through the slow path
+    u8* page = bus.write_page[cheat.address >> 8] != nullptr ? bus.write_page[cheat.address >> 8] : bus.traced_page[cheat.address >> 8];
+    if (page != nullptr) {
+      poke(bus, region, page + (cheat.address & 0xFF), cheat.value);
+    } else if (region == SHADOW_REGION::HRAM) {
+      poke(bus, region, &bus.hram[cheat.address - 0xFF80], cheat.value);
+    } else {
+      bus.write_slow(cheat.address, cheat.value);  // mapper RAM and I/O, never traced
+    }
+  }
+}
@@ -0,0 +1,291 @@
+#include "checksum.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define UMIBOZU_HAS_X86_KERNELS 1
+#define UMIBOZU_PCLMUL __attribute__((target("sse4.1,pclmul")))
+#define UMIBOZU_SHA    __attribute__((target("sse4.1,sha")))
+#endif
+
+using namespace Umibozu;
+
+namespace {
+  using CrcTables = std::array<std::array<u32, 0x100>, 8>;
+
+  // table k advances a byte that sits k bytes before the end of an 8-byte step
+  constexpr CrcTables make_crc_tables() {
+    CrcTables tables = {};
+    for (u32 i = 0; i < 0x100; i++) {
+      u32 c = i;
+      for (int bit = 0; bit < 8; bit++) {
+        c = (c & 1) ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+      }
+      tables[0][i] = c;
+    }
+    for (size_t k = 1; k < 8; k++) {
+      for (u32 i = 0; i < 0x100; i++) {
+        tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+      }
+    }
+    return tables;
+  }
+
+  constexpr CrcTables CRC_TABLES = make_crc_tables();
+
+  u32 load32_le(const u8* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24); }
+
+  // slicing-by-8 over the inverted register
+  u32 crc32_update(u32 c, const u8* p, size_t length) {
+    for (; length >= 8; p += 8, length -= 8) {
+      const u32 one = c ^ load32_le(p);
+      const u32 two = load32_le(p + 4);
+      c = CRC_TABLES[7][one & 0xFF] ^ CRC_TABLES[6][(one >> 8) & 0xFF] ^ CRC_TABLES[5][(one >> 16) & 0xFF] ^ CRC_TABLES[4][one >> 24] ^
+          CRC_TABLES[3][two & 0xFF] ^ CRC_TABLES[2][(two >> 8) & 0xFF] ^ CRC_TABLES[1][(two >> 16) & 0xFF] ^ CRC_TABLES[0][two >> 24];
+    }
+    for (; length > 0; p++, length--) {
+      c = (c >> 8) ^ CRC_TABLES[0][(c ^ *p) & 0xFF];
+    }
+    return c;
+  }
+
+  constexpr std::array<u32, 5> SHA1_INIT = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+  u32 rotl(u32 x, int n) { return (x << n) | (x >> (32 - n)); }
+
+  void sha1_blocks_portable(std::array<u32, 5>& state, const u8* p, size_t blocks) {
+    for (; blocks > 0; blocks--, p += 64) {
+      std::array<u32, 80> w;
+      for (size_t t = 0; t < 16; t++) {
+        w[t] = (p[t * 4] << 24) | (p[t * 4 + 1] << 16) | (p[t * 4 + 2] << 8) | p[t * 4 + 3];
+      }
+      for (size_t t = 16; t < 80; t++) {
+        w[t] = rotl(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+      }
+
+      u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+      for (size_t t = 0; t < 80; t++) {
+        u32 f, k;
+        if (t < 20) {
+          f = (b & c) | (~b & d);
+          k = 0x5A827999;
+        } else if (t < 40) {
+          f = b ^ c ^ d;
+          k = 0x6ED9EBA1;
+        } else if (t < 60) {
+          f = (b & c) | (b & d) | (c & d);
+          k = 0x8F1BBCDC;
+        } else {
+          f = b ^ c ^ d;
+          k = 0xCA62C1D6;
+        }
+        const u32 temp = rotl(a, 5) + f + e + k + w[t];
+        e              = d;
+        d              = c;
+        c              = rotl(b, 30);
+        b              = a;
+        a              = temp;
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+    }
+  }
+
+#ifdef UMIBOZU_HAS_X86_KERNELS
+  // one 128-bit lane folded forward over the next 16 bytes
+  UMIBOZU_PCLMUL inline __m128i crc32_fold(__m128i x, __m128i next, __m128i k) {
+    const __m128i low = _mm_clmulepi64_si128(x, k, 0x00);
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), next), low);
+  }
+
+  // folds 64-byte blocks into four 128-bit lanes, then down to 32 bits with a Barrett
+  // reduction (Intel, "Fast CRC Computation Using PCLMULQDQ"). `length` is a multiple
+  // of 16, at least 64; `c` is the inverted register.
+  UMIBOZU_PCLMUL u32 crc32_pclmul(u32 c, const u8* p, size_t length) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163CD6124);
+    const __m128i poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(p + 0x00)), _mm_cvtsi32_si128(c));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+    p += 64;
+    length -= 64;
+
+    for (; length >= 64; p += 64, length -= 64) {
+      const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+      const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+      const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+      const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+      x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+      x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+      x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+      x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+    }
+
+    x1 = crc32_fold(x1, x2, k3k4);
+    x1 = crc32_fold(x1, x3, k3k4);
+    x1 = crc32_fold(x1, x4, k3k4);
+    for (; length >= 16; p += 16, length -= 16) {
+      x1 = crc32_fold(x1, _mm_loadu_si128((const __m128i*)p), k3k4);
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k5k0, 0x00), x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), poly, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return _mm_extract_epi32(x1, 1);
+  }
+
+  // groups 5F .. 5F+4 of four rounds each (one SHA1RNDS4); the message schedule for
+  // group g + 1..3 is built alongside group g with SHA1MSG1 / XOR / SHA1MSG2
+  template <int F>
+  UMIBOZU_SHA inline void sha1_groups(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i (&msg)[4]) {
+    for (int g = F * 5; g < F * 5 + 5; g++) {
+      __m128i& e      = (g & 1) ? e1 : e0;
+      __m128i& next   = (g & 1) ? e0 : e1;
+      const __m128i w = msg[g % 4];
+
+      if (g > 0) e = _mm_sha1nexte_epu32(e, w);
+      next = abcd;
+      if (g >= 3 && g < 19) msg[(g + 1) % 4] = _mm_sha1msg2_epu32(msg[(g + 1) % 4], w);
+      abcd = _mm_sha1rnds4_epu32(abcd, e, F);
+      if (g >= 1 && g <= 16) msg[(g + 3) % 4] = _mm_sha1msg1_epu32(msg[(g + 3) % 4], w);
+      if (g >= 2 && g <= 17) msg[(g + 2) % 4] = _mm_xor_si128(msg[(g + 2) % 4], w);
+    }
+  }
+
+  UMIBOZU_SHA void sha1_blocks_shani(std::array<u32, 5>& state, const u8* p, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607, 0x08090A0B0C0D0E0F);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state.data()), 0x1B);
+    __m128i e0   = _mm_set_epi32(state[4], 0, 0, 0);
+
+    for (; blocks > 0; blocks--, p += 64) {
+      const __m128i abcd_save = abcd;
+      const __m128i e_save    = e0;
+
+      __m128i msg[4];
+      for (int i = 0; i < 4; i++) {
+        msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + i * 16)), byte_swap);
+      }
+
+      __m128i e1 = abcd;
+      e0         = _mm_add_epi32(e0, msg[0]);
+
+      sha1_groups<0>(abcd, e0, e1, msg);
+      sha1_groups<1>(abcd, e0, e1, msg);
+      sha1_groups<2>(abcd, e0, e1, msg);
+      sha1_groups<3>(abcd, e0, e1, msg);
+
+      // group 19 left the next E in e0
+      e0   = _mm_sha1nexte_epu32(e0, e_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i*)state.data(), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = _mm_extract_epi32(e0, 3);
+  }
+
+  bool host_has_pclmul() {
+    static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return supported;
+  }
+
+  bool host_has_sha() {
+    static const bool supported = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+    return supported;
+  }
+#else
+  bool host_has_pclmul() { return false; }
+  bool host_has_sha() { return false; }
+#endif
+
+  using Sha1Blocks = void (*)(std::array<u32, 5>&, const u8*, size_t);
+
+  Checksum::Sha1 sha1_with(Sha1Blocks process, std::span<const u8> bytes) {
+    std::array<u32, 5> state = SHA1_INIT;
+
+    const size_t blocks = bytes.size() / 64;
+    if (blocks > 0) process(state, bytes.data(), blocks);
+
+    // tail, 0x80, zeros, then the bit length -- one or two more blocks
+    std::array<u8, 128> tail = {};
+    const size_t rest        = bytes.size() - blocks * 64;
+    std::memcpy(tail.data(), bytes.data() + blocks * 64, rest);
+    tail[rest] = 0x80;
+
+    const size_t tail_blocks = rest < 56 ? 1 : 2;
+    const u64 bits           = (u64)bytes.size() * 8;
+    for (int i = 0; i < 8; i++) {
+      tail[tail_blocks * 64 - 1 - i] = bits >> (i * 8);
+    }
+    process(state, tail.data(), tail_blocks);
+
+    Checksum::Sha1 digest;
+    for (size_t i = 0; i < 5; i++) {
+      digest[i * 4]     = state[i] >> 24;
+      digest[i * 4 + 1] = state[i] >> 16;
+      digest[i * 4 + 2] = state[i] >> 8;
+      digest[i * 4 + 3] = state[i];
+    }
+    return digest;
+  }
+}  // namespace
+
+u32 Checksum::crc32_portable(std::span<const u8> bytes, u32 crc) { return ~crc32_update(~crc, bytes.data(), bytes.size()); }
+
+u32 Checksum::crc32(std::span<const u8> bytes, u32 crc) {
+  u32 c         = ~crc;
+  const u8* p   = bytes.data();
+  size_t length = bytes.size();
+
+#ifdef UMIBOZU_HAS_X86_KERNELS
+  if (length >= 64 && host_has_pclmul()) {
+    const size_t wide = length & ~size_t{15};
+    c                 = crc32_pclmul(c, p, wide);
+    p += wide;
+    length -= wide;
+  }
+#endif
+
+  return ~crc32_update(c, p, length);
+}
+
+Checksum::Sha1 Checksum::sha1_portable(std::span<const u8> bytes) { return sha1_with(sha1_blocks_portable, bytes); }
+
+Checksum::Sha1 Checksum::sha1(std::span<const u8> bytes) {
+#ifdef UMIBOZU_HAS_X86_KERNELS
+  if (host_has_sha()) return sha1_with(sha1_blocks_shani, bytes);
+#endif
+  return sha1_with(sha1_blocks_portable, bytes);
+}
+
+bool Checksum::crc32_accelerated() { return host_has_pclmul(); }
+
+bool Checksum::sha1_accelerated() { return host_has_sha(); }
+
+std::string Checksum::to_hex(std::span<const u8> bytes) {
+  std::string hex;
+  hex.reserve(bytes.size() * 2);
+  for (u8 byte : bytes) {
+    hex += fmt::format("{:02x}", byte);
+  }
+  return hex;
+}
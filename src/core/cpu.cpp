@@ -9,24 +9,27 @@
 #include "fmt/core.h"
 #include "instructions.hpp"
 #include "io_defs.hpp"
+#include "log.hpp"
 #include "ppu.hpp"
 
 using namespace Umibozu;
 
 void SM83::m_cycle() {
 #ifndef CPU_TEST_MODE_H
+  if (bus->oam_dma_cycles > 0) {
+    bus->oam_dma_cycles--;
+  }
+
   if (speed == SPEED::DOUBLE) {
     bus->timer->increment_div(2, true);
     // cycles_elapsed += 2;
     // fmt::println("cycles elapsed in m_cycle = {}", cycles_elapsed);
-    // bus->mapper->increment_internal_clock(2, bus->mapper->actual.RTC_DAY);
 
     // bus->apu->tick(2);
     bus->ppu->tick(2);
   } else {
     bus->timer->increment_div(4, false);
 // cycles_elapsed += 4;
-// bus->mapper->increment_internal_clock(4, bus->mapper->actual.RTC_DAY);  // refactor: this is not elegant
 // fmt::println("ticking");
 #ifndef SYSTEM_TEST_MODE
     bus->apu->tick(4);
@@ -66,11 +69,25 @@ u8 SM83::read8(const u16 address) {
 #else
   m_cycle();
 
+  if (bus->oam_dma_cycles > 0 && address < 0xFF00) [[unlikely]] {
+    return 0xFF;
+  }
+
   return bus->read8(address);
 
 #endif
 };
 
+u8 SM83::fetch_opcode(const u16 address) {
+  if (bus->provenance.any()) [[unlikely]] bus->provenance.pc = address;
+
+  const u8 opcode = read8(address);
+#ifdef UMIBOZU_TELEMETRY
+  if (bus->telemetry.enabled) [[unlikely]] bus->telemetry.count_fetch(address);
+#endif
+  return opcode;
+}
+
 u16 SM83::read16(const u16 address) {
   u8 low  = read8(address);
   u8 high = read8(address + 1);
@@ -92,6 +109,10 @@ void SM83::write8(const u16 address, const u8 value) {
 #endif
   m_cycle();
 
+  if (bus->oam_dma_cycles > 0 && address < 0xFF00) [[unlikely]] {
+    return;
+  }
+
   bus->write8(address, value);
   return;
 
@@ -180,6 +201,12 @@ u32 SM83::run_instruction() {
   //   throw std::runtime_error("mapper error");
   // }
 
+  // held while VRAM DMA blocks are copied
+  while (bus->dma_stall_cycles > 0) {
+    bus->dma_stall_cycles--;
+    m_cycle();
+  }
+
   handle_interrupts();
   if (ei_queued) {
     IME       = true;
@@ -187,7 +214,7 @@ u32 SM83::run_instruction() {
   }
 #endif
 
-  u8 opcode = read8(PC++);
+  u8 opcode = fetch_opcode(PC++);
   switch (opcode) {
     case 0x0: {
       Instructions::NOP();
@@ -256,14 +283,14 @@ u32 SM83::run_instruction() {
     }
 #ifndef CPU_TEST_MODE_H
     case 0x10: {
-      fmt::println("STOP called");
+      LOG_DEBUG(CPU, "STOP called");
 
       // STOP instruction -- this instruction sucks.
       // https://x.com/LIJI32/status/1412131307501625353
       bool button_cond = ((bus->io[JOYPAD] & 0x30) >> 4) == 0x1 && bus->joypad.get_buttons() != 0xf;  // one of the buttons is held
 
       if (button_cond) {
-        fmt::println("buttons pressed");
+        LOG_DEBUG(CPU, "STOP: buttons pressed");
         if (bus->interrupt_pending()) return cycles_elapsed;
 
         PC++;
@@ -272,12 +299,12 @@ u32 SM83::run_instruction() {
         return cycles_elapsed;
 
       } else {
-        fmt::println("no buttons pressed");
+        LOG_DEBUG(CPU, "STOP: no buttons pressed");
 
         if (bus->io[KEY1] & 0x1) {  // speed switch requested, armed bit is set
-          fmt::println("[STOP] speed switch requested, armed bit is set");
+          LOG_DEBUG(CPU, "STOP: speed switch requested, armed bit is set");
           if (bus->interrupt_pending()) {
-            fmt::println("interrupt pending");
+            LOG_DEBUG(CPU, "STOP: interrupt pending");
             if (!IME) throw std::runtime_error("non deterministic glitching");
 
             bus->timer->reset_div(speed == SPEED::DOUBLE);
@@ -285,7 +312,7 @@ u32 SM83::run_instruction() {
             bus->double_speed_mode = (u8)speed & 0x80;
             bus->io[KEY1] ^= 1;
           } else {  // no interrupt pending, enter halt mode, reset div, change speed
-            fmt::println("no interrupt pending, enter halt mode, reset div, change speed");
+            LOG_DEBUG(CPU, "STOP: no interrupt pending, enter halt mode, reset div, change speed");
             PC++;
             speed                  = static_cast<SPEED>((u8)speed ^ 0x80);
             bus->double_speed_mode = (u8)speed & 0x80;
@@ -294,11 +321,11 @@ u32 SM83::run_instruction() {
         } else {  // speed switch IS NOT armed
 
           if (bus->interrupt_pending()) {  // Interrupt pending --> 1 byte opcode, stop mode entered, div reset
-            fmt::println("should enter stop mode");
+            LOG_DEBUG(CPU, "STOP: should enter stop mode");
             bus->timer->reset_div(speed == SPEED::DOUBLE);
           } else {  // no interrupt pending -- 2 byte opcode -- stop mode is entered, div is reset
             PC++;
-            fmt::println("should enter STOP mode");
+            LOG_DEBUG(CPU, "STOP: should enter STOP mode");
             bus->timer->reset_div(speed == SPEED::DOUBLE);
           }
         }
@@ -2316,7 +2343,7 @@ u32 SM83::run_instruction() {
 
         default: {
 #ifndef CPU_TEST_MODE_H
-          fmt::println("[CPU] unimplemented CB op: {:#04x}", peek(PC - 1));
+          LOG_ERROR(CPU, "unimplemented CB op: {:#04x}", peek(PC - 1));
 #endif
           assert(0);
           // exit(-1);
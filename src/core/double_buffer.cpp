@@ -2,7 +2,7 @@
 #include <cassert>
 
 void DoubleBuffer::write(size_t idx, u16 value) {
-  assert(idx < (256*256));
+  assert(idx < PIXELS);
   write_buf[idx] = value;
 }
 
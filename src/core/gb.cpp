@@ -1,17 +1,21 @@
 #include "core/gb.hpp"
 
 #include <filesystem>
+#include <algorithm>
 
 #include "bus.hpp"
 #include "cpu.hpp"
 #include "fmt/base.h"
 #include "io_defs.hpp"
-#include "mapper.hpp"
+#include "log.hpp"
+#include "mappers.hpp"
+#include "patch.hpp"
+#include "rom_registry.hpp"
 
 void GB::init_hw_regs(SYSTEM_MODE mode) {
   switch (mode) {
     case SYSTEM_MODE::DMG: {
-      fmt::println("INIT DMG REGS");
+      LOG_DEBUG(GB, "init DMG regs");
       bus.io[JOYPAD]      = 0xCF;
       bus.io[SB]          = 0x00;
       bus.io[SC]          = 0x7E;
@@ -133,39 +137,40 @@ void GB::init_hw_regs(SYSTEM_MODE mode) {
 }
 
 GB::GB() {
-  Mapper::bus = &bus;
-  cpu.bus     = &bus;
-  ppu.bus     = &bus;
-  timer.bus   = &bus;
+  cpu.bus   = &bus;
+  ppu.bus   = &bus;
+  timer.bus = &bus;
 
-  bus.apu   = &apu;
-  bus.ppu   = &ppu;
-  bus.cart  = &cart;
-  bus.timer = &timer;
+  bus.apu    = &apu;
+  bus.ppu    = &ppu;
+  bus.cart   = &cart;
+  bus.timer  = &timer;
+  bus.cheats = &cheats;
+  bus.saver  = &saver;
 
   apu.bus = &bus;
 
-  fmt::println("[0] bus ptr on apu: {}", fmt::ptr(bus.timer));
-  fmt::println("[0] bus ptr on apu: {}", fmt::ptr(timer.bus));
+  LOG_TRACE(GB, "timer ptr: {}", fmt::ptr(bus.timer));
+  LOG_TRACE(GB, "bus ptr on timer: {}", fmt::ptr(timer.bus));
 }
 
 GB::~GB() {
-  if (cart.info.title.empty()) return;
-
-  if (!(bus.mapper->id == 0x03 || bus.mapper->id == 0x06 || bus.mapper->id == 0x09 || bus.mapper->id == 0x0D || bus.mapper->id == 0x0F || bus.mapper->id == 0x10 || bus.mapper->id == 0x13 ||
-        bus.mapper->id == 0x1B || bus.mapper->id == 0x1E || bus.mapper->id == 0x22 || bus.mapper->id == 0xFF)) {  // mapper ids with save compatiblity
-    return;
-  }
+  if (cart.info.title.empty() || !mapper.loaded() || !cart.has_battery()) return;
 
   save_game();
 }
 
 void GB::load_cart(const File &rom) {
+  // the outgoing cart's last changes and its clock, before reset() zeroes timer.clock
+  if (!cart.info.title.empty() && mapper.loaded() && cart.has_battery()) save_game();
   reset();
-  cart.memory    = rom.data;
+  // instances running the same title share one image; bytes built in memory are
+  // only copied when no live image matches them
+  RomRegistry& registry = RomRegistry::instance();
+  cart.image            = rom.mapping != nullptr ? registry.intern(rom.mapping) : registry.intern(rom.bytes());
+  cart.memory           = cart.image->bytes();
   cart.info.path = rom.path;
-
-  std::fill(cart.ext_ram.begin(), cart.ext_ram.end(), 0);
+  cart.patch_path.clear();
 
   bus.io[KEY0] = cart.memory[0x143];
 
@@ -181,43 +186,115 @@ void GB::load_cart(const File &rom) {
 
   cart.set_cart_info();
   cart.print_cart_info();
-  Mapper *mapper_ptr = get_mapper_by_id(cart.info.mapper_id);
-  bus.mapper         = mapper_ptr;
-  ppu.mapper         = mapper_ptr;
+  cheats.load(fmt::format("cheats/{}.cht", cart.info.title));
+  load_save_game();  // the mapper maps its RAM window over ext_ram
+  mapper.load(cart.info.mapper_id, &bus);
+  bus.mapper = &mapper;
+  ppu.mapper = &mapper;
+  if (cart.has_rtc()) {
+    mapper.get()->rtc.load(cart.rtc_footer, timer.clock, rtc_host_time ? std::optional(RealTimeClock::unix_now()) : std::nullopt);
+  }
+
+  saver.stop();
+  if (cart.has_battery() && !cart.save_image.empty() && cart.ext_ram_mapping == nullptr) {
+    std::filesystem::create_directories("saves");
+    saver.start(bus, std::filesystem::absolute(fmt::format("saves/{}.sav", cart.info.title)).string());
+  }
 
-  load_save_game();
+  MemoryReport report = memory_report();
+  if (rom.mapping == cart.image) report.rom_sharers--;  // the caller's File still holds it
+  LOG_INFO(GB, "memory: {} KiB instance + {} KiB ROM shared by {} -> {} KiB per instance ({} KiB unshared)", report.instance / 1024, report.rom / 1024, report.rom_sharers,
+           report.per_instance() / 1024, (report.instance + report.rom) / 1024);
 
   cpu.status = Umibozu::SM83::STATUS::ACTIVE;
 }
 
+void GB::load_cart(const File &rom, const File &patch) {
+  load_cart(Umibozu::Patch::apply_cached(rom, patch));
+  cart.patch_path = patch.path;
+}
+
+GB::MemoryReport GB::memory_report() const {
+  return {
+      .instance    = sizeof(GB) + PPU::FRAME_BUFFER_BYTES + cart.ext_ram.size(),
+      .rom         = cart.memory.size(),
+      .rom_sharers = cart.image != nullptr ? (size_t)cart.image.use_count() : 1,
+  };
+}
+
 void GB::save_game() {
+  if (cart.save_image.empty()) return;
+
+  if (!cart.rtc_footer.empty()) mapper.get()->rtc.save(cart.rtc_footer, timer.clock, RealTimeClock::unix_now());
+
+  if (cart.ext_ram_mapping != nullptr) {
+    cart.ext_ram_mapping->flush();
+    return;
+  }
+
+  if (saver.running()) {
+    saver.flush(bus);
+    return;
+  }
+
   if (!std::filesystem::exists("saves")) {
     if (!std::filesystem::create_directory("saves")) {
-      fmt::println("could not create save directory");
+      LOG_ERROR(GB, "could not create save directory");
     }
   }
 
-  std::ofstream save(fmt::format("saves/{}.sav", cart.info.title), std::ios::binary | std::ios::trunc);
-
-  std::ostream_iterator<u8> output_iterator(save);
-  std::copy(std::begin(cart.ext_ram), std::end(cart.ext_ram), output_iterator);
-
-  save.close();
+  if (!Umibozu::write_file_atomic(fmt::format("saves/{}.sav", cart.info.title), cart.save_image)) {
+    LOG_ERROR(GB, "could not write save");
+  }
 }
 
 void GB::load_save_game() {
-  std::string save_path = fmt::format("saves/{}.sav", cart.info.title);
+  const std::string save_path = fmt::format("saves/{}.sav", cart.info.title);
+  const size_t ram_size       = cart.ext_ram_size();
+  const size_t size           = cart.save_size();
+
+  cart.ext_ram_mapping.reset();
+  cart.ext_ram_buffer.clear();
+  cart.ext_ram    = {};
+  cart.rtc_footer = {};
+  cart.save_image = {};
+
+  if (size == 0) return;
+
+  // a clock footer is only there when the file is the RAM plus a 44- or 48-byte footer
+  std::error_code error;
+  const size_t file_size = std::filesystem::file_size(save_path, error);
+  const bool has_footer  = cart.has_rtc() && !error && (file_size == ram_size + 44 || file_size == ram_size + RealTimeClock::FOOTER_SIZE);
+
+  auto use = [&](std::span<u8> image) {
+    cart.save_image = image;
+    cart.ext_ram    = image.first(ram_size);
+    cart.rtc_footer = image.subspan(ram_size);
+    if (!has_footer) std::fill(cart.rtc_footer.begin(), cart.rtc_footer.end(), 0);
+  };
+
+  if (mapped_saves && cart.has_battery()) {
+    try {
+      std::filesystem::create_directories("saves");
+      cart.ext_ram_mapping = std::make_unique<SharedMapping>(save_path, size);
+      use(cart.ext_ram_mapping->bytes());
+      LOG_INFO(GB, "save mapped: {} ({} bytes)", save_path, size);
+      return;
+    } catch (const std::exception &e) {
+      LOG_WARN(GB, "{} -- keeping cartridge RAM in memory", e.what());
+    }
+  }
 
-  if (std::filesystem::exists(save_path)) {
-    std::ifstream save(save_path, std::ios::binary);
+  cart.ext_ram_buffer.assign(size, 0);
+  use(cart.ext_ram_buffer);
 
-    File save_file = read_file(save_path);
-    u64 index      = 0;
-    for (auto &byte : save_file.data) {
-      cart.ext_ram.at(index++) = byte;
-    }
+  if (!error) {
+    // older saves were written at the full 1 MB -- the data sits at the front either way
+    const File save_file            = read_file(save_path);
+    const std::span<const u8> bytes = save_file.bytes();
+    std::copy_n(bytes.begin(), std::min(bytes.size(), has_footer ? size : ram_size), cart.save_image.begin());
 
-    fmt::println("[GB] save loaded");
+    LOG_INFO(GB, "save loaded");
   }
 }
 
@@ -240,18 +317,15 @@ void GB::reset() {
   ppu.dots         = 0;
   ppu.frame_queued = false;
   ppu.frame_skip   = false;
+  ppu.frames       = 0;
 
   ppu.hdma_active                        = false;
   ppu.remaining_length                   = 0;
   ppu.stat_irq_fired_on_current_scanline = false;
-  ppu.x_pos_offset                       = 0;
   ppu.window_current_y                   = 0;
-  ppu.window_x_pos_offset                = 0;
   ppu.window_enabled                     = 0;
-  ppu.window_line_count                  = 0;
 
-  ppu.hdma_executed_on_scanline = false;
-  ppu.ly_is_lyc_latch           = false;
+  ppu.ly_is_lyc_latch = false;
 
   ppu.DMG_BGP = {};
   ppu.DMG_OBP = {};
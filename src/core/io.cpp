@@ -0,0 +1,129 @@
+#include "io.hpp"
+
+#include <cstdio>
+#include <filesystem>
+
+#include "archive.hpp"
+#include "log.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define UMIBOZU_HAS_MMAP 1
+#endif
+
+using namespace Umibozu;
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef UMIBOZU_HAS_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat st = {};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void* address = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address != MAP_FAILED) {
+        mapping = address;
+        base    = static_cast<const u8*>(address);
+        length  = st.st_size;
+      }
+    }
+    ::close(fd);  // the mapping holds its own reference to the file
+
+    if (mapping != nullptr) return;
+  }
+#endif
+
+  // fallback: one bulk read into an owned buffer
+  std::ifstream file(path, std::ios::binary);
+  if (!file.good()) {
+    throw std::runtime_error(fmt::format("io: failed to load file: {}", path));
+  }
+
+  owned.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  base   = owned.data();
+  length = owned.size();
+
+  LOG_DEBUG(GB, "io: {} read into memory ({} bytes), not mapped", path, length);
+}
+
+MappedFile::MappedFile(std::vector<u8> bytes) : owned(std::move(bytes)) {
+  base   = owned.data();
+  length = owned.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef UMIBOZU_HAS_MMAP
+  if (mapping != nullptr) ::munmap(mapping, length);
+#endif
+}
+
+File Umibozu::read_file(std::string filename) {
+  auto mapping = std::make_shared<const MappedFile>(filename);
+
+  const Archive::FORMAT format = Archive::detect(filename, mapping->bytes());
+  if (format != Archive::FORMAT::NONE) {
+    std::string entry = filename;
+    mapping           = std::make_shared<const MappedFile>(Archive::extract_rom(mapping->bytes(), format, &entry));
+    LOG_INFO(GB, "io: extracted {} from {} ({} bytes)", entry, filename, mapping->bytes().size());
+  }
+
+  return File{{}, mapping->bytes().size(), filename, mapping};
+}
+
+SharedMapping::SharedMapping(const std::string& path, size_t size) : length(size) {
+#ifdef UMIBOZU_HAS_MMAP
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("io: failed to open {} for writing", path));
+  }
+
+  // grows with zeros or drops whatever lies past `size`
+  void* address = MAP_FAILED;
+  if (::ftruncate(fd, size) == 0) {
+    address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+
+  if (address == MAP_FAILED) {
+    throw std::runtime_error(fmt::format("io: failed to map {}", path));
+  }
+  base = static_cast<u8*>(address);
+#else
+  throw std::runtime_error(fmt::format("io: shared mappings are unsupported, cannot map {}", path));
+#endif
+}
+
+SharedMapping::~SharedMapping() {
+#ifdef UMIBOZU_HAS_MMAP
+  if (base != nullptr) ::munmap(base, length);
+#endif
+}
+
+void SharedMapping::flush() const {
+#ifdef UMIBOZU_HAS_MMAP
+  if (base != nullptr) ::msync(base, length, MS_SYNC);
+#endif
+}
+
+bool Umibozu::write_file_atomic(const std::string& path, std::span<const u8> bytes) {
+  const std::string temporary = path + ".tmp";
+
+  std::FILE* file = std::fopen(temporary.c_str(), "wb");
+  if (file == nullptr) return false;
+
+  bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && std::fflush(file) == 0;
+#ifdef UMIBOZU_HAS_MMAP
+  ok = ok && ::fsync(::fileno(file)) == 0;
+#endif
+  ok = std::fclose(file) == 0 && ok;
+
+  std::error_code error;
+  if (ok) std::filesystem::rename(temporary, path, error);
+  if (!ok || error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,265 @@
+#include "library.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cart.hpp"
+#include "io.hpp"
+#include "log.hpp"
+
+using namespace Umibozu;
+
+namespace {
+  constexpr char INDEX_MAGIC[8] = {'U', 'M', 'B', 'L', 'I', 'B', 0, 1};
+
+  bool is_rom(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".gb" || extension == ".gbc" || extension == ".gz" || extension == ".zip";
+  }
+
+  std::string lowercase(std::string_view text) {
+    std::string lower(text);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower;
+  }
+
+  std::string search_key(const RomLibrary::Entry& entry) {
+    return lowercase(entry.title) + '\n' + lowercase(std::filesystem::path(entry.path).filename().string());
+  }
+
+  // map, parse and hash one file; false if it can't be a cartridge
+  bool index_entry(RomLibrary::Entry& entry) {
+    try {
+      const File rom                 = read_file(entry.path);
+      const std::span<const u8> data = rom.bytes();
+      if (data.size() < 0x150) return false;
+
+      const Cartridge::Info info = Cartridge::parse_header(data);
+      entry.title                = info.title;
+      entry.mapper_id            = info.mapper_id;
+      entry.rom_banks            = info.rom_banks;
+      entry.ram_banks            = info.ram_banks;
+      entry.cgb_flag             = info.cgb_flag;
+      entry.destination_code     = info.destination_code;
+      entry.crc32                = Checksum::crc32(data);
+      entry.sha1                 = Checksum::sha1(data);
+      entry.key                  = search_key(entry);
+      return true;
+    } catch (const std::exception& e) {
+      LOG_WARN(GB, "library: {}", e.what());
+      return false;
+    }
+  }
+
+  struct Writer {
+    std::vector<u8> bytes;
+
+    template <typename T>
+    void put(T value) {
+      const size_t at = bytes.size();
+      bytes.resize(at + sizeof(T));
+      std::memcpy(bytes.data() + at, &value, sizeof(T));
+    }
+
+    void put(std::string_view text) {
+      put<u16>(text.size());
+      bytes.insert(bytes.end(), text.begin(), text.end());
+    }
+  };
+
+  struct Reader {
+    std::span<const u8> bytes;
+    size_t at = 0;
+    bool ok   = true;
+
+    template <typename T>
+    T get() {
+      T value = {};
+      if (at + sizeof(T) > bytes.size()) {
+        ok = false;
+        return value;
+      }
+      std::memcpy(&value, bytes.data() + at, sizeof(T));
+      at += sizeof(T);
+      return value;
+    }
+
+    std::string get_string() {
+      const u16 length = get<u16>();
+      if (!ok || at + length > bytes.size()) {
+        ok = false;
+        return {};
+      }
+      std::string text(reinterpret_cast<const char*>(bytes.data() + at), length);
+      at += length;
+      return text;
+    }
+  };
+}  // namespace
+
+RomLibrary::ScanStats RomLibrary::scan(const std::vector<std::string>& roots, unsigned threads) {
+  const auto start = std::chrono::steady_clock::now();
+  ScanStats stats;
+
+  std::unordered_map<std::string_view, const Entry*> known;
+  for (const Entry& entry : items) {
+    known.emplace(entry.path, &entry);
+  }
+
+  std::vector<Entry> next;
+  std::vector<size_t> stale;
+  std::unordered_set<std::string> seen;
+
+  for (const std::string& root : roots) {
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::skip_permission_denied, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+      std::error_code stat_error;
+      if (!it->is_regular_file(stat_error) || !is_rom(it->path())) continue;
+
+      Entry entry;
+      entry.path  = std::filesystem::canonical(it->path(), stat_error).string();
+      entry.size  = it->file_size(stat_error);
+      entry.mtime = it->last_write_time(stat_error).time_since_epoch().count();
+      if (stat_error || !seen.insert(entry.path).second) continue;
+
+      auto match = known.find(entry.path);
+      if (match != known.end() && match->second->size == entry.size && match->second->mtime == entry.mtime) {
+        next.push_back(*match->second);
+        stats.reused++;
+      } else {
+        stale.push_back(next.size());
+        next.push_back(std::move(entry));
+      }
+    }
+    if (error) LOG_WARN(GB, "library: {}: {}", root, error.message());
+  }
+
+  // headers and hashes of new or changed files, a file at a time per worker
+  std::vector<u8> valid(next.size(), 1);
+  std::atomic<size_t> cursor = 0;
+  auto work                  = [&] {
+    for (size_t i = cursor++; i < stale.size(); i = cursor++) {
+      valid[stale[i]] = index_entry(next[stale[i]]);
+    }
+  };
+
+  const unsigned workers = std::min<size_t>(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()), stale.size());
+  std::vector<std::thread> pool;
+  for (unsigned i = 1; i < workers; i++) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+
+  // dropped from the index, plus new files that turned out not to be cartridges
+  for (const auto& [path, entry] : known) {
+    if (!seen.contains(std::string(path))) stats.removed++;
+  }
+
+  items.clear();
+  for (size_t i = 0; i < next.size(); i++) {
+    if (valid[i]) items.push_back(std::move(next[i]));
+  }
+  std::sort(items.begin(), items.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+
+  stats.removed += next.size() - items.size();
+  stats.files        = next.size();
+  stats.indexed      = stale.size();
+  stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  LOG_INFO(GB, "library: {} ROMs, {} indexed, {} reused, {} removed in {:.1f} ms", items.size(), stats.indexed, stats.reused, stats.removed, stats.milliseconds);
+  return stats;
+}
+
+bool RomLibrary::save(const std::string& index_path) const {
+  Writer out;
+  out.bytes.insert(out.bytes.end(), std::begin(INDEX_MAGIC), std::end(INDEX_MAGIC));
+  out.put<u32>(items.size());
+
+  for (const Entry& entry : items) {
+    out.put(std::string_view(entry.path));
+    out.put<i64>(entry.mtime);
+    out.put<u64>(entry.size);
+    out.put(std::string_view(entry.title));
+    out.put<u8>(entry.mapper_id);
+    out.put<u16>(entry.rom_banks);
+    out.put<u16>(entry.ram_banks);
+    out.put<u8>(entry.cgb_flag);
+    out.put<u8>(entry.destination_code);
+    out.put<u32>(entry.crc32);
+    out.bytes.insert(out.bytes.end(), entry.sha1.begin(), entry.sha1.end());
+  }
+
+  return write_file_atomic(index_path, out.bytes);
+}
+
+bool RomLibrary::load(const std::string& index_path) {
+  items.clear();
+
+  std::error_code error;
+  if (!std::filesystem::exists(index_path, error)) return false;
+
+  try {
+    const File index = read_file(index_path);
+    Reader in{index.bytes()};
+
+    if (in.bytes.size() < sizeof(INDEX_MAGIC) || std::memcmp(in.bytes.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+      LOG_WARN(GB, "library: {} is not an index, ignoring it", index_path);
+      return false;
+    }
+    in.at = sizeof(INDEX_MAGIC);
+
+    const u32 count = in.get<u32>();
+    for (u32 i = 0; i < count && in.ok; i++) {
+      Entry entry;
+      entry.path             = in.get_string();
+      entry.mtime            = in.get<i64>();
+      entry.size             = in.get<u64>();
+      entry.title            = in.get_string();
+      entry.mapper_id        = in.get<u8>();
+      entry.rom_banks        = in.get<u16>();
+      entry.ram_banks        = in.get<u16>();
+      entry.cgb_flag         = in.get<u8>();
+      entry.destination_code = in.get<u8>();
+      entry.crc32            = in.get<u32>();
+      entry.sha1             = in.get<Checksum::Sha1>();
+      entry.key              = search_key(entry);
+      items.push_back(std::move(entry));
+    }
+
+    if (!in.ok) {
+      LOG_WARN(GB, "library: {} is truncated, ignoring it", index_path);
+      items.clear();
+      return false;
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN(GB, "library: {}", e.what());
+    return false;
+  }
+
+  return true;
+}
+
+std::vector<const RomLibrary::Entry*> RomLibrary::search(const Filter& filter) const {
+  const std::string needle = lowercase(filter.text);
+  std::vector<const Entry*> matches;
+
+  for (const Entry& entry : items) {
+    if (filter.cgb.has_value() && entry.cgb() != *filter.cgb) continue;
+    if (filter.mapper_id.has_value() && entry.mapper_id != *filter.mapper_id) continue;
+
+    if (!needle.empty() && entry.key.find(needle) == std::string::npos) continue;
+    matches.push_back(&entry);
+  }
+  return matches;
+}
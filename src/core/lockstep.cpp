@@ -0,0 +1,534 @@
+#include "lockstep.hpp"
+
+#include <cassert>
+
+#include "bus.hpp"
+#include "cpu.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define UMIBOZU_HAS_AVX2_KERNELS 1
+#define UMIBOZU_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace Umibozu;
+
+namespace {
+  enum class VECTOR_OP : u8 { NONE, NOP, LD, LD_IMM, ALU, ALU_IMM, INC, DEC, CPL, SCF, CCF };
+
+  // ALU opcode group (bits 3-5 of 0x80-0xBF / 0xC6-0xFE)
+  enum ALU_OP : u8 { ADD, ADC, SUB, SBC, AND, XOR, OR, CP };
+
+  constexpr u8 REG_HL_INDIRECT = 6;
+
+  // the byte at `pc` without Bus::read8's telemetry count, so the join checks leave
+  // a lane's page counters as a scalar run would
+  u8 opcode_at(Bus &bus, u16 pc) {
+    const u8 *page = bus.read_page[pc >> 8];
+    return page != nullptr ? page[pc & 0xFF] : bus.read_slow(pc);
+  }
+
+  constexpr std::array<VECTOR_OP, 256> build_vector_op_table() {
+    std::array<VECTOR_OP, 256> table = {};
+
+    table[0x00] = VECTOR_OP::NOP;
+    table[0x2F] = VECTOR_OP::CPL;
+    table[0x37] = VECTOR_OP::SCF;
+    table[0x3F] = VECTOR_OP::CCF;
+
+    for (u8 r = 0; r < 8; r++) {
+      if (r == REG_HL_INDIRECT) continue;
+      table[0x04 | (r << 3)] = VECTOR_OP::INC;
+      table[0x05 | (r << 3)] = VECTOR_OP::DEC;
+      table[0x06 | (r << 3)] = VECTOR_OP::LD_IMM;
+      table[0xC6 | (r << 3)] = VECTOR_OP::ALU_IMM;
+    }
+    // ALU A,n8 has no (HL) form -- 0xF6 is OR A,n8
+    table[0xF6] = VECTOR_OP::ALU_IMM;
+
+    for (u16 op = 0x40; op <= 0xBF; op++) {
+      u8 dst = (op >> 3) & 0x7;
+      u8 src = op & 0x7;
+      if (src == REG_HL_INDIRECT) continue;
+      if (op < 0x80 && dst == REG_HL_INDIRECT) continue;
+      table[op] = op < 0x80 ? VECTOR_OP::LD : VECTOR_OP::ALU;
+    }
+
+    return table;
+  }
+
+  constexpr std::array<VECTOR_OP, 256> VECTOR_OPS = build_vector_op_table();
+
+  constexpr u8 FLAG_Z = 0x80;
+  constexpr u8 FLAG_N = 0x40;
+  constexpr u8 FLAG_H = 0x20;
+  constexpr u8 FLAG_C = 0x10;
+
+  // Scalar kernels -- mirror Instructions::ADD/ADC/SUB/... exactly, including
+  // leaving the low nibble of F untouched.
+  void alu_lane(u8 op, u8 &a, u8 &f, u8 b) {
+    u8 carry_in = (f & FLAG_C) ? 1 : 0;
+    u8 result   = a;
+    bool h = false, c = false, n = false;
+
+    switch (op) {
+      case ADD:
+      case ADC: {
+        u8 ci  = op == ADC ? carry_in : 0;
+        h      = ((a & 0xF) + (b & 0xF) + ci) & 0x10;
+        c      = (a + b + ci) > 0xFF;
+        result = a + b + ci;
+        break;
+      }
+      case SUB:
+      case SBC:
+      case CP: {
+        u8 ci  = op == SBC ? carry_in : 0;
+        h      = ((a & 0xF) - (b & 0xF) - ci) & 0x10;
+        c      = (a - b - ci) < 0;
+        result = a - b - ci;
+        n      = true;
+        break;
+      }
+      case AND: {
+        result = a & b;
+        h      = true;
+        break;
+      }
+      case XOR: {
+        result = a ^ b;
+        break;
+      }
+      case OR: {
+        result = a | b;
+        break;
+      }
+    }
+
+    f = (f & 0x0F) | (result == 0 ? FLAG_Z : 0) | (n ? FLAG_N : 0) | (h ? FLAG_H : 0) | (c ? FLAG_C : 0);
+    if (op != CP) a = result;
+  }
+
+  struct VectorArgs {
+    VECTOR_OP kind;
+    u8 alu_op;
+    u8 *dst;        // destination register array (A for ALU ops)
+    const u8 *src;  // source register / operand array
+    u8 *F;
+    const u8 *mask;
+    size_t lanes;
+  };
+
+  void execute_scalar(const VectorArgs &v) {
+    for (size_t i = 0; i < v.lanes; i++) {
+      if (!v.mask[i]) continue;
+
+      u8 &f = v.F[i];
+      switch (v.kind) {
+        case VECTOR_OP::LD:
+        case VECTOR_OP::LD_IMM: {
+          v.dst[i] = v.src[i];
+          break;
+        }
+        case VECTOR_OP::ALU:
+        case VECTOR_OP::ALU_IMM: {
+          alu_lane(v.alu_op, v.dst[i], f, v.src[i]);
+          break;
+        }
+        case VECTOR_OP::INC: {
+          u8 &r = v.dst[i];
+          bool h = (r & 0xF) == 0xF;
+          r++;
+          f = (f & (0x0F | FLAG_C)) | (r == 0 ? FLAG_Z : 0) | (h ? FLAG_H : 0);
+          break;
+        }
+        case VECTOR_OP::DEC: {
+          u8 &r = v.dst[i];
+          bool h = (r & 0xF) == 0;
+          r--;
+          f = (f & (0x0F | FLAG_C)) | (r == 0 ? FLAG_Z : 0) | FLAG_N | (h ? FLAG_H : 0);
+          break;
+        }
+        case VECTOR_OP::CPL: {
+          v.dst[i] ^= 0xFF;
+          f |= FLAG_N | FLAG_H;
+          break;
+        }
+        case VECTOR_OP::SCF: {
+          f = (f & (0x0F | FLAG_Z)) | FLAG_C;
+          break;
+        }
+        case VECTOR_OP::CCF: {
+          f = (f & (0x0F | FLAG_Z | FLAG_C)) ^ FLAG_C;
+          break;
+        }
+        case VECTOR_OP::NOP:
+        case VECTOR_OP::NONE: {
+          break;
+        }
+      }
+    }
+  }
+
+#ifdef UMIBOZU_HAS_AVX2_KERNELS
+  UMIBOZU_AVX2 inline __m256i load(const u8 *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+  UMIBOZU_AVX2 inline void store(u8 *p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+  UMIBOZU_AVX2 inline __m256i splat(u8 v) { return _mm256_set1_epi8(static_cast<char>(v)); }
+  UMIBOZU_AVX2 inline __m256i is_zero(__m256i v) { return _mm256_cmpeq_epi8(v, _mm256_setzero_si256()); }
+  UMIBOZU_AVX2 inline __m256i bit_set(__m256i v, u8 bit) { return _mm256_cmpeq_epi8(_mm256_and_si256(v, splat(bit)), splat(bit)); }
+
+  // compose F from 0x00/0xFF lane masks, keeping `keep` bits of the old value
+  UMIBOZU_AVX2 inline __m256i make_flags(__m256i f, u8 keep, __m256i z, __m256i n, __m256i h, __m256i c) {
+    __m256i out = _mm256_and_si256(f, splat(keep));
+    out         = _mm256_or_si256(out, _mm256_and_si256(z, splat(FLAG_Z)));
+    out         = _mm256_or_si256(out, _mm256_and_si256(n, splat(FLAG_N)));
+    out         = _mm256_or_si256(out, _mm256_and_si256(h, splat(FLAG_H)));
+    out         = _mm256_or_si256(out, _mm256_and_si256(c, splat(FLAG_C)));
+    return out;
+  }
+
+  UMIBOZU_AVX2 void execute_avx2(const VectorArgs &v) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+    const __m256i nib  = splat(0x0F);
+
+    for (size_t i = 0; i < v.lanes; i += Lockstep::LANE_WIDTH) {
+      __m256i m = load(v.mask + i);
+      if (_mm256_testz_si256(m, m)) continue;
+
+      __m256i f = load(v.F + i);
+
+      switch (v.kind) {
+        case VECTOR_OP::LD:
+        case VECTOR_OP::LD_IMM: {
+          store(v.dst + i, _mm256_blendv_epi8(load(v.dst + i), load(v.src + i), m));
+          break;
+        }
+        case VECTOR_OP::ALU:
+        case VECTOR_OP::ALU_IMM: {
+          __m256i a        = load(v.dst + i);
+          __m256i b        = load(v.src + i);
+          __m256i carry_in = _mm256_and_si256(bit_set(f, FLAG_C), splat(1));
+
+          __m256i result = a, h = zero, c = zero, n = zero;
+
+          switch (v.alu_op) {
+            case ADD:
+            case ADC: {
+              __m256i ci  = v.alu_op == ADC ? carry_in : zero;
+              __m256i sum = _mm256_add_epi8(a, b);
+              result      = _mm256_add_epi8(sum, ci);
+              h           = bit_set(_mm256_add_epi8(_mm256_add_epi8(_mm256_and_si256(a, nib), _mm256_and_si256(b, nib)), ci), 0x10);
+              // carry out of a + b, or of (a + b) + carry_in when a + b == 0xFF
+              __m256i c1 = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_adds_epu8(a, b), sum), ones);
+              __m256i c2 = _mm256_and_si256(_mm256_cmpeq_epi8(sum, ones), _mm256_cmpeq_epi8(ci, splat(1)));
+              c          = _mm256_or_si256(c1, c2);
+              break;
+            }
+            case SUB:
+            case SBC:
+            case CP: {
+              __m256i ci   = v.alu_op == SBC ? carry_in : zero;
+              __m256i diff = _mm256_sub_epi8(a, b);
+              result       = _mm256_sub_epi8(diff, ci);
+              h            = bit_set(_mm256_sub_epi8(_mm256_sub_epi8(_mm256_and_si256(a, nib), _mm256_and_si256(b, nib)), ci), 0x10);
+              // borrow when b > a, or when a == b and a carry is subtracted as well
+              __m256i c1 = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a), ones);
+              __m256i c2 = _mm256_and_si256(is_zero(diff), _mm256_cmpeq_epi8(ci, splat(1)));
+              c          = _mm256_or_si256(c1, c2);
+              n          = ones;
+              break;
+            }
+            case AND: {
+              result = _mm256_and_si256(a, b);
+              h      = ones;
+              break;
+            }
+            case XOR: {
+              result = _mm256_xor_si256(a, b);
+              break;
+            }
+            case OR: {
+              result = _mm256_or_si256(a, b);
+              break;
+            }
+          }
+
+          __m256i new_f = make_flags(f, 0x0F, is_zero(result), n, h, c);
+          store(v.F + i, _mm256_blendv_epi8(f, new_f, m));
+          if (v.alu_op != CP) store(v.dst + i, _mm256_blendv_epi8(a, result, m));
+          break;
+        }
+        case VECTOR_OP::INC:
+        case VECTOR_OP::DEC: {
+          bool inc       = v.kind == VECTOR_OP::INC;
+          __m256i r      = load(v.dst + i);
+          __m256i low    = _mm256_and_si256(r, nib);
+          __m256i h      = inc ? _mm256_cmpeq_epi8(low, nib) : is_zero(low);
+          __m256i result = inc ? _mm256_add_epi8(r, splat(1)) : _mm256_sub_epi8(r, splat(1));
+          __m256i new_f  = make_flags(f, 0x0F | FLAG_C, is_zero(result), inc ? zero : ones, h, zero);
+
+          store(v.dst + i, _mm256_blendv_epi8(r, result, m));
+          store(v.F + i, _mm256_blendv_epi8(f, new_f, m));
+          break;
+        }
+        case VECTOR_OP::CPL: {
+          __m256i a = load(v.dst + i);
+          store(v.dst + i, _mm256_blendv_epi8(a, _mm256_xor_si256(a, ones), m));
+          store(v.F + i, _mm256_blendv_epi8(f, _mm256_or_si256(f, splat(FLAG_N | FLAG_H)), m));
+          break;
+        }
+        case VECTOR_OP::SCF: {
+          __m256i new_f = _mm256_or_si256(_mm256_and_si256(f, splat(0x0F | FLAG_Z)), splat(FLAG_C));
+          store(v.F + i, _mm256_blendv_epi8(f, new_f, m));
+          break;
+        }
+        case VECTOR_OP::CCF: {
+          __m256i new_f = _mm256_xor_si256(_mm256_and_si256(f, splat(0x0F | FLAG_Z | FLAG_C)), splat(FLAG_C));
+          store(v.F + i, _mm256_blendv_epi8(f, new_f, m));
+          break;
+        }
+        case VECTOR_OP::NOP:
+        case VECTOR_OP::NONE: {
+          break;
+        }
+      }
+    }
+  }
+
+  bool host_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+  }
+#else
+  bool host_has_avx2() { return false; }
+#endif
+}  // namespace
+
+Lockstep::Lockstep(std::span<GB *> lanes) : gbs(lanes.begin(), lanes.end()) {
+  assert(!gbs.empty());
+
+  use_avx2 = host_has_avx2();
+
+  padded = ((gbs.size() + LANE_WIDTH - 1) / LANE_WIDTH) * LANE_WIDTH;
+
+  for (auto &reg : r8) {
+    reg.assign(padded, 0);
+  }
+  F.assign(padded, 0);
+  SP.assign(padded, 0);
+  PC.assign(padded, 0);
+  mask.assign(padded, 0);
+  operand.assign(padded, 0);
+  frame_count.assign(gbs.size(), 0);
+
+  for (size_t lane = 0; lane < gbs.size(); lane++) {
+    store_lane(lane);
+  }
+}
+
+void Lockstep::load_lane(size_t lane) {
+  SM83 &cpu = gbs[lane]->cpu;
+
+  cpu.B  = r8[0][lane];
+  cpu.C  = r8[1][lane];
+  cpu.D  = r8[2][lane];
+  cpu.E  = r8[3][lane];
+  cpu.H  = r8[4][lane];
+  cpu.L  = r8[5][lane];
+  cpu.A  = r8[7][lane];
+  cpu.F  = F[lane];
+  cpu.SP = SP[lane];
+  cpu.PC = PC[lane];
+}
+
+void Lockstep::store_lane(size_t lane) {
+  const SM83 &cpu = gbs[lane]->cpu;
+
+  r8[0][lane] = cpu.B;
+  r8[1][lane] = cpu.C;
+  r8[2][lane] = cpu.D;
+  r8[3][lane] = cpu.E;
+  r8[4][lane] = cpu.H;
+  r8[5][lane] = cpu.L;
+  r8[7][lane] = cpu.A;
+  F[lane]     = cpu.F;
+  SP[lane]    = cpu.SP;
+  PC[lane]    = cpu.PC;
+}
+
+void Lockstep::sync_to_lanes() {
+  for (size_t lane = 0; lane < gbs.size(); lane++) {
+    load_lane(lane);
+  }
+}
+
+void Lockstep::count_frame(size_t lane) {
+  PPU &ppu = gbs[lane]->ppu;
+  if (ppu.frame_queued) {
+    ppu.frame_queued = false;
+    frame_count[lane]++;
+  }
+}
+
+void Lockstep::scalar_step(size_t lane) {
+  load_lane(lane);
+  gbs[lane]->cpu.run_instruction();
+  store_lane(lane);
+
+  scalar_steps++;
+}
+
+bool Lockstep::vector_eligible(size_t lane) const {
+  const SM83 &cpu = gbs[lane]->cpu;
+
+  if (cpu.status != SM83::STATUS::ACTIVE || cpu.ei_queued) return false;
+
+  // VRAM DMA stalls are paid inside run_instruction, and OAM DMA changes what the CPU reads
+  if (cpu.bus->dma_stall_cycles > 0 || cpu.bus->oam_dma_cycles > 0) return false;
+
+  // interrupt dispatch pushes PC and jumps -- leave that to the scalar path
+  if (cpu.IME && cpu.bus->interrupt_pending()) return false;
+
+  // only fetch from ROM, where the opcode can't change under us between lanes
+  return PC[lane] < 0x8000;
+}
+
+void Lockstep::step() {
+  // majority vote over the eligible lanes' PCs, so the vector group follows
+  // the path most lanes are on rather than whichever lane happens to be first
+  size_t leader = gbs.size();
+  u32 votes     = 0;
+  for (size_t lane = 0; lane < gbs.size(); lane++) {
+    mask[lane] = vector_eligible(lane) ? 0xFF : 0;
+    if (!mask[lane]) continue;
+
+    if (votes == 0) {
+      leader = lane;
+      votes  = 1;
+    } else if (PC[lane] == PC[leader]) {
+      votes++;
+    } else {
+      votes--;
+    }
+  }
+
+  u16 group_pc = leader < gbs.size() ? PC[leader] : 0;
+  u8 opcode    = leader < gbs.size() ? opcode_at(*gbs[leader]->cpu.bus, group_pc) : 0;
+  VECTOR_OP op = leader < gbs.size() ? VECTOR_OPS[opcode] : VECTOR_OP::NONE;
+
+  if (op == VECTOR_OP::NONE) {
+    for (size_t lane = 0; lane < gbs.size(); lane++) {
+      scalar_step(lane);
+      count_frame(lane);
+    }
+    return;
+  }
+
+  bool has_immediate = op == VECTOR_OP::LD_IMM || op == VECTOR_OP::ALU_IMM;
+
+  for (size_t lane = 0; lane < gbs.size(); lane++) {
+    // the ROM under PC can differ per lane -- other banks, Game Genie pages, another
+    // image altogether -- so a lane only joins if its own opcode matches too
+    bool joins = lane == leader || (mask[lane] && PC[lane] == group_pc && opcode_at(*gbs[lane]->cpu.bus, group_pc) == opcode);
+
+    if (!joins) {
+      mask[lane] = 0;
+      scalar_step(lane);
+      count_frame(lane);
+      continue;
+    }
+
+    SM83 &cpu  = gbs[lane]->cpu;
+    mask[lane] = 0xFF;
+
+    (void)cpu.fetch_opcode(group_pc);  // same cycle and hooks as the scalar fetch
+    if (has_immediate) {
+      operand[lane] = cpu.read8(group_pc + 1);
+    }
+
+    PC[lane] = group_pc + (has_immediate ? 2 : 1);
+    vector_steps++;
+    count_frame(lane);
+  }
+
+  execute_vector(opcode);
+}
+
+void Lockstep::execute_vector(u8 opcode) {
+  VectorArgs args = {
+      .kind   = VECTOR_OPS[opcode],
+      .alu_op = static_cast<u8>((opcode >> 3) & 0x7),
+      .dst    = nullptr,
+      .src    = nullptr,
+      .F      = F.data(),
+      .mask   = mask.data(),
+      .lanes  = padded,
+  };
+
+  u8 dst = (opcode >> 3) & 0x7;
+  u8 src = opcode & 0x7;
+
+  switch (args.kind) {
+    case VECTOR_OP::LD: {
+      args.dst = r8[dst].data();
+      args.src = r8[src].data();
+      break;
+    }
+    case VECTOR_OP::LD_IMM:
+    case VECTOR_OP::INC:
+    case VECTOR_OP::DEC: {
+      args.dst = r8[dst].data();
+      args.src = operand.data();
+      break;
+    }
+    case VECTOR_OP::ALU: {
+      args.dst = r8[7].data();
+      args.src = r8[src].data();
+      break;
+    }
+    case VECTOR_OP::ALU_IMM: {
+      args.dst = r8[7].data();
+      args.src = operand.data();
+      break;
+    }
+    case VECTOR_OP::CPL: {
+      args.dst = r8[7].data();
+      break;
+    }
+    case VECTOR_OP::SCF:
+    case VECTOR_OP::CCF:
+    case VECTOR_OP::NOP:
+    case VECTOR_OP::NONE: {
+      break;
+    }
+  }
+
+  if (args.kind == VECTOR_OP::NOP) return;
+
+#ifdef UMIBOZU_HAS_AVX2_KERNELS
+  if (use_avx2) {
+    execute_avx2(args);
+    return;
+  }
+#endif
+  execute_scalar(args);
+}
+
+void Lockstep::run_frames(u64 frames) {
+  std::vector<u64> target(frame_count);
+  for (auto &t : target) {
+    t += frames;
+  }
+
+  auto done = [&] {
+    for (size_t lane = 0; lane < gbs.size(); lane++) {
+      if (frame_count[lane] < target[lane]) return false;
+    }
+    return true;
+  };
+
+  while (!done()) {
+    step();
+  }
+}
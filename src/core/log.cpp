@@ -0,0 +1,166 @@
+#include "core/log.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+  constexpr size_t CAPACITY = 4096;  // power of two
+  constexpr size_t MASK     = CAPACITY - 1;
+
+#define UMIBOZU_LOG_NAME(name) #name,
+  constexpr const char* CATEGORY_NAMES[] = {UMIBOZU_LOG_CATEGORIES(UMIBOZU_LOG_NAME)};
+#undef UMIBOZU_LOG_NAME
+
+  constexpr const char* LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    LOG_CATEGORY category;
+    LOG_LEVEL level;
+    u16 length;
+    std::array<char, Log::MESSAGE_SIZE> text;
+  };
+
+  // bounded MPMC queue (Vyukov): a slot is free for the producer at position p when its
+  // sequence equals p, and holds a message for the consumer when it equals p + 1
+  struct Logger {
+    std::array<Slot, CAPACITY> slots;
+    alignas(64) std::atomic<size_t> enqueue_pos = 0;
+    alignas(64) std::atomic<size_t> dequeue_pos = 0;
+    std::atomic<u64> dropped                    = 0;
+
+    std::atomic<bool> running = true;
+    std::thread drain_thread;
+
+    std::mutex flush_mutex;
+    std::condition_variable flush_cv;
+
+    Logger() {
+      for (size_t i = 0; i < CAPACITY; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      drain_thread = std::thread([this] { drain_loop(); });
+      std::atexit([] { instance().stop(); });
+    }
+
+    static Logger& instance() {
+      // never destroyed, so objects torn down after exit handlers can still log
+      static Logger* logger = new Logger();
+      return *logger;
+    }
+
+    bool push(LOG_CATEGORY category, LOG_LEVEL level, std::string_view message) {
+      size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+      Slot* slot;
+
+      while (true) {
+        slot          = &slots[pos & MASK];
+        size_t seq    = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+          if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+          dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        } else {
+          pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->category = category;
+      slot->level    = level;
+      slot->length   = message.size();
+      std::memcpy(slot->text.data(), message.data(), message.size());
+      slot->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    // single consumer: the drain thread, or the caller after stop()
+    size_t drain() {
+      size_t count = 0;
+
+      while (true) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Slot& slot = slots[pos & MASK];
+
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) break;
+
+        if (slot.level >= LOG_LEVEL::WARN) {
+          fmt::print("[{}] [{}] {}\n", CATEGORY_NAMES[(u8)slot.category], LEVEL_NAMES[(u8)slot.level], std::string_view(slot.text.data(), slot.length));
+        } else {
+          fmt::print("[{}] {}\n", CATEGORY_NAMES[(u8)slot.category], std::string_view(slot.text.data(), slot.length));
+        }
+
+        dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+        slot.sequence.store(pos + CAPACITY, std::memory_order_release);
+        count++;
+      }
+
+      if (count > 0) {
+        std::fflush(stdout);
+        // under the lock, so a flush() between its check and its wait can't miss this
+        std::lock_guard lock(flush_mutex);
+        flush_cv.notify_all();
+      }
+      return count;
+    }
+
+    void drain_loop() {
+      while (running.load(std::memory_order_acquire)) {
+        if (drain() == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+      }
+    }
+
+    void flush() {
+      size_t target = enqueue_pos.load(std::memory_order_acquire);
+
+      if (!running.load(std::memory_order_acquire)) {
+        drain();
+        return;
+      }
+
+      std::unique_lock lock(flush_mutex);
+      flush_cv.wait_for(lock, std::chrono::seconds(1), [&] { return dequeue_pos.load(std::memory_order_acquire) >= target; });
+    }
+
+    void stop() {
+      if (!running.exchange(false)) return;
+      drain_thread.join();
+      drain();
+    }
+  };
+}  // namespace
+
+bool Log::push(LOG_CATEGORY category, LOG_LEVEL level, std::string_view message) {
+  Logger& logger = Logger::instance();
+
+  // after shutdown there is nobody draining -- write through
+  if (!logger.running.load(std::memory_order_acquire)) {
+    fmt::print("[{}] {}\n", CATEGORY_NAMES[(u8)category], message);
+    return true;
+  }
+
+  if (level < LOG_LEVEL::ERROR) return logger.push(category, level, message);
+
+  // an error is often the last thing before an assert or abort: have it written
+  // before returning, and write it through if the ring is full
+  const bool queued = logger.push(category, level, message);
+  logger.flush();
+  if (!queued) {
+    fmt::print("[{}] [{}] {}\n", CATEGORY_NAMES[(u8)category], LEVEL_NAMES[(u8)level], message);
+    std::fflush(stdout);
+  }
+  return true;
+}
+
+void Log::flush() { Logger::instance().flush(); }
+
+u64 Log::dropped() { return Logger::instance().dropped.load(std::memory_order_relaxed); }
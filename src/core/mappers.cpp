@@ -1,27 +1,76 @@
+#include "core/mappers.hpp"
+
+#include <algorithm>
 #include <stdexcept>
 
 #include "cart_constants.hpp"
-#include "core/mapper.hpp"
-#include "mappers/rom_only.cpp"
-#include "mappers/mbc1.cpp"
-#include "mappers/mbc3.cpp"
-#include "mappers/mbc5.cpp"
+#include "cheats.hpp"
+#include "log.hpp"
+
+void Mapper::map_rom(u8 window, u32 bank) {
+  const size_t bank_count = bus->cart->memory.size() / 0x4000;
+  const u16 address       = window * 0x4000;
+
+  // headers can claim more banks than the image holds -- wrap like the address lines would
+  if (bank_count == 0) {
+    rom_window[window] = nullptr;
+  } else {
+    rom_window[window] = bus->cart->memory.data() + ((bank % bank_count) * 0x4000);
+  }
+
+  bus->map_read(address, 0x4000, const_cast<u8*>(rom_window[window]));
 
-Mapper* get_mapper_by_id(u8 mapper_id) {
-  fmt::println("[MAPPER] MAPPER ID: {:#04x} ({})", mapper_id, cart_types.at(mapper_id));
+  if (bus->cheats != nullptr && bus->cheats->has_rom_patches()) [[unlikely]] {
+    bus->cheats->overlay_rom(*bus, address, rom_window[window]);
+  }
+}
+
+void Mapper::map_ram(u32 bank, u16 mask, bool direct_writes) {
+  const u32 bank_count = std::max<u32>(bus->cart->info.ram_banks, 1);
+  const size_t offset  = (bank % bank_count) * 0x2000;
+
+  // a header without RAM still gets its enable writes -- the window stays open bus
+  if (offset + mask + 1 > bus->cart->ext_ram.size()) {
+    unmap_ram();
+    return;
+  }
 
-  Mapper* mapper;
+  ram_window        = bus->cart->ext_ram.data() + offset;
+  ram_window_mask   = mask;
+  ram_direct_writes = direct_writes;
+
+  // every page of the window sees `mask` bytes of RAM, repeated
+  for (u32 offset = 0; offset < 0x2000; offset += 0x100) {
+    u8* page = ram_window + (offset & mask);
+    bus->map_read(0xA000 + offset, 0x100, page, PAGE_HANDLER::MAPPER);
+    bus->map_write(0xA000 + offset, 0x100, direct_writes ? page : nullptr, PAGE_HANDLER::MAPPER);
+  }
+}
+
+void Mapper::unmap_ram() {
+  ram_window = nullptr;
+  bus->map_read(0xA000, 0x2000, nullptr, PAGE_HANDLER::MAPPER);
+  bus->map_write(0xA000, 0x2000, nullptr, PAGE_HANDLER::MAPPER);
+}
+
+void CartMapper::load(u8 mapper_id, Bus* bus) {
+  LOG_INFO(MAPPER, "MAPPER ID: {:#04x} ({})", mapper_id, cart_types.at(mapper_id));
 
   switch (mapper_id) {
     case 0x0:
     case 0x8: {
-      mapper = new ROM_ONLY();
+      kind.emplace<ROM_ONLY>(bus);
       break;
     }
     case 0x1:
     case 0x2:
     case 0x3: {
-      mapper = new MBC1();
+      kind.emplace<MBC1>(bus);
+      break;
+    }
+    case 0x5:
+    case 0x6: {
+      kind.emplace<MBC2>(bus);
       break;
     }
     case 0xF:
@@ -29,7 +78,7 @@ Mapper* get_mapper_by_id(u8 mapper_id) {
     case 0x11:
     case 0x12:
     case 0x13: {
-      mapper = new MBC3();
+      kind.emplace<MBC3>(bus);
       break;
     }
     case 0x19:
@@ -38,14 +87,28 @@ Mapper* get_mapper_by_id(u8 mapper_id) {
     case 0x1C:
     case 0x1D:
     case 0x1E: {
-      mapper = new MBC5();
+      kind.emplace<MBC5>(bus);
+      break;
+    }
+    case 0xFF: {
+      kind.emplace<HuC1>(bus);
       break;
     }
 
     default: {
+      kind.emplace<std::monostate>();
+      base = nullptr;
       throw std::runtime_error(fmt::format("[MAPPER] unimplemented mapper with ID: {:d} ({})", mapper_id, cart_types.at(mapper_id)));
     }
   }
-  mapper->id = mapper_id;
-  return mapper;
-}
\ No newline at end of file
+  base = std::visit(
+      [](auto& mapper) -> Mapper* {
+        if constexpr (std::is_same_v<std::decay_t<decltype(mapper)>, std::monostate>) {
+          return nullptr;
+        } else {
+          return &mapper;
+        }
+      },
+      kind);
+  base->id = mapper_id;
+}
@@ -0,0 +1,244 @@
+#include "patch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "checksum.hpp"
+#include "log.hpp"
+
+using namespace Umibozu;
+
+namespace {
+  [[noreturn]] void fail(std::string_view format, std::string_view reason) { throw std::runtime_error(fmt::format("patch: {}: {}", format, reason)); }
+
+  // cursor over the patch body; every read is bounds checked against `end`
+  struct Stream {
+    std::span<const u8> bytes;
+    size_t at;
+    size_t end;
+    std::string_view format;
+
+    u8 byte() {
+      if (at >= end) fail(format, "unexpected end of patch");
+      return bytes[at++];
+    }
+
+    std::span<const u8> take(size_t length) {
+      if (length > end - at) fail(format, "unexpected end of patch");
+      at += length;
+      return bytes.subspan(at - length, length);
+    }
+
+    u32 big_endian(int width) {
+      u32 value = 0;
+      for (int i = 0; i < width; i++) {
+        value = (value << 8) | byte();
+      }
+      return value;
+    }
+
+    // BPS / UPS variable-length number: 7 bits per byte, the high bit ends it, and
+    // each continuation adds one so every value has a single encoding
+    u64 number() {
+      u64 value = 0;
+      u64 shift = 1;
+      while (true) {
+        const u8 x = byte();
+        value += (x & 0x7F) * shift;
+        if (x & 0x80) return value;
+        shift <<= 7;
+        value += shift;
+        if (shift > (u64{1} << 56)) fail(format, "number out of range");
+      }
+    }
+  };
+
+  u32 footer_u32(std::span<const u8> patch, size_t from_end) {
+    const size_t at = patch.size() - from_end;
+    return patch[at] | (patch[at + 1] << 8) | (patch[at + 2] << 16) | ((u32)patch[at + 3] << 24);
+  }
+
+  // the three CRC-32s closing a BPS / UPS patch
+  struct Footer {
+    u32 source;
+    u32 target;
+    u32 patch;
+  };
+
+  Footer check_footer(std::span<const u8> source, std::span<const u8> patch, std::string_view format) {
+    if (patch.size() < 4 + 12) fail(format, "too short");
+
+    const Footer footer = {footer_u32(patch, 12), footer_u32(patch, 8), footer_u32(patch, 4)};
+    if (Checksum::crc32(patch.first(patch.size() - 4)) != footer.patch) fail(format, "patch checksum mismatch, the file is damaged");
+    if (Checksum::crc32(source) != footer.source) fail(format, "source checksum mismatch, the patch is for a different ROM");
+    return footer;
+  }
+
+  std::vector<u8> apply_ips(std::span<const u8> source, std::span<const u8> patch) {
+    Stream in{patch, 5, patch.size(), "IPS"};
+    std::vector<u8> target(source.begin(), source.end());
+
+    while (true) {
+      const u32 offset = in.big_endian(3);
+      if (offset == 0x454F46) break;  // "EOF"
+
+      u32 length = in.big_endian(2);
+      if (length != 0) {
+        const std::span<const u8> data = in.take(length);
+        if (offset + length > target.size()) target.resize(offset + length);
+        std::copy(data.begin(), data.end(), target.begin() + offset);
+      } else {
+        // run-length record: count, then the byte to repeat
+        length         = in.big_endian(2);
+        const u8 value = in.byte();
+        if (offset + length > target.size()) target.resize(offset + length);
+        std::fill_n(target.begin() + offset, length, value);
+      }
+    }
+
+    // optional truncation extension: the final size after "EOF"
+    if (in.end - in.at >= 3) target.resize(in.big_endian(3));
+    return target;
+  }
+
+  std::vector<u8> apply_bps(std::span<const u8> source, std::span<const u8> patch) {
+    const Footer footer = check_footer(source, patch, "BPS");
+    Stream in{patch, 4, patch.size() - 12, "BPS"};
+
+    if (in.number() != source.size()) fail("BPS", "source size mismatch");
+    const u64 target_size = in.number();
+    in.take(in.number());  // metadata
+
+    std::vector<u8> target(target_size);
+    size_t out          = 0;
+    i64 source_relative = 0;
+    i64 target_relative = 0;
+
+    auto relative = [&](i64& cursor, size_t limit) {
+      const u64 data = in.number();
+      cursor += (data & 1 ? -1 : 1) * (i64)(data >> 1);
+      if (cursor < 0 || (u64)cursor > limit) fail("BPS", "copy offset out of range");
+    };
+
+    while (in.at < in.end) {
+      const u64 data   = in.number();
+      const u64 length = (data >> 2) + 1;
+      if (length > target.size() - out) fail("BPS", "action writes past the target");
+
+      switch (data & 3) {
+        case 0: {  // SourceRead: the source bytes at the same offset
+          if (out + length > source.size()) fail("BPS", "source read out of range");
+          std::copy_n(source.begin() + out, length, target.begin() + out);
+          break;
+        }
+        case 1: {  // TargetRead: bytes from the patch
+          const std::span<const u8> bytes = in.take(length);
+          std::copy(bytes.begin(), bytes.end(), target.begin() + out);
+          break;
+        }
+        case 2: {  // SourceCopy: from anywhere in the source
+          relative(source_relative, source.size());
+          if (source_relative + length > source.size()) fail("BPS", "source copy out of range");
+          std::copy_n(source.begin() + source_relative, length, target.begin() + out);
+          source_relative += length;
+          break;
+        }
+        case 3: {  // TargetCopy: from earlier output, byte by byte since the ranges may overlap
+          relative(target_relative, out);
+          for (u64 i = 0; i < length; i++) {
+            target[out + i] = target[target_relative++];
+          }
+          break;
+        }
+      }
+      out += length;
+    }
+
+    if (out != target.size()) fail("BPS", "patch ends before the target is complete");
+    if (Checksum::crc32(target) != footer.target) fail("BPS", "target checksum mismatch");
+    return target;
+  }
+
+  std::vector<u8> apply_ups(std::span<const u8> source, std::span<const u8> patch) {
+    const Footer footer = check_footer(source, patch, "UPS");
+    Stream in{patch, 4, patch.size() - 12, "UPS"};
+
+    if (in.number() != source.size()) fail("UPS", "source size mismatch");
+    const u64 target_size = in.number();
+
+    // unchanged bytes are the source's; past its end they start out as zero
+    std::vector<u8> target(target_size, 0);
+    std::copy_n(source.begin(), std::min<size_t>(source.size(), target_size), target.begin());
+
+    size_t out = 0;
+    while (in.at < in.end) {
+      out += in.number();
+
+      // XOR run, terminated by a zero byte that stands for one unchanged byte
+      while (true) {
+        const u8 x = in.byte();
+        if (x == 0) {
+          out++;
+          break;
+        }
+        if (out >= target.size()) fail("UPS", "hunk writes past the target");
+        target[out++] ^= x;
+      }
+    }
+
+    if (Checksum::crc32(target) != footer.target) fail("UPS", "target checksum mismatch");
+    return target;
+  }
+}  // namespace
+
+Patch::FORMAT Patch::detect(std::span<const u8> patch) {
+  if (patch.size() >= 5 && std::memcmp(patch.data(), "PATCH", 5) == 0) return FORMAT::IPS;
+  if (patch.size() >= 4 && std::memcmp(patch.data(), "BPS1", 4) == 0) return FORMAT::BPS;
+  if (patch.size() >= 4 && std::memcmp(patch.data(), "UPS1", 4) == 0) return FORMAT::UPS;
+  return FORMAT::UNKNOWN;
+}
+
+std::vector<u8> Patch::apply(std::span<const u8> source, std::span<const u8> patch) {
+  switch (detect(patch)) {
+    case FORMAT::IPS: {
+      return apply_ips(source, patch);
+    }
+    case FORMAT::BPS: {
+      return apply_bps(source, patch);
+    }
+    case FORMAT::UPS: {
+      return apply_ups(source, patch);
+    }
+    case FORMAT::UNKNOWN: {
+      break;
+    }
+  }
+  throw std::runtime_error("patch: not an IPS, BPS or UPS file");
+}
+
+File Patch::apply_cached(const File& rom, const File& patch, const std::string& cache_dir) {
+  const std::span<const u8> source = rom.bytes();
+  const std::string key            = fmt::format("{:08x}-{:x}-{}", Checksum::crc32(source), source.size(), Checksum::to_hex(Checksum::sha1(patch.bytes())));
+  const std::filesystem::path path = std::filesystem::path(cache_dir) / (key + ".gb");
+
+  std::error_code error;
+  if (std::filesystem::exists(path, error)) {
+    File cached = read_file(path.string());
+    cached.path = rom.path;
+    LOG_DEBUG(GB, "patch: {} from cache", patch.path);
+    return cached;
+  }
+
+  std::vector<u8> patched = apply(source, patch.bytes());
+  LOG_INFO(GB, "patch: applied {} ({} -> {} bytes)", patch.path, source.size(), patched.size());
+
+  std::filesystem::create_directories(cache_dir, error);
+  if (!write_file_atomic(path.string(), patched)) {
+    LOG_WARN(GB, "patch: could not cache the patched image at {}", path.string());
+  }
+
+  const u64 size = patched.size();
+  return File{std::move(patched), size, rom.path};
+}
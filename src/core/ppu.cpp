@@ -8,8 +8,13 @@
 #include <thread>
 
 #include "bus.hpp"
+#include "cheats.hpp"
 #include "common.hpp"
+#include "mappers.hpp"
+#include "save_flusher.hpp"
 #include "stopwatch.hpp"
+#include "tile_cache.hpp"
+#include "tile_decode.hpp"
 
 u8 PPU::get_sprite_size() const { return lcdc.sprite_size == 0 ? 8 : 16; }
 
@@ -46,16 +51,6 @@ void PPU::add_sprite_to_buffer(u8 spriteIndex) {
   sprite_buf.push_back(current_sprite);
 }
 
-void PPU::flip(Tile& t, FLIP_AXIS a) {
-  if (a == FLIP_AXIS::X) {
-    for (u8 y = 0; y < 8; y++) {
-      std::reverse(std::begin(t.pixel_data[y]), std::end(t.pixel_data[y]));
-    }
-  } else {
-    std::reverse(std::begin(t.pixel_data), std::end(t.pixel_data));
-  }
-}
-
 void PPU::tick(u16 dots_inc) {
   assert(bus != nullptr);
   assert(bus->io[LY] <= 153);
@@ -104,25 +99,17 @@ void PPU::tick(u16 dots_inc) {
     }
 
     case RENDERING_MODE::HBLANK: {
-      process_hdma_chunk();
-
       if (dots == 456) {
-        x_pos_offset        = 0;
-        dots                = 0;
-        sprite_index        = 0;
-        window_x_pos_offset = 0;
+        dots         = 0;
+        sprite_index = 0;
 
         sprite_buf.clear();
 
         if (window_enabled && lcdc.window_disp_enable == 1 && bus->io[WX] < 167) {
           window_current_y++;
-          if (window_current_y % 8 == 0 && window_current_y != 0) {
-            window_line_count++;
-          }
         }
 
         increment_scanline();
-        hdma_executed_on_scanline = false;
         if (bus->io[LY] == 144) {
           set_ppu_mode(RENDERING_MODE::VBLANK);
         } else {
@@ -134,10 +121,8 @@ void PPU::tick(u16 dots_inc) {
     }
 
     case RENDERING_MODE::VBLANK: {
-      window_enabled      = false;
-      window_line_count   = 0;
-      window_x_pos_offset = 0;
-      window_current_y    = 0;
+      window_enabled   = false;
+      window_current_y = 0;
 
       // Increment scanline, but we're still in VBLANK
       if (dots == 456 && bus->io[LY] != 153) {
@@ -175,122 +160,118 @@ void PPU::increment_scanline() const {
   }
 }
 
-inline std::array<Pixel, 8> PPU::decode_pixel_row(u8 high_byte, u8 low_byte) {
-  std::array<Pixel, 8> pixel_array;
-
-  for (u8 i = 0; i < 8; i++) {
-    pixel_array[i] = static_cast<u8>(((high_byte & (1 << i)) != 0 ? 2 : 0) + ((low_byte & (1 << i)) != 0 ? 1 : 0));
-  }
-
-  return pixel_array;
-}
+std::array<Pixel, 8> PPU::decode_pixel_row(u8 high_byte, u8 low_byte) { return Umibozu::TileDecode::row(high_byte, low_byte); }
 
-inline Tile PPU::get_tile_data(u16 address, bool sprite) const {
-  Tile tile;
+// 0x8800 addressing reads the entry as signed, relative to tile 0x100 (0x9000)
+inline u16 PPU::get_bg_tile_index(u8 map_entry) const { return lcdc.tiles_select_method == 1 ? map_entry : 0x100 + (i8)map_entry; }
 
-  u8 index = bus->vram->data()[address];
-  u8 matching_attr_byte;
-  if (bus->mode == SYSTEM_MODE::CGB) {
-    matching_attr_byte = bus->vram_banks[1].data()[address];
+inline u16 PPU::get_tile_bg_map_address_base() const { return lcdc.bg_tile_map_select == 1 ? 0x9C00 : 0x9800; }
+inline u16 PPU::get_tile_window_map_address_base() const { return lcdc.window_tile_map_select == 1 ? 0x9C00 : 0x9800; }
 
-    bus->vram = &bus->vram_banks[bus->vbk];
+void PPU::set_output(u16* pixels, size_t stride) {
+  assert(pixels == nullptr || stride >= SCREEN_WIDTH);
 
-    tile.cgb_attr_data.value = matching_attr_byte;
-    bus->vram                = &bus->vram_banks[tile.cgb_attr_data.bank];
+  // never hand back memory with lines left as they were, whatever that was
+  if (output != nullptr) {
+    for (u8 y = 0; y < SCREEN_HEIGHT; y++) {
+      if (!output_drawn[y]) std::fill_n(output + y * output_stride, SCREEN_WIDTH, WHITE);
+    }
   }
 
-  if (lcdc.tiles_select_method == 1 || sprite) {
-    for (u8 row = 0; row < 8; row++) {
-      u8 low_byte  = bus->vram->data()[((0x8000 + (row * 2) + (index * 16)) - VRAM_ADDRESS_OFFSET)];
-      u8 high_byte = bus->vram->data()[(((0x8000 + (row * 2) + (index * 16)) - VRAM_ADDRESS_OFFSET) + 1)];
+  output        = pixels;
+  output_stride = pixels != nullptr ? stride : SCREEN_WIDTH;
+  output_drawn.reset();
+}
 
-      auto pixel_array = decode_pixel_row(high_byte, low_byte);
+void PPU::render_scanline() {
+  tiles.sync(*bus);
 
-      for (u8 pixel_index = 0; pixel_index < 8; pixel_index++) {
-        tile.pixel_data[row][pixel_index] = pixel_array[pixel_index];
-      }
-    }
-    if (bus->mode == SYSTEM_MODE::CGB) {
-      bus->vram = &bus->vram_banks[bus->vbk];
-    }
-    return tile;
-  }
-  if (lcdc.tiles_select_method == 0) {
-    for (u8 row = 0; row < 8; row++) {
-      u16 address  = (0x9000 + (row * 2) + ((i8)index * 16)) - VRAM_ADDRESS_OFFSET;
-      u8 low_byte  = bus->vram->at(address);
-      u8 high_byte = bus->vram->at(address + 1);
-
-      const auto& pixel_array = decode_pixel_row(high_byte, low_byte);
+  const u8 ly = bus->io[LY];
+  u16* out    = output_line(ly);
+  output_drawn.set(ly);
 
-      for (int pixel_index = 0; pixel_index < 8; pixel_index++) {
-        tile.pixel_data[row][pixel_index] = pixel_array[pixel_index];
-      }
+  if (bus->mode == SYSTEM_MODE::DMG && !lcdc.bg_and_window_enable_priority) {
+    std::fill_n(out, SCREEN_WIDTH, WHITE);
+    bg_line.fill(0);
+  } else {
+    // the window covers the line from WX - 7 on; with WX < 7 its first columns are cut off
+    const bool window  = window_enabled && lcdc.window_disp_enable && bus->io[WX] < 167;
+    const i16 window_x = window ? bus->io[WX] - 7 : SCREEN_WIDTH;
+    const u8 bg_to     = std::clamp<i16>(window_x, 0, SCREEN_WIDTH);
+
+    render_tile_span(get_tile_bg_map_address_base(), bus->io[SCX], ly + bus->io[SCY], 0, bg_to, out);
+    if (window) {
+      render_tile_span(get_tile_window_map_address_base(), bg_to - window_x, window_current_y, bg_to, SCREEN_WIDTH, out);
     }
   }
 
-  if (bus->mode == SYSTEM_MODE::CGB) {
-    bus->vram = &bus->vram_banks[bus->vbk];
+  if (lcdc.sprite_enable == 1) {
+    render_sprites(out);
   }
-
-  return tile;
 }
 
-inline Tile PPU::get_tile_sprite_data(u16 index, bool sprite, u8 bank) const {
-  Tile tile;
+void PPU::render_tile_span(u16 map_base, u8 map_x, u8 map_y, u8 from, u8 to, u16* out) {
+  const u16 map_row = map_base - VRAM_ADDRESS_OFFSET + (map_y / 8) * 32;
 
-  assert(bank < 2);
+  u8 x = from;
+  while (x < to) {
+    const u16 address = map_row + map_x / 8;
 
-  if (lcdc.tiles_select_method == 1 || sprite) {
+    Attribute_Data attributes;
     if (bus->mode == SYSTEM_MODE::CGB) {
-      bus->vram = &bus->vram_banks[bank];
+      attributes.value = bus->vram_banks[1][address];
     }
 
-    for (u8 row = 0; row < 8; row++) {
-      u16 addr     = (0x8000 + (row * 2) + (index * 16)) - VRAM_ADDRESS_OFFSET;
-      u8 low_byte  = bus->vram->at(addr);
-      u8 high_byte = bus->vram->at(addr + 1);
+    const Umibozu::TileDecode::Row& row = tiles.row(*bus, attributes.bank, get_bg_tile_index(bus->vram_banks[0][address]), map_y % 8, attributes.x_flip, attributes.y_flip);
+    const Palette& palette              = bus->mode == SYSTEM_MODE::CGB ? CGB_BGP[attributes.color_palette] : DMG_BGP[0];
+
+    // the rest of this tile, or up to `to`; row[7] is the tile's leftmost pixel
+    const u8 fine     = map_x % 8;
+    const u8 count    = std::min(8 - fine, to - x);
+    const u8 priority = attributes.priority ? BG_PRIORITY : 0;
+    for (u8 i = 0; i < count; i++) {
+      const u8 id    = row[7 - fine - i];
+      out[x + i]     = palette[id];
+      bg_line[x + i] = id | priority;
+    }
 
-      auto pixel_array = decode_pixel_row(high_byte, low_byte);
+    x += count;
+    map_x += count;
+  }
+}
 
-      for (u8 pixel_index = 0; pixel_index < 8; pixel_index++) {
-        tile.pixel_data[row][pixel_index] = pixel_array[pixel_index];
-      }
-    }
+void PPU::render_sprites(u16* out) {
+  const u8 height = get_sprite_size();
 
-    if (bus->mode == SYSTEM_MODE::CGB) {
-      bus->vram = &bus->vram_banks[bus->vbk];
-    }
+  // BG colours 1-3 can hide sprites, except in CGB mode with LCDC.0 clear
+  const bool bg_can_win = bus->mode == SYSTEM_MODE::DMG || lcdc.bg_and_window_enable_priority;
 
-    return tile;
-  } else {
-    if (bus->mode == SYSTEM_MODE::CGB) {
-      bus->vram = &bus->vram_banks[bank];
+  // later sprites in the buffer are drawn over earlier ones
+  for (const Sprite& sprite : sprite_buf) {
+    u8 line = bus->io[LY] + 16 - sprite.y_pos;
+    if (sprite.y_flip) {
+      line = height - 1 - line;
     }
 
-    for (u8 row = 0; row < 8; row++) {
-      u16 address  = (0x9000 + (row * 2) + ((i8)index * 16)) - VRAM_ADDRESS_OFFSET;
-      u8 low_byte  = bus->vram->at(address);
-      u8 high_byte = bus->vram->at(address + 1);
+    // 8x16 sprites ignore bit 0 of the tile number: the top tile is even, the bottom odd
+    const u8 tile_no = height == 16 ? ((sprite.tile_no & 0xFE) | (line / 8)) : sprite.tile_no;
+    const u8 bank    = bus->mode == SYSTEM_MODE::CGB ? sprite.bank : 0;
 
-      const auto& pixel_array = decode_pixel_row(high_byte, low_byte);
+    const Umibozu::TileDecode::Row& row = tiles.row(*bus, bank, tile_no, line % 8, sprite.x_flip, false);
+    const Palette palette               = get_palette_by_id(bus->mode == SYSTEM_MODE::CGB ? sprite.cgb_palette : sprite.palette_number);
 
-      for (u8 pixel_index = 0; pixel_index < 8; pixel_index++) {
-        tile.pixel_data[row][pixel_index] = pixel_array[pixel_index];
-      }
-    }
+    const i16 left = sprite.x_pos - 8;
+    for (i16 i = std::max<i16>(0, -left); i < 8 && left + i < SCREEN_WIDTH; i++) {
+      const u8 id = row[7 - i];
+      const u8 bg = bg_line[left + i];
+      if (id == 0) continue;
+      if (bg_can_win && (sprite.obj_to_bg_priority || (bg & BG_PRIORITY)) && (bg & 3) > 0) continue;
 
-    if (bus->mode == SYSTEM_MODE::CGB) {
-      bus->vram = &bus->vram_banks[bus->vbk];
+      out[left + i] = palette[id];
     }
-
-    return tile;
   }
 }
 
-inline u16 PPU::get_tile_bg_map_address_base() const { return lcdc.bg_tile_map_select == 1 ? 0x9C00 : 0x9800; }
-inline u16 PPU::get_tile_window_map_address_base() const { return lcdc.window_tile_map_select == 1 ? 0x9C00 : 0x9800; }
-
 std::string PPU::get_mode_string() const {
   switch (get_mode()) {
     case RENDERING_MODE::HBLANK: {
@@ -326,180 +307,23 @@ inline void PPU::set_ppu_mode(RENDERING_MODE new_mode) {
 
     switch (ppu_mode) {
       case RENDERING_MODE::HBLANK: {
-        u8 y = bus->io[LY] + bus->io[SCY];
-
-        for (u16 scanline_tile_index = 0; scanline_tile_index < 24; scanline_tile_index++) {  // A scanline is 256 pixels long.
-
-          u16 address = (get_tile_bg_map_address_base() + ((y / 8) * 32) + ((x_pos_offset + (bus->io[SCX] / 8)) % 32)) - VRAM_ADDRESS_OFFSET;
-
-          if (window_enabled && lcdc.window_disp_enable && bus->io[WX] < 167 && (x_pos_offset * 8) >= bus->io[WX] - 7) {
-            address = (get_tile_window_map_address_base() + (window_line_count * 32) + (window_x_pos_offset)) - VRAM_ADDRESS_OFFSET;
-            y       = bus->io[LY];
-            window_x_pos_offset++;
-          }
-
-          active_tile = get_tile_data(address);
-
-          if (active_tile.cgb_attr_data.x_flip) {
-            flip(active_tile, FLIP_AXIS::X);
-          }
-          if (active_tile.cgb_attr_data.y_flip) {
-            flip(active_tile, FLIP_AXIS::Y);
-          }
-
-          for (u8 x = 0; x < 8; x++) {
-            u16 color;
-
-            if (bus->mode == SYSTEM_MODE::CGB) {
-              color = CGB_BGP[active_tile.cgb_attr_data.color_palette][active_tile.pixel_data[y % 8][(7 - x)]];
-            } else {
-              color = DMG_BGP[0][active_tile.pixel_data[y % 8][(7 - x)]];
-            }
-
-            u32 line_base = ((bus->io[LY]) * 256);
-
-            i32 line_x;
-
-            if (window_enabled && lcdc.window_disp_enable && (bus->io[WX] < 167) && x + (x_pos_offset * 8) >= bus->io[WX] - 7) {
-              line_x = abs(x + (x_pos_offset * 8));
-            } else {
-              line_x = abs(x + (x_pos_offset * 8) - (bus->io[SCX] & 7));
-            }
-
-            u32 buf_pos = line_base + line_x;
-
-            if (bus->mode == SYSTEM_MODE::DMG && !lcdc.bg_and_window_enable_priority) {
-              // frame.data[buf_pos]     = WHITE;
-              frame.color_id[buf_pos] = 0;
-              db.write(buf_pos, WHITE);
-              continue;
-            }
-
-            // frame.data[buf_pos]     = color;
-
-            // TODO: holds color_id, not mapped to bgr color
-            // used to determine priority
-            frame.color_id[buf_pos] = active_tile.pixel_data[y % 8][7 - x];
-            frame.bg_prio[buf_pos]  = active_tile.cgb_attr_data.priority;
-            db.write(buf_pos, color);
-          }
-
-          x_pos_offset++;
-        }
-
-        if (lcdc.sprite_enable == 1) {
-          for (const Sprite& sprite : sprite_buf) {
-            Palette palette;
-            Tile top_tile;
-            Tile lower_tile;
-
-            if (get_sprite_size() == 16) {
-              top_tile   = get_tile_sprite_data((sprite.tile_no & 0xFE), true, sprite.bank);
-              lower_tile = get_tile_sprite_data((sprite.tile_no | 0x01), true, sprite.bank);
-            } else {
-              top_tile = get_tile_sprite_data(sprite.tile_no, true, sprite.bank);
-            }
-
-            if (bus->mode == SYSTEM_MODE::CGB) {
-              palette = get_palette_by_id(sprite.cgb_palette);
-            } else {
-              palette = get_palette_by_id(sprite.palette_number);
-            }
-
-            if (sprite.x_flip == 1) {
-              flip(top_tile, FLIP_AXIS::X);
-              flip(lower_tile, FLIP_AXIS::X);
-            }
-
-            if (sprite.y_flip == 1) {
-              if (get_sprite_size() == 16) {
-                std::swap(top_tile, lower_tile);
-              } else {
-                flip(top_tile, FLIP_AXIS::Y);
-              }
-            }
-
-            u16 current_y = (bus->io[LY] - sprite.y_pos) + 16;
-
-            for (u8 x = 0; x < 8; x++) {
-              i16 current_x = sprite.x_pos - x - 1;
-              if (current_x < 0) {
-                continue;
-              }
-
-              u32 buf_pos = (current_x) + ((bus->io[LY]) * 256);
-
-              if (bus->mode == SYSTEM_MODE::CGB) {
-                // https://gbdev.io/pandocs/Tile_Maps.html#bg-to-obj-priority-in-cgb-mode
-                if (lcdc.bg_and_window_enable_priority && (sprite.obj_to_bg_priority || frame.bg_prio[buf_pos]) && frame.color_id[buf_pos] > 0) {
-                  continue;
-                }
-
-                if (get_sprite_size() == 16) {
-                  if (current_y < 8) {
-                    if (top_tile.pixel_data[current_y % 8][x] == 0) continue;
-
-                    db.write(buf_pos, palette[top_tile.pixel_data[current_y % 8][x]]);
-                  } else {
-                    if (lower_tile.pixel_data[current_y % 8][x] == 0) continue;
-
-                    db.write(buf_pos, palette[lower_tile.pixel_data[current_y % 8][x]]);
-                  }
-                } else {
-                  if (top_tile.pixel_data[current_y % 8][x] == 0) continue;
-
-                  db.write(buf_pos, palette[top_tile.pixel_data[current_y % 8][x]]);
-                }
-
-              } else {
-                if (sprite.obj_to_bg_priority) {  // BG w/ index of 1 - 3 gets drawn over the OBJ
-
-                  if (get_sprite_size() == 16) {
-                    if (current_y < 8) {
-                      if (frame.color_id[buf_pos] > 0) continue;
-
-                      db.write(buf_pos, palette[top_tile.pixel_data[current_y % 8][x]]);
-                    } else {
-                      if (frame.color_id[buf_pos] > 0) continue;
-
-                      db.write(buf_pos, palette[lower_tile.pixel_data[current_y % 8][x]]);
-                    }
-                  } else {
-                    if (frame.color_id[buf_pos] > 0) continue;
-
-                    db.write(buf_pos, palette[top_tile.pixel_data[current_y % 8][x]]);
-                  }
-
-                } else {
-                  if (get_sprite_size() == 16) {
-                    if (current_y < 8) {
-                      if (top_tile.pixel_data[current_y % 8][x] == 0) continue;
-
-                      db.write(buf_pos, palette[top_tile.pixel_data[current_y % 8][x]]);
-                    } else {
-                      if (lower_tile.pixel_data[current_y % 8][x] == 0) continue;
-
-                      db.write(buf_pos, palette[lower_tile.pixel_data[current_y % 8][x]]);
-                    }
-                  } else {
-                    if (top_tile.pixel_data[current_y % 8][x] == 0) continue;
-
-                    db.write(buf_pos, palette[top_tile.pixel_data[current_y % 8][x]]);
-                  }
-                }
-              }
-            }
-          }
-        }
+        render_scanline();
+        bus->hdma_hblank();
         break;
       }
 
       case RENDERING_MODE::VBLANK: {
         bus->request_interrupt(INTERRUPT_TYPE::VBLANK);
-        db.swap_buffers();
-        frame.bg_prio.fill(false);
-        frame.color_id.fill(0);
+        if (output == nullptr) db.swap_buffers();
         frame_queued = true;
+        frames++;
+
+#ifdef UMIBOZU_TELEMETRY
+        if (bus->telemetry.enabled) bus->telemetry.end_frame();
+#endif
+
+        if (bus->cheats != nullptr) bus->cheats->apply_ram(*bus);
+        if (bus->saver != nullptr) bus->saver->poll(*bus);
 
         // check how long frame took, sleep thread remaining time to sync emu thread to 60FPS
         // stopwatch.end();
@@ -524,54 +348,3 @@ inline Palette PPU::get_palette_by_id(u8 index) {
     return DMG_OBP[index];
   }
 }
-
-inline void PPU::process_hdma_chunk() {
-  if (bus->mode == SYSTEM_MODE::CGB && (bus->io[HDMA5] & 0x80) == 0 && !bus->cpu_is_halted && !hdma_executed_on_scanline) {
-    assert(bus->io[LY] <= 143);
-
-    u16 src = ((bus->io[HDMA1] << 8) + bus->io[HDMA2]) & 0xfff0;
-    u16 dst = ((bus->io[HDMA3] << 8) + bus->io[HDMA4]) & 0x1ff0;
-
-    for (size_t index = 0; index < 0x10; index++) {
-      u16 src_address = (src + index);
-      u8 src_data     = mapper->read8(src_address);
-
-      u16 vram_address = ((dst + index));
-
-      if (vram_address > 0x1FFF) {
-        bus->io[HDMA5] |= 0x80;
-        fmt::println("[PPU] overflow");
-        assert(-1 && "overflow");
-      }
-
-      fmt::println(
-          "[HDMA] addr: {:#16x} data: {:#04x} -> VRAM ADDRESS: "
-          "{:#16x} ",
-          src_address, src_data, 0x8000 + vram_address);
-
-      bus->vram->at(vram_address) = src_data;
-    }
-
-    src += 0x10;
-    dst += 0x10;
-
-    bus->io[HDMA1] = (src >> 8);
-    bus->io[HDMA2] = (src & 0xFF);
-    bus->io[HDMA3] = (dst >> 8);
-    bus->io[HDMA4] = (dst & 0xFF);
-
-    if ((bus->io[HDMA5] & 0x7f) == 0) {
-      // we're done
-      fmt::println("[PPU] TRANSFER FINISH");
-      bus->io[HDMA5] = 0xFF;
-    } else {
-      u8 remaining_blocks = bus->io[HDMA5] & 0x7f;
-      remaining_blocks--;
-
-      bus->io[HDMA5] = remaining_blocks;
-      fmt::println("remaining blocks: {}", remaining_blocks);
-    }
-    hdma_executed_on_scanline = true;
-    // fmt::println("B");
-  }
-}
\ No newline at end of file
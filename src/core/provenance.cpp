@@ -0,0 +1,48 @@
+#include "core/provenance.hpp"
+
+#include <algorithm>
+
+void WriteProvenance::enable(SHADOW_REGION region, bool on) {
+  if (on) {
+    enabled_mask |= 1 << (u8)region;
+  } else {
+    shadows[(size_t)region] = {};
+    enabled_mask &= ~(1 << (u8)region);
+  }
+}
+
+void WriteProvenance::record(SHADOW_REGION region, size_t offset, const WriteRecord& write) {
+  Shadow& shadow = shadows[(size_t)region];
+
+  if (offset >= shadow.next.size()) {
+    const size_t size = (offset | 0x1FFF) + 1;
+    shadow.records.resize(size);
+    shadow.next.resize(size, 0);
+    shadow.count.resize(size, 0);
+  }
+
+  u8& next  = shadow.next[offset];
+  u8& count = shadow.count[offset];
+
+  shadow.records[offset][next] = write;
+  next                         = (next + 1) % DEPTH;
+  count                        = std::min<u8>(count + 1, DEPTH);
+}
+
+std::vector<WriteRecord> WriteProvenance::history(SHADOW_REGION region, size_t offset) const {
+  const Shadow& shadow = shadows[(size_t)region];
+  if (offset >= shadow.next.size()) return {};
+
+  std::vector<WriteRecord> out;
+  for (size_t i = 1; i <= shadow.count[offset]; i++) {
+    out.push_back(shadow.records[offset][(shadow.next[offset] + DEPTH - i) % DEPTH]);
+  }
+  return out;
+}
+
+void WriteProvenance::clear() {
+  for (Shadow& shadow : shadows) {
+    std::fill(shadow.next.begin(), shadow.next.end(), 0);
+    std::fill(shadow.count.begin(), shadow.count.end(), 0);
+  }
+}
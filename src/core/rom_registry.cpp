@@ -0,0 +1,103 @@
+#include "core/rom_registry.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace Umibozu;
+
+RomRegistry& RomRegistry::instance() {
+  static RomRegistry registry;
+  return registry;
+}
+
+u64 RomRegistry::hash(std::span<const u8> bytes) {
+  // 64-bit multiply / rotate over 8-byte words -- only used to find candidates,
+  // a hit is confirmed by comparing the bytes
+  constexpr u64 K1 = 0x9E3779B97F4A7C15;
+  constexpr u64 K2 = 0xC2B2AE3D27D4EB4F;
+
+  u64 h    = K1 ^ bytes.size();
+  size_t i = 0;
+  for (; i + 8 <= bytes.size(); i += 8) {
+    u64 word;
+    std::memcpy(&word, bytes.data() + i, 8);
+    h = std::rotl(h ^ (word * K2), 31) * K1;
+  }
+  for (; i < bytes.size(); i++) {
+    h = std::rotl(h ^ (bytes[i] * K2), 31) * K1;
+  }
+
+  return h ^ (h >> 32);
+}
+
+u64 RomRegistry::key(std::span<const u8> bytes) {
+  // the header holds the title and both checksums, so different ROMs rarely share
+  // a key -- and hashing it costs the same for any image size
+  const u64 header = hash(bytes.first(std::min(bytes.size(), HEADER_BYTES)));
+  return header ^ (static_cast<u64>(bytes.size()) << 40);
+}
+
+void RomRegistry::purge() {
+  std::erase_if(images, [](const auto& entry) { return entry.second.expired(); });
+}
+
+std::shared_ptr<const MappedFile> RomRegistry::find(u64 key, std::span<const u8> bytes) {
+  auto [first, last] = images.equal_range(key);
+
+  for (auto it = first; it != last;) {
+    std::shared_ptr<const MappedFile> image = it->second.lock();
+    if (image == nullptr) {
+      it = images.erase(it);
+      continue;
+    }
+
+    std::span<const u8> candidate = image->bytes();
+    if (candidate.size() == bytes.size() && (candidate.data() == bytes.data() || std::equal(candidate.begin(), candidate.end(), bytes.begin()))) {
+      return image;
+    }
+    ++it;
+  }
+
+  return nullptr;
+}
+
+std::shared_ptr<const MappedFile> RomRegistry::intern(std::shared_ptr<const MappedFile> image) {
+  const u64 slot = key(image->bytes());
+  std::lock_guard lock(mutex);
+
+  if (std::shared_ptr<const MappedFile> existing = find(slot, image->bytes())) return existing;
+
+  purge();
+  images.emplace(slot, image);
+  return image;
+}
+
+std::shared_ptr<const MappedFile> RomRegistry::intern(std::span<const u8> bytes) {
+  const u64 slot = key(bytes);
+  std::lock_guard lock(mutex);
+
+  if (std::shared_ptr<const MappedFile> existing = find(slot, bytes)) return existing;
+
+  auto image = std::make_shared<const MappedFile>(std::vector<u8>(bytes.begin(), bytes.end()));
+  purge();
+  images.emplace(slot, image);
+  return image;
+}
+
+RomRegistry::Stats RomRegistry::stats() {
+  std::lock_guard lock(mutex);
+  Stats stats;
+
+  purge();
+  for (const auto& [slot, entry] : images) {
+    const std::shared_ptr<const MappedFile> image = entry.lock();
+    if (image == nullptr) continue;
+
+    stats.images++;
+    stats.bytes += image->bytes().size();
+    stats.references += image.use_count() - 1;  // minus the one just taken
+  }
+
+  return stats;
+}
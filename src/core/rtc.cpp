@@ -0,0 +1,175 @@
+#include "rtc.hpp"
+
+#include <chrono>
+
+void RTC_INSTANCE::write(RTC_REGISTER r, u8 v) {
+  switch (r) {
+    case RTC_REGISTER::RTC_SECOND_TIME: {
+      second_time = v & 0b00111111;
+      break;
+    }
+    case RTC_REGISTER::RTC_MINUTE_TIME: {
+      minute_time = v & 0b00111111;
+      break;
+    }
+    case RTC_REGISTER::RTC_HOUR_TIME: {
+      hour_time = v & 0b00011111;
+      break;
+    }
+    case RTC_REGISTER::RTC_DAY_LOW: {
+      day &= 0b1111111100000000;
+      day |= v;
+      break;
+    }
+    case RTC_REGISTER::RTC_DAY_HIGH: {
+      day &= 0b0000000011111111;
+      day |= (v & 0b11000001) << 8;
+      break;
+    }
+  }
+}
+
+u8 RTC_INSTANCE::read(RTC_REGISTER r) const {
+  switch (r) {
+    case RTC_REGISTER::RTC_SECOND_TIME: return second_time;
+    case RTC_REGISTER::RTC_MINUTE_TIME: return minute_time;
+    case RTC_REGISTER::RTC_HOUR_TIME: return hour_time;
+    case RTC_REGISTER::RTC_DAY_LOW: return day & 0xFF;
+    case RTC_REGISTER::RTC_DAY_HIGH: return day >> 8;
+  }
+  return 0xFF;
+}
+
+void RTC_INSTANCE::tick() {
+  second_time = (second_time + 1) & 0b00111111;
+  if (second_time != 60) return;
+  second_time = 0;
+
+  minute_time = (minute_time + 1) & 0b00111111;
+  if (minute_time != 60) return;
+  minute_time = 0;
+
+  hour_time = (hour_time + 1) & 0b00011111;
+  if (hour_time != 24) return;
+  hour_time = 0;
+
+  if ((day & 0x1FF) == 0x1FF) {
+    day &= ~0x1FF;
+    day |= (1 << 15);
+  } else {
+    day += 1;
+  }
+}
+
+void RTC_INSTANCE::advance(u64 seconds) {
+  // out-of-range fields take at most a few hours of single ticks to wrap back into range
+  while (seconds > 0 && (second_time >= 60 || minute_time >= 60 || hour_time >= 24)) {
+    tick();
+    seconds--;
+  }
+  if (seconds == 0) return;
+
+  u64 total   = second_time + 60 * (minute_time + 60 * (hour_time + 24 * (u64)(day & 0x1FF))) + seconds;
+  second_time = total % 60;
+  total /= 60;
+  minute_time = total % 60;
+  total /= 60;
+  hour_time = total % 24;
+  total /= 24;
+
+  // the carry sticks until the game clears it
+  if (total > 0x1FF) day |= (1 << 15);
+  day = (day & 0xC000) | (total & 0x1FF);
+}
+
+void RealTimeClock::catch_up(u64 now) {
+  const u64 elapsed = now > base ? now - base : 0;
+  base              = now;
+  if (actual.halted()) return;
+
+  subsecond += elapsed;
+  if (subsecond >= TICKS_PER_SECOND) {
+    actual.advance(subsecond / TICKS_PER_SECOND);
+    subsecond %= TICKS_PER_SECOND;
+  }
+}
+
+void RealTimeClock::latch(u64 now) {
+  catch_up(now);
+  latched = actual;
+}
+
+void RealTimeClock::write(RTC_REGISTER r, u8 value, u64 now) {
+  catch_up(now);
+
+  // writing the seconds restarts the second in progress
+  if (r == RTC_REGISTER::RTC_SECOND_TIME) subsecond = 0;
+
+  // the latched copy follows, so a written value reads back without a latch in between
+  actual.write(r, value);
+  latched.write(r, value);
+}
+
+const RTC_INSTANCE& RealTimeClock::current(u64 now) {
+  catch_up(now);
+  return actual;
+}
+
+namespace {
+  void put_registers(std::span<u8> out, const RTC_INSTANCE& rtc) {
+    const u32 values[5] = {rtc.second_time, rtc.minute_time, rtc.hour_time, (u32)(rtc.day & 0xFF), (u32)(rtc.day >> 8)};
+    for (int i = 0; i < 5; i++) {
+      for (int b = 0; b < 4; b++) {
+        out[i * 4 + b] = values[i] >> (b * 8);
+      }
+    }
+  }
+
+  u64 get_le(std::span<const u8> in, size_t at, int width) {
+    u64 value = 0;
+    for (int b = width - 1; b >= 0; b--) {
+      value = (value << 8) | in[at + b];
+    }
+    return value;
+  }
+
+  RTC_INSTANCE get_registers(std::span<const u8> in) {
+    RTC_INSTANCE rtc;
+    rtc.write(RTC_REGISTER::RTC_SECOND_TIME, get_le(in, 0, 4));
+    rtc.write(RTC_REGISTER::RTC_MINUTE_TIME, get_le(in, 4, 4));
+    rtc.write(RTC_REGISTER::RTC_HOUR_TIME, get_le(in, 8, 4));
+    rtc.write(RTC_REGISTER::RTC_DAY_LOW, get_le(in, 12, 4));
+    rtc.write(RTC_REGISTER::RTC_DAY_HIGH, get_le(in, 16, 4));
+    return rtc;
+  }
+}  // namespace
+
+void RealTimeClock::save(std::span<u8> footer, u64 now, i64 unix_time) {
+  if (footer.size() < FOOTER_SIZE) return;
+  catch_up(now);
+
+  put_registers(footer.subspan(0, 20), actual);
+  put_registers(footer.subspan(20, 20), latched);
+  for (int b = 0; b < 8; b++) {
+    footer[40 + b] = (u64)unix_time >> (b * 8);
+  }
+}
+
+void RealTimeClock::load(std::span<const u8> footer, u64 now, std::optional<i64> unix_time) {
+  *this = {};
+  base  = now;
+  if (footer.size() < FOOTER_SIZE) return;
+
+  // 44-byte footers carry a 32-bit timestamp; the bytes after it read as zero
+  const i64 saved_at = get_le(footer, 40, 8);
+  if (saved_at == 0) return;
+
+  actual  = get_registers(footer.subspan(0, 20));
+  latched = get_registers(footer.subspan(20, 20));
+
+  if (unix_time.has_value() && *unix_time > saved_at && !actual.halted()) {
+    actual.advance(*unix_time - saved_at);
+  }
+}
+
+i64 RealTimeClock::unix_now() { return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count(); }
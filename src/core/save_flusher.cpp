@@ -0,0 +1,140 @@
+#include "core/save_flusher.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "bus.hpp"
+#include "io.hpp"
+#include "log.hpp"
+#include "mappers.hpp"
+
+SaveFlusher::~SaveFlusher() { stop(); }
+
+void SaveFlusher::start(Bus& bus, std::string save_path) {
+  stop();
+
+  path      = std::move(save_path);
+  image     = std::vector<u8>(bus.cart->save_image.begin(), bus.cart->save_image.end());
+  since     = bus.dirty_checkpoint();
+  last_poll = std::chrono::steady_clock::now();
+  pending.clear();
+  submitted    = 0;
+  completed    = 0;
+  stopping     = false;
+  write_failed = false;
+  retry        = false;
+
+  writer = std::thread([this] { write_loop(); });
+}
+
+void SaveFlusher::stop() {
+  if (!writer.joinable()) return;
+
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+    retry    = write_failed;  // a failed batch gets one more go before the writer exits
+  }
+  wake.notify_one();
+  writer.join();
+}
+
+void SaveFlusher::poll(Bus& bus) {
+  const auto now = std::chrono::steady_clock::now();
+  if (!writer.joinable() || now - last_poll < interval) return;
+
+  // the writer only holds the lock to take a batch -- never wait for it here
+  std::unique_lock lock(mutex, std::try_to_lock);
+  if (!lock.owns_lock()) return;
+
+  last_poll = now;
+  if (snapshot(bus, false)) wake.notify_one();
+}
+
+void SaveFlusher::flush(Bus& bus) {
+  if (!writer.joinable()) return;
+
+  std::unique_lock lock(mutex);
+  if (snapshot(bus, true)) wake.notify_one();
+
+  // also waits out a batch poll() handed over that is still being written
+  written.wait(lock, [&] { return completed >= submitted; });
+
+  // the last write failed, so the file is behind even with nothing new: write the whole image once more
+  if (write_failed) {
+    retry = true;
+    submitted++;
+    wake.notify_one();
+    written.wait(lock, [&] { return completed >= submitted; });
+  }
+}
+
+bool SaveFlusher::snapshot(Bus& bus, bool with_clock) {
+  const std::vector<u32> pages = bus.dirty.changed_since(DIRTY_REGION::EXT_RAM, since);
+  const std::span<u8> footer   = bus.cart->rtc_footer;
+  if (pages.empty() && (!with_clock || footer.empty())) return false;
+
+  since = bus.dirty_checkpoint();
+
+  // pages already waiting are overwritten rather than queued twice
+  auto queue = [&](size_t offset, std::span<const u8> bytes) {
+    auto queued = std::find_if(pending.begin(), pending.end(), [&](const Page& p) { return p.offset == offset; });
+    Page& entry = queued != pending.end() ? *queued : pending.emplace_back(Page{(u32)offset, {}});
+    std::memcpy(entry.bytes.data(), bytes.data(), std::min<size_t>(0x100, bytes.size()));
+  };
+
+  const std::span<u8> ram = bus.cart->ext_ram;
+  for (u32 page : pages) {
+    const size_t offset = page * 0x100;
+    if (offset >= ram.size()) break;
+    queue(offset, ram.subspan(offset, std::min<size_t>(0x100, ram.size() - offset)));
+  }
+
+  // the RTC footer goes out with every batch, stamped with the current time
+  if (!footer.empty()) {
+    bus.mapper->get()->rtc.save(footer, bus.timer->clock, RealTimeClock::unix_now());
+    queue(ram.size(), footer);
+  }
+
+  submitted++;
+  return true;
+}
+
+void SaveFlusher::write_loop() {
+  std::vector<Page> batch;
+
+  while (true) {
+    u64 target;
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [&] { return !pending.empty() || retry || stopping; });
+      if (pending.empty() && !retry) break;
+
+      batch.swap(pending);
+      target = submitted;
+      retry  = false;
+    }
+
+    for (const Page& page : batch) {
+      std::memcpy(image.data() + page.offset, page.bytes.data(), std::min<size_t>(0x100, image.size() - page.offset));
+    }
+
+    // the image holds every batch so far, so any later write -- a new batch, or the
+    // full rewrite flush() and stop() force while this is set -- catches the file up
+    const bool ok = Umibozu::write_file_atomic(path, image);
+    if (ok) {
+      files_written.fetch_add(1, std::memory_order_relaxed);
+      pages_written.fetch_add(batch.size(), std::memory_order_relaxed);
+    } else {
+      LOG_ERROR(GB, "could not write {} -- retrying with the next batch or at exit", path);
+    }
+    batch.clear();
+
+    {
+      std::lock_guard lock(mutex);
+      completed    = target;
+      write_failed = !ok;
+    }
+    written.notify_all();
+  }
+}
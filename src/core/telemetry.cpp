@@ -0,0 +1,98 @@
+#include "core/telemetry.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#include "log.hpp"
+
+namespace {
+  bool write_text(const std::string& path, const std::string& text) {
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file.good()) {
+      LOG_ERROR(BUS, "telemetry: could not open {}", path);
+      return false;
+    }
+
+    file << text;
+    return file.good();
+  }
+
+  void append_array(std::string& out, const char* name, const auto& values) {
+    fmt::format_to(std::back_inserter(out), "\"{}\": [", name);
+    for (size_t i = 0; i < values.size(); i++) {
+      fmt::format_to(std::back_inserter(out), "{}{}", i == 0 ? "" : ",", values[i]);
+    }
+    out += "]";
+  }
+
+  void append_counters(std::string& out, const char* name, const MemoryTelemetry::Counters& counters) {
+    fmt::format_to(std::back_inserter(out), "  \"{}\": {{\n    ", name);
+    append_array(out, "reads", counters.reads);
+    out += ",\n    ";
+    append_array(out, "writes", counters.writes);
+    out += ",\n    ";
+    append_array(out, "fetches", counters.fetches);
+    out += ",\n    ";
+    append_array(out, "register_writes", counters.register_writes);
+    out += ",\n    ";
+    append_array(out, "bank_switches", counters.bank_switches);
+    out += "\n  }";
+  }
+}  // namespace
+
+MemoryTelemetry::Counters& MemoryTelemetry::Counters::operator+=(const Counters& other) {
+  for (size_t page = 0; page < PAGES; page++) {
+    reads[page] += other.reads[page];
+    writes[page] += other.writes[page];
+    fetches[page] += other.fetches[page];
+  }
+  for (size_t reg = 0; reg < MBC_REGISTERS; reg++) {
+    register_writes[reg] += other.register_writes[reg];
+    bank_switches[reg] += other.bank_switches[reg];
+  }
+  return *this;
+}
+
+void MemoryTelemetry::end_frame() {
+  total += frame;
+  last_frame = frame;
+  frame      = {};
+  frames++;
+}
+
+void MemoryTelemetry::reset() {
+  frame      = {};
+  last_frame = {};
+  total      = {};
+  frames     = 0;
+}
+
+std::string MemoryTelemetry::to_csv() const {
+  std::string out = "kind,address,reads,writes,fetches,bank_switches,frame_reads,frame_writes,frame_fetches,frame_bank_switches\n";
+  auto it         = std::back_inserter(out);
+
+  for (size_t page = 0; page < PAGES; page++) {
+    fmt::format_to(it, "page,{:#06x},{},{},{},0,{},{},{},0\n", page << 8, total.reads[page], total.writes[page], total.fetches[page], last_frame.reads[page],
+                   last_frame.writes[page], last_frame.fetches[page]);
+  }
+  for (size_t reg = 0; reg < MBC_REGISTERS; reg++) {
+    fmt::format_to(it, "mbc_register,{:#06x},0,{},0,{},0,{},0,{}\n", reg << 13, total.register_writes[reg], total.bank_switches[reg], last_frame.register_writes[reg],
+                   last_frame.bank_switches[reg]);
+  }
+
+  return out;
+}
+
+std::string MemoryTelemetry::to_json() const {
+  std::string out = fmt::format("{{\n  \"frames\": {},\n", frames);
+  append_counters(out, "total", total);
+  out += ",\n";
+  append_counters(out, "last_frame", last_frame);
+  out += "\n}\n";
+  return out;
+}
+
+bool MemoryTelemetry::write_csv(const std::string& path) const { return write_text(path, to_csv()); }
+
+bool MemoryTelemetry::write_json(const std::string& path) const { return write_text(path, to_json()); }
@@ -0,0 +1,33 @@
+#include "tile_cache.hpp"
+
+#include <algorithm>
+
+#include "bus.hpp"
+
+void Umibozu::TileCache::decode(const Bus& bus, u16 slot) {
+  const u8 bank  = slot / TILES_PER_BANK;
+  const u16 tile = slot % TILES_PER_BANK;
+  Rows& plain    = rows[slot][0];
+  Rows& mirrored = rows[slot][1];
+
+  TileDecode::tile(bus.vram_banks[bank].data() + tile * 16, plain.data());
+  for (u8 y = 0; y < 8; y++) {
+    std::reverse_copy(plain[y].begin(), plain[y].end(), mirrored[y].begin());
+  }
+  valid[slot] = true;
+}
+
+void Umibozu::TileCache::sync(Bus& bus) {
+  if (bus.dirty.last_written(DIRTY_REGION::VRAM) <= since) return;
+
+  for (const u32 page : bus.dirty.changed_since(DIRTY_REGION::VRAM, since)) {
+    const u32 offset = (page % 0x20) << 8;  // into its bank
+    if (offset >= TILES_PER_BANK * 16) continue;  // tile maps, not tiles
+
+    const u16 first = (page / 0x20) * TILES_PER_BANK + offset / 16;
+    std::fill_n(valid.begin() + first, 16, false);
+  }
+
+  // re-arms the stamps, so the next VRAM store is seen again
+  since = bus.dirty_checkpoint();
+}
@@ -0,0 +1,59 @@
+#include "tile_decode.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define UMIBOZU_HAS_X86_KERNELS 1
+#define UMIBOZU_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace Umibozu;
+
+namespace {
+#ifdef UMIBOZU_HAS_X86_KERNELS
+  // each 128-bit lane holds two rows: broadcast each row's byte to its 8 pixels, keep
+  // the pixel's bit, and clamp it to 0 / 1
+  UMIBOZU_AVX2 void tile_avx2(const u8* bytes, TileDecode::Row* rows) {
+    const __m256i tile = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+    const __m256i bits = _mm256_set1_epi64x(0x8040201008040201);
+    const __m256i one  = _mm256_set1_epi8(1);
+
+    for (int half = 0; half < 2; half++) {
+      const char r = half * 8;
+      const __m256i low_index =
+          _mm256_setr_epi8(r, r, r, r, r, r, r, r, r + 2, r + 2, r + 2, r + 2, r + 2, r + 2, r + 2, r + 2, r + 4, r + 4, r + 4, r + 4, r + 4, r + 4, r + 4, r + 4,
+                           r + 6, r + 6, r + 6, r + 6, r + 6, r + 6, r + 6, r + 6);
+      const __m256i high_index = _mm256_add_epi8(low_index, one);
+
+      const __m256i low  = _mm256_min_epu8(_mm256_and_si256(_mm256_shuffle_epi8(tile, low_index), bits), one);
+      const __m256i high = _mm256_min_epu8(_mm256_and_si256(_mm256_shuffle_epi8(tile, high_index), bits), one);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows + half * 4), _mm256_or_si256(low, _mm256_add_epi8(high, high)));
+    }
+  }
+
+  bool host_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+  }
+#else
+  bool host_has_avx2() { return false; }
+#endif
+}  // namespace
+
+void TileDecode::tile_portable(const u8* bytes, Row* rows) {
+  for (int row = 0; row < 8; row++) {
+    rows[row] = TileDecode::row(bytes[row * 2 + 1], bytes[row * 2]);
+  }
+}
+
+void TileDecode::tile(const u8* bytes, Row* rows) {
+#ifdef UMIBOZU_HAS_X86_KERNELS
+  if (host_has_avx2()) {
+    tile_avx2(bytes, rows);
+    return;
+  }
+#endif
+  tile_portable(bytes, rows);
+}
+
+bool TileDecode::accelerated() { return host_has_avx2(); }
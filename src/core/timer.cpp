@@ -22,6 +22,7 @@ void Timer::increment_div(const u8 value, bool is_cgb_double_speed) {
 //   }
 
   div = new_div;
+  clock += value;
 }
 
 void Timer::reset_div(bool is_double_speed) {
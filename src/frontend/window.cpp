@@ -15,7 +15,10 @@
 #include "io.hpp"
 #include "io_defs.hpp"
 #include "joypad.hpp"
+#include "log.hpp"
 #include "lib/tinyfiledialogs/tinyfiledialogs.h"
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 
 static MemoryEditor editor_instance;
@@ -98,6 +101,14 @@ void Frontend::handle_events() {
 }
 
 void Frontend::shutdown() {
+  finish_library_scan(true);
+
+  // only locked if lock_frame_texture() succeeded
+  if (gb->ppu.output != nullptr) {
+    gb->ppu.set_output(nullptr, 0);
+    SDL_UnlockTexture(state.ppu_texture);
+  }
+
   ImGui_ImplSDLRenderer3_Shutdown();
   ImGui_ImplSDL3_Shutdown();
   ImGui::DestroyContext();
@@ -186,17 +197,40 @@ void Frontend::show_menubar() {
     ImGui::Separator();
     if (ImGui::BeginMenu("File")) {
       if (ImGui::MenuItem("Load ROM")) {
-        auto path = tinyfd_openFileDialog("Load ROM", "roms/", 2, patterns, "Gameboy ROM", 0);
+        auto path = tinyfd_openFileDialog("Load ROM", "roms/", 4, patterns, "Gameboy ROM", 0);
         if (path != nullptr) {
-          gb->reset();
           this->gb->load_cart(read_file(path));
         }
       }
 
+      if (ImGui::MenuItem("Library")) {
+        this->state.library_open = !this->state.library_open;
+      }
+
+      if (ImGui::MenuItem("Load ROM + Patch")) {
+        auto path = tinyfd_openFileDialog("Load ROM", "roms/", 4, patterns, "Gameboy ROM", 0);
+        if (path != nullptr) {
+          const std::string rom_path = path;
+          auto patch_path            = tinyfd_openFileDialog("Apply Patch", "roms/", 3, patch_patterns, "IPS / BPS / UPS patch", 0);
+          if (patch_path != nullptr) {
+            try {
+              this->gb->load_cart(read_file(rom_path), read_file(patch_path));
+            } catch (const std::exception& e) {
+              LOG_ERROR(FRONTEND, "{}", e.what());
+            }
+          }
+        }
+      }
+
       if (ImGui::MenuItem("Reset")) {
         if (!gb->cart.info.path.empty()) {
-          gb->reset();
-          this->gb->load_cart(read_file(gb->cart.info.path));
+          const std::string rom_path   = gb->cart.info.path;
+          const std::string patch_path = gb->cart.patch_path;
+          if (patch_path.empty()) {
+            this->gb->load_cart(read_file(rom_path));
+          } else {
+            this->gb->load_cart(read_file(rom_path), read_file(patch_path));
+          }
         }
       }
       ImGui::EndMenu();
@@ -205,12 +239,18 @@ void Frontend::show_menubar() {
       if (ImGui::MenuItem("Controls")) {
         this->state.controls_window_open = !this->state.controls_window_open;
       }
+      if (ImGui::MenuItem("Cheats")) {
+        this->state.cheats_window_open = !this->state.cheats_window_open;
+      }
+      ImGui::Checkbox("Map Save Files", &gb->mapped_saves);
+      ImGui::Checkbox("RTC Follows Host Time", &gb->rtc_host_time);
 
       ImGui::EndMenu();
     }
 
     if (ImGui::BeginMenu("Debug Options")) {
       ImGui::Checkbox("Memory Viewer", &state.memory_viewer_open);
+      ImGui::Checkbox("Memory Heatmap", &state.memory_heatmap_open);
       ImGui::Checkbox("CPU Info", &state.cpu_info_open);
       ImGui::Checkbox("PPU Info", &state.ppu_info_open);
       ImGui::Checkbox("IO Info", &state.io_info_open);
@@ -274,7 +314,7 @@ void Frontend::show_ppu_info() {
     ImGui::Text("OPRI = %s", gb->bus.io[OPRI] == 1 ? "DMG-style" : "CGB-style");
   }
   ImGui::Separator();
-  ImGui::Text("x pos offset = %d", gb->ppu.x_pos_offset);
+  ImGui::Text("window line = %d", gb->ppu.window_current_y);
   ImGui::Separator();
   ImGui::Text("SCX = %d", gb->bus.io[SCX]);
   ImGui::Text("SCY = %d", gb->bus.io[SCY]);
@@ -305,7 +345,7 @@ void Frontend::show_ppu_info() {
   ImGui::Text("LCDC.7 (LCD & PPU enable) = %s", gb->ppu.lcdc.lcd_ppu_enable == 1 ? "On" : "Off");
 
   if (ImGui::Button("Trigger VBLANK interrupt")) {
-    fmt::println("VBLANK triggered");
+    LOG_DEBUG(FRONTEND, "VBLANK triggered");
     gb->bus.request_interrupt(INTERRUPT_TYPE::VBLANK);
   }
   if (ImGui::Button("Trigger LCD interrupt")) {
@@ -327,9 +367,9 @@ void Frontend::show_ppu_info() {
 
 void Frontend::show_cpu_info() {
   ImGui::Begin("CPU INFO", &state.cpu_info_open, 0);
-  if (gb->bus.mapper != nullptr) {
-    ImGui::Text("ROM BANK: %d", gb->bus.mapper->rom_bank);
-    ImGui::Text("RAM BANK: %d", gb->bus.mapper->ram_bank);
+  if (const Mapper* mapper = gb->mapper.get()) {
+    ImGui::Text("ROM BANK: %d", mapper->rom_bank);
+    ImGui::Text("RAM BANK: %d", mapper->ram_bank);
   }
   ImGui::Separator();
   ImGui::Text("SPEED: %s", gb->cpu.speed == SPEED::DOUBLE ? "DOUBLE" : "NORMAL");
@@ -403,9 +443,18 @@ void Frontend::render_frame() {
   if (state.memory_viewer_open) {
     show_memory_viewer();
   }
+  if (state.memory_heatmap_open) {
+    show_memory_heatmap();
+  }
   if (state.io_info_open) {
     show_io_info();
   }
+  if (state.cheats_window_open) {
+    show_cheats();
+  }
+  if (state.library_open) {
+    show_library();
+  }
 
   ImGui::Render();
   SDL_SetRenderScale(renderer, state.io->DisplayFramebufferScale.x, state.io->DisplayFramebufferScale.y);
@@ -416,26 +465,33 @@ void Frontend::render_frame() {
   SDL_GetWindowSize(window, &screenWidth, &screenHeight);
 
   dst = {
-      // crops the texture to 160x144 and stretches it to user window size
+      // stretches the 160x144 texture to user window size
       .x = 0,
       .y = (float)ImGui::GetFrameHeight(),
       .w = (float)screenWidth,
       .h = (float)screenHeight,
   };
 
-  SDL_UpdateTexture(state.ppu_texture, nullptr, gb->ppu.db.disp_buf, 256 * 2);
+  if (gb->ppu.output != nullptr) {
+    // the PPU drew this frame straight into the locked texture; detaching blanks lines it skipped
+    gb->ppu.set_output(nullptr, 0);
+    SDL_UnlockTexture(state.ppu_texture);
+  } else {
+    SDL_UpdateTexture(state.ppu_texture, nullptr, gb->ppu.db.disp_buf, SCREEN_WIDTH * 2);
+  }
 
   SDL_RenderTexture(renderer, state.ppu_texture, &src, &dst);
 
   ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), renderer);
   SDL_RenderPresent(renderer);
+  lock_frame_texture();
   end_ticks = SDL_GetTicks();
 
   float frameTime = (end_ticks - start_ticks) / 1000.0f;  // in seconds
 
   if (frameTime > 0) {
     fps = 1.0f / frameTime;
-    printf("FPS: %.2f\n", fps);
+    LOG_DEBUG(FRONTEND, "FPS: {:.2f}", fps);
   }
   start_ticks = SDL_GetTicks();
 }
@@ -445,7 +501,7 @@ void Frontend::show_viewport() {
   ImGui::Text("pointer to gb instance = %p", (void*)&gb);
   ImGui::Text("fps = %f", state.io->Framerate);
 
-  ImGui::Image((void*)state.ppu_texture, ImVec2(256 * 2, 256 * 2));
+  ImGui::Image((void*)state.ppu_texture, ImVec2(SCREEN_WIDTH * 2, SCREEN_HEIGHT * 2));
 
   ImGui::End();
 }
@@ -453,7 +509,7 @@ Frontend::Frontend(GB* gb) : gb(gb) {
   assert(this->gb != nullptr);
 
   if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO)) {
-    fmt::println("ERROR: {}", SDL_GetError());
+    LOG_ERROR(FRONTEND, "{}", SDL_GetError());
     exit(-1);
   }
 
@@ -476,7 +532,8 @@ Frontend::Frontend(GB* gb) : gb(gb) {
 
   ImGui::StyleColorsDark();
 
-  this->state.ppu_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XBGR1555, SDL_TEXTUREACCESS_TARGET, 256, 256);
+  this->state.ppu_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XBGR1555, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+  lock_frame_texture();
 
   this->state.viewport = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XBGR1555, SDL_TEXTUREACCESS_TARGET, 256, 256);
 
@@ -510,6 +567,170 @@ void Frontend::show_memory_viewer() {
   editor_instance.ReadOnly     = true;
 
   editor_instance.DrawContents((void*)memory_partitions[SelectedItem], memory_partition_size[SelectedItem]);
+
+  // write provenance of the clicked byte -- offsets are into the region's backing store
+  const u8 wram_bank                   = gb->bus.svbk == 0 ? 1 : gb->bus.svbk;
+  const SHADOW_REGION shadow_regions[] = {
+      SHADOW_REGION::VRAM, SHADOW_REGION::EXT_RAM, SHADOW_REGION::WRAM, SHADOW_REGION::WRAM, SHADOW_REGION::WRAM, SHADOW_REGION::COUNT, SHADOW_REGION::HRAM,
+  };
+  const size_t shadow_base[] = {
+      gb->bus.vbk * 0x2000u, 0, 0, wram_bank * 0x1000u, 0, 0, 0,
+  };
+
+  static size_t selected_byte = (size_t)-1;
+  if (editor_instance.MouseHovered && ImGui::IsMouseClicked(0)) {
+    selected_byte = editor_instance.MouseHoveredAddr;
+  }
+
+  const SHADOW_REGION shadow = shadow_regions[SelectedItem];
+  if (shadow != SHADOW_REGION::COUNT) {
+    ImGui::Separator();
+
+    bool tracing = gb->bus.provenance.enabled(shadow);
+    if (ImGui::Checkbox("Record writes to this region", &tracing)) {
+      gb->bus.set_provenance(shadow, tracing);
+    }
+
+    if (tracing && selected_byte < memory_partition_size[SelectedItem]) {
+      ImGui::Text("last writes to +0x%04zX:", selected_byte);
+      for (const WriteRecord& write : gb->bus.provenance.history(shadow, shadow_base[SelectedItem] + selected_byte)) {
+        ImGui::Text("  pc %02X:%04X  frame %u  cycle %u", write.bank, write.pc, write.frame, write.cycle);
+      }
+    }
+  }
+
+  ImGui::End();
+}
+
+void Frontend::show_memory_heatmap() {
+  ImGui::Begin("Memory Heatmap", &state.memory_heatmap_open, 0);
+  MemoryTelemetry& telemetry = gb->bus.telemetry;
+
+#ifndef UMIBOZU_TELEMETRY
+  ImGui::TextUnformatted("built without UMIBOZU_TELEMETRY");
+#endif
+  ImGui::Checkbox("Enabled", &telemetry.enabled);
+  ImGui::SameLine();
+  if (ImGui::Button("Reset")) {
+    telemetry.reset();
+  }
+  ImGui::SameLine();
+  ImGui::Text("frames: %llu", (unsigned long long)telemetry.frames);
+
+  static int metric     = 0;
+  static int scope      = 0;
+  const char* metrics[] = {"Reads", "Writes", "Fetches"};
+  const char* scopes[]  = {"Last frame", "Total"};
+  ImGui::Combo("Metric", &metric, metrics, IM_ARRAYSIZE(metrics));
+  ImGui::Combo("Scope", &scope, scopes, IM_ARRAYSIZE(scopes));
+
+  const MemoryTelemetry::Counters& counters             = scope == 0 ? telemetry.last_frame : telemetry.total;
+  const std::array<u64, MemoryTelemetry::PAGES>& pages = metric == 0 ? counters.reads : metric == 1 ? counters.writes : counters.fetches;
+
+  // 16x16 grid, one cell per 256-byte page (row = high nibble), log-scaled against the hottest page
+  const u64 hottest = std::max<u64>(1, *std::max_element(pages.begin(), pages.end()));
+  const float cell  = 18.0f;
+  ImDrawList* draw  = ImGui::GetWindowDrawList();
+  ImVec2 origin     = ImGui::GetCursorScreenPos();
+
+  for (size_t page = 0; page < MemoryTelemetry::PAGES; page++) {
+    ImVec2 min = {origin.x + (page & 0xF) * cell, origin.y + (page >> 4) * cell};
+    ImVec2 max = {min.x + cell - 1, min.y + cell - 1};
+
+    float heat = pages[page] == 0 ? 0.0f : std::log1p((float)pages[page]) / std::log1p((float)hottest);
+    draw->AddRectFilled(min, max, ImGui::ColorConvertFloat4ToU32(ImVec4(heat, 0.2f * heat, 1.0f - heat, pages[page] == 0 ? 0.15f : 1.0f)));
+
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+      ImGui::SetTooltip("%04zX-%04zX\nreads: %llu\nwrites: %llu\nfetches: %llu", page << 8, (page << 8) | 0xFF, (unsigned long long)counters.reads[page],
+                        (unsigned long long)counters.writes[page], (unsigned long long)counters.fetches[page]);
+    }
+  }
+  ImGui::Dummy(ImVec2(cell * 16, cell * 16));
+
+  ImGui::Separator();
+  if (ImGui::BeginTable("mbc_registers", 3, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("MBC register");
+    ImGui::TableSetupColumn("writes");
+    ImGui::TableSetupColumn("bank switches");
+    ImGui::TableHeadersRow();
+
+    for (size_t reg = 0; reg < MemoryTelemetry::MBC_REGISTERS; reg++) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%04zX-%04zX", reg << 13, (reg << 13) | 0x1FFF);
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", (unsigned long long)counters.register_writes[reg]);
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", (unsigned long long)counters.bank_switches[reg]);
+    }
+    ImGui::EndTable();
+  }
+
+  char const* csv_pattern[1]  = {"*.csv"};
+  char const* json_pattern[1] = {"*.json"};
+
+  if (ImGui::Button("Export CSV")) {
+    if (const char* path = tinyfd_saveFileDialog("Export telemetry", "telemetry.csv", 1, csv_pattern, "CSV")) {
+      telemetry.write_csv(path);
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Export JSON")) {
+    if (const char* path = tinyfd_saveFileDialog("Export telemetry", "telemetry.json", 1, json_pattern, "JSON")) {
+      telemetry.write_json(path);
+    }
+  }
+
+  ImGui::End();
+}
+
+void Frontend::show_cheats() {
+  ImGui::Begin("Cheats", &state.cheats_window_open, 0);
+  CheatEngine& cheats = gb->cheats;
+  bool changed        = false;
+
+  ImGui::Text("file: %s", cheats.path.empty() ? "(no cart loaded)" : cheats.path.c_str());
+  ImGui::Separator();
+
+  for (size_t i = 0; i < cheats.cheats.size(); i++) {
+    Cheat& cheat = cheats.cheats[i];
+    ImGui::PushID((int)i);
+
+    changed |= ImGui::Checkbox("##enabled", &cheat.enabled);
+    ImGui::SameLine();
+    ImGui::Text("%-12s %s %s", cheat.code.c_str(), cheat.type == Cheat::TYPE::GAME_GENIE ? "GG" : "GS", cheat.name.c_str());
+    ImGui::SameLine();
+    if (ImGui::SmallButton("remove")) {
+      cheats.remove(i);
+      changed = true;
+      ImGui::PopID();
+      break;
+    }
+
+    ImGui::PopID();
+  }
+
+  ImGui::Separator();
+  static char code[16] = {};
+  static char name[64] = {};
+  ImGui::InputText("code", code, sizeof(code));
+  ImGui::InputText("name", name, sizeof(name));
+  if (ImGui::Button("Add")) {
+    if (cheats.add(code, name)) {
+      code[0] = '\0';
+      name[0] = '\0';
+      changed = true;
+    } else {
+      LOG_WARN(FRONTEND, "invalid cheat code: {}", code);
+    }
+  }
+
+  // toggles take effect right away: ROM windows are re-mapped with the new overlays
+  if (changed) {
+    cheats.apply_rom(gb->bus);
+    cheats.save();
+  }
+
   ImGui::End();
 }
 
@@ -521,13 +742,117 @@ void Frontend::init_audio_device() {
   stream             = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, NULL, NULL);
 
   if (!stream) {
-    fmt::println("Couldn't create audio stream: {}", SDL_GetError());
+    LOG_ERROR(FRONTEND, "Couldn't create audio stream: {}", SDL_GetError());
     exit(-1);
   }
 
   SDL_ResumeAudioStreamDevice(stream);
 }
 
+void Frontend::lock_frame_texture() {
+  void* pixels = nullptr;
+  int pitch    = 0;
+  if (!SDL_LockTexture(state.ppu_texture, nullptr, &pixels, &pitch)) {
+    LOG_WARN(FRONTEND, "could not lock the PPU texture, frames are uploaded instead: {}", SDL_GetError());
+    return;
+  }
+  gb->ppu.set_output(static_cast<u16*>(pixels), pitch / sizeof(u16));
+}
+
 void Frontend::dump_framebuffer() {
   SDL_Log("dumped framebuffer to %s\n", "UNIMPL");
-}
\ No newline at end of file
+}
+
+void Frontend::show_library() {
+  ImGui::Begin("Library", &state.library_open, 0);
+
+  // the saved index is searchable right away; the scan catches it up in the background
+  if (!library_loaded) {
+    library_loaded = true;
+    library.load(settings.library_index);
+    start_library_scan();
+  }
+  finish_library_scan(false);
+
+  ImGui::BeginDisabled(library_scanning);
+  if (ImGui::Button("Rescan")) {
+    start_library_scan();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Add Folder")) {
+    if (const char* folder = tinyfd_selectFolderDialog("Add ROM folder", "roms/")) {
+      settings.library_roots.emplace_back(folder);
+      start_library_scan();
+    }
+  }
+  ImGui::EndDisabled();
+  ImGui::SameLine();
+  if (library_scanning) {
+    ImGui::Text("%zu ROMs, scanning...", library.entries().size());
+  } else {
+    ImGui::Text("%zu ROMs, last scan %.1f ms", library.entries().size(), last_scan.milliseconds);
+  }
+
+  static char text[64] = {};
+  static int system    = 0;
+  ImGui::InputText("search", text, sizeof(text));
+  ImGui::Combo("system", &system, "All\0DMG only\0CGB\0");
+
+  RomLibrary::Filter filter = {.text = text};
+  if (system != 0) filter.cgb = system == 2;
+  const std::vector<const RomLibrary::Entry*> matches = library.search(filter);
+
+  if (ImGui::BeginTable("roms", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
+    ImGui::TableSetupColumn("Title");
+    ImGui::TableSetupColumn("Mapper");
+    ImGui::TableSetupColumn("CRC32");
+    ImGui::TableSetupColumn("File");
+    ImGui::TableHeadersRow();
+
+    // only the rows in view are submitted
+    ImGuiListClipper clipper;
+    clipper.Begin((int)matches.size());
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        const RomLibrary::Entry& entry = *matches[row];
+        ImGui::PushID(row);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        if (ImGui::Selectable(entry.title.empty() ? "(untitled)" : entry.title.c_str(), false, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick) &&
+            ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+          gb->load_cart(read_file(entry.path));
+        }
+        ImGui::TableNextColumn();
+        ImGui::Text("%02X%s", entry.mapper_id, entry.cgb() ? " CGB" : "");
+        ImGui::TableNextColumn();
+        ImGui::Text("%08X", entry.crc32);
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(entry.path.c_str());
+        ImGui::PopID();
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void Frontend::start_library_scan() {
+  if (library_scanning) return;
+  finish_library_scan(false);  // one that ended since the last frame
+
+  scanned_library  = library;
+  library_scanning = true;
+  library_scanner  = std::thread([this, roots = settings.library_roots, index = settings.library_index] {
+    last_scan = scanned_library.scan(roots);
+    scanned_library.save(index);
+    library_scanning = false;
+  });
+}
+
+void Frontend::finish_library_scan(bool wait) {
+  if (!library_scanner.joinable() || (library_scanning && !wait)) return;
+
+  library_scanner.join();
+  library = std::move(scanned_library);
+}
@@ -2,9 +2,10 @@
 #include "frontend/window.hpp"
 #include "gb.hpp"
 #include "io.hpp"
-int handle_args(int& argc, char** argv, std::string& filename) {
+int handle_args(int& argc, char** argv, std::string& filename, std::string& patch) {
   CLI::App app{"", "umibozu"};
   app.add_option("-f,--file", filename, "path to ROM")->required();
+  app.add_option("-p,--patch", patch, "IPS, BPS or UPS patch applied at load");
 
   CLI11_PARSE(app, argc, argv);
   return 0;
@@ -15,14 +16,19 @@ using namespace Umibozu;
 // #pragma GCC diagnostic ignored "-Wunused-parameter"
 int main(int argc, char** argv) {
   std::string filename = {};
-  handle_args(argc, argv, filename);
+  std::string patch    = {};
+  handle_args(argc, argv, filename, patch);
 
   auto f = read_file(filename);
 
   GB gb = {};
   Frontend fe(&gb);
 
-  gb.load_cart(f);
+  if (patch.empty()) {
+    gb.load_cart(f);
+  } else {
+    gb.load_cart(f, read_file(patch));
+  }
   gb.apu.stream = fe.stream;
   // std::thread system = std::thread(&GB::system_loop, &gb);
 
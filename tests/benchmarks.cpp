@@ -0,0 +1,474 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "core/checksum.hpp"
+#include "core/gb.hpp"
+#include "core/library.hpp"
+#include "core/lockstep.hpp"
+#include "core/rom_registry.hpp"
+#include "core/stopwatch.hpp"
+#include "core/tile_decode.hpp"
+#include "test_rom.hpp"
+
+// Benchmarks are hidden from the default run; use `ppu_tests "[benchmark]"`.
+
+// MBC5 image whose banks start with their own number, running a loop that switches
+// ROM and RAM banks and touches both every iteration.
+static File mbc5_bank_switch_rom() {
+  File rom = make_test_rom(
+      {
+          0x3E, 0x0A,        // LD A,0x0A
+          0xEA, 0x00, 0x00,  // LD (0x0000),A   ; enable RAM
+          0x21, 0x00, 0x20,  // LD HL,0x2000
+          // loop: 0x0158
+          0x3C,              // INC A
+          0xE6, 0x07,        // AND 0x07
+          0x77,              // LD (HL),A       ; ROM bank
+          0xFA, 0x00, 0x40,  // LD A,(0x4000)
+          0xEA, 0x00, 0x40,  // LD (0x4000),A   ; RAM bank
+          0xEA, 0x00, 0xA0,  // LD (0xA000),A
+          0x18, 0xF1,        // JR loop
+      },
+      0x1A, 0x02, 0x03);
+
+  for (u32 bank = 1; bank < 8; bank++) {
+    rom.data[bank * 0x4000] = bank;
+  }
+  return rom;
+}
+
+// stand-in for the old abstract Mapper interface
+struct VirtualMapper {
+  virtual ~VirtualMapper()                               = default;
+  virtual u8 read8(const u16 address)                    = 0;
+  virtual void write8(const u16 address, const u8 value) = 0;
+};
+
+template <typename T>
+struct VirtualShim : VirtualMapper {
+  T& mapper;
+  explicit VirtualShim(T& mapper) : mapper(mapper) {}
+  u8 read8(const u16 address) override { return address <= 0x7FFF ? mapper.rom_read(address) : mapper.ram_read(address); }
+  void write8(const u16 address, const u8 value) override {
+    if (address <= 0x7FFF) {
+      mapper.control_write(address, value);
+      mapper.remap();
+    } else {
+      mapper.ram_write(address, value);
+    }
+  }
+};
+
+TEST_CASE("Mapper - MBC5 dispatch", "[.benchmark]") {
+  constexpr u64 FRAMES   = 600;
+  constexpr u64 ACCESSES = 50'000'000;
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(mbc5_bank_switch_rom());
+
+  Stopwatch stopwatch;
+
+  stopwatch.start();
+  u64 frames = 0;
+  while (frames < FRAMES) {
+    gb->cpu.run_instruction();
+    if (gb->ppu.frame_queued) {
+      gb->ppu.frame_queued = false;
+      frames++;
+    }
+  }
+  stopwatch.end();
+  fmt::println("[BENCH] MBC5 bank-switch loop: {:.1f} fps", FRAMES / (stopwatch.duration.count() / 1000.0));
+
+  // per-access cost of the dispatch itself, as used by the bus slow path and HDMA
+  // a second mapper type keeps the virtual call site polymorphic
+  auto rom_only_gb = std::make_unique<GB>();
+  rom_only_gb->load_cart(make_test_rom({}));
+
+  VirtualShim<MBC5> mbc5_shim(std::get<MBC5>(gb->mapper.kind));
+  VirtualShim<ROM_ONLY> rom_only_shim(std::get<ROM_ONLY>(rom_only_gb->mapper.kind));
+  std::array<VirtualMapper*, 2> shims = {&rom_only_shim, &mbc5_shim};
+  volatile size_t selected            = 1;
+  VirtualMapper* virtual_mapper       = shims[selected];
+
+  auto run = [&](auto&& read8, auto&& write8) {
+    u64 sum = 0;
+    stopwatch.start();
+    for (u64 i = 0; i < ACCESSES; i++) {
+      if ((i & 0xFF) == 0) write8(0x2000, (i >> 8) & 0x7);
+      sum += read8(0x4000 + (i & 0x3FFF));
+    }
+    stopwatch.end();
+    return sum;
+  };
+
+  u64 virtual_sum = run([&](u16 address) { return virtual_mapper->read8(address); }, [&](u16 address, u8 value) { virtual_mapper->write8(address, value); });
+  double virtual_ms = stopwatch.duration.count();
+
+  u64 variant_sum = run([&](u16 address) { return gb->mapper.read8(address); }, [&](u16 address, u8 value) { gb->mapper.write8(address, value); });
+  double variant_ms = stopwatch.duration.count();
+
+  REQUIRE(virtual_sum == variant_sum);
+  fmt::println("[BENCH] MBC5 dispatch: virtual {:.2f} ns/access, variant {:.2f} ns/access ({:.2f}x)", virtual_ms * 1e6 / ACCESSES, variant_ms * 1e6 / ACCESSES, virtual_ms / variant_ms);
+}
+
+TEST_CASE("Lockstep - aggregate frames per second", "[.benchmark]") {
+  constexpr u64 FRAMES = 30;
+
+  const File rom = make_test_rom(joypad_alu_loop());
+
+  for (size_t lanes : {32, 128}) {
+    std::vector<std::unique_ptr<GB>> gbs;
+    std::vector<GB*> lane_ptrs;
+
+    for (size_t i = 0; i < lanes; i++) {
+      auto& gb = gbs.emplace_back(std::make_unique<GB>());
+      gb->load_cart(rom);
+      gb->bus.joypad.DOWN = (i % 4 == 0) ? 0 : 1;
+      lane_ptrs.push_back(gb.get());
+    }
+
+    Stopwatch stopwatch;
+
+    // N independent scalar instances, run one after the other
+    stopwatch.start();
+    for (auto& gb : gbs) {
+      u64 frames = 0;
+      while (frames < FRAMES) {
+        gb->cpu.run_instruction();
+        if (gb->ppu.frame_queued) {
+          gb->ppu.frame_queued = false;
+          frames++;
+        }
+      }
+    }
+    stopwatch.end();
+    double scalar_fps = (lanes * FRAMES) / (stopwatch.duration.count() / 1000.0);
+
+    Lockstep engine(lane_ptrs);
+
+    stopwatch.start();
+    engine.run_frames(FRAMES);
+    stopwatch.end();
+    double lockstep_fps = (lanes * FRAMES) / (stopwatch.duration.count() / 1000.0);
+
+    fmt::println("[BENCH] {:4d} lanes: scalar {:10.1f} fps, lockstep {:10.1f} fps ({:.2f}x, {:.1f}% vector)", lanes, scalar_fps, lockstep_fps, lockstep_fps / scalar_fps,
+                 100.0 * engine.vector_steps / (engine.vector_steps + engine.scalar_steps));
+  }
+}
+
+TEST_CASE("IO - 8 MB ROM load", "[.benchmark]") {
+  constexpr int LOADS = 20;
+
+  // largest MBC5 image: 512 banks
+  File rom = make_test_rom({}, 0x19, 0x08);
+  const std::string path = (std::filesystem::temp_directory_path() / "umibozu_bench.gb").string();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(rom.data.data()), rom.data.size());
+  }
+
+  Stopwatch stopwatch;
+  auto gb = std::make_unique<GB>();
+  gb->cart.info.title.clear();
+
+  // what read_file + load_cart used to do: istream_iterator into a vector, then a copy
+  stopwatch.start();
+  u64 checksum = 0;
+  for (int i = 0; i < LOADS; i++) {
+    std::ifstream file(path, std::ios::binary);
+    file.unsetf(std::ios::skipws);
+    std::vector<u8> bytes(std::istream_iterator<u8>(file), {});
+    std::vector<u8> cart_copy = bytes;
+    checksum += cart_copy[0x4000 * 511];
+  }
+  stopwatch.end();
+  const double stream_ms = stopwatch.duration.count();
+
+  stopwatch.start();
+  for (int i = 0; i < LOADS; i++) {
+    gb->load_cart(read_file(path));
+    checksum += gb->cart.memory[0x4000 * 511];
+  }
+  stopwatch.end();
+  const double mapped_ms = stopwatch.duration.count();
+  gb->cart.info.title.clear();
+
+  std::filesystem::remove(path);
+  fmt::println("[BENCH] 8 MB ROM load: stream + copy {:.2f} ms, mmap + load_cart {:.2f} ms ({:.1f}x) [{}]", stream_ms / LOADS, mapped_ms / LOADS, stream_ms / mapped_ms,
+               checksum);
+}
+
+TEST_CASE("ROM registry - per-instance memory", "[.benchmark]") {
+  constexpr size_t INSTANCES = 64;
+
+  File rom = make_test_rom({0x18, 0xFE}, 0x19, 0x08);  // 8 MB
+  std::vector<std::unique_ptr<GB>> gbs;
+  for (size_t i = 0; i < INSTANCES; i++) {
+    gbs.push_back(std::make_unique<GB>());
+    gbs.back()->load_cart(rom);
+  }
+
+  const GB::MemoryReport report  = gbs[0]->memory_report();
+  const RomRegistry::Stats stats = RomRegistry::instance().stats();
+
+  fmt::println("[BENCH] {} instances of an 8 MB title: {} KiB per instance unshared, {} KiB shared ({} image(s), {} KiB of ROM held)", INSTANCES,
+               (report.instance + report.rom) / 1024, report.per_instance() / 1024, stats.images, stats.bytes / 1024);
+}
+
+TEST_CASE("Library - hashing and rescans", "[.benchmark]") {
+  constexpr int ROUNDS = 10;
+  constexpr int ROMS   = 2000;
+
+  File rom = make_test_rom({}, 0x19, 0x08);  // 8 MB
+  for (size_t i = 0; i < rom.data.size(); i++) {
+    rom.data[i] ^= (i * 2654435761u) >> 24;
+  }
+
+  Stopwatch stopwatch;
+  u32 crc = 0;
+  stopwatch.start();
+  for (int i = 0; i < ROUNDS; i++) {
+    crc ^= Checksum::crc32_portable(rom.data);
+  }
+  stopwatch.end();
+  const double crc_portable_ms = stopwatch.duration.count() / ROUNDS;
+
+  stopwatch.start();
+  for (int i = 0; i < ROUNDS; i++) {
+    crc ^= Checksum::crc32(rom.data);
+  }
+  stopwatch.end();
+  const double crc_ms = stopwatch.duration.count() / ROUNDS;
+
+  u8 digest = 0;
+  stopwatch.start();
+  for (int i = 0; i < ROUNDS; i++) {
+    digest ^= Checksum::sha1_portable(rom.data)[0];
+  }
+  stopwatch.end();
+  const double sha_portable_ms = stopwatch.duration.count() / ROUNDS;
+
+  stopwatch.start();
+  for (int i = 0; i < ROUNDS; i++) {
+    digest ^= Checksum::sha1(rom.data)[0];
+  }
+  stopwatch.end();
+  const double sha_ms = stopwatch.duration.count() / ROUNDS;
+
+  fmt::println("[BENCH] 8 MB CRC-32: table {:.2f} ms, {} {:.2f} ms ({:.1f}x) | SHA-1: portable {:.2f} ms, {} {:.2f} ms ({:.1f}x) [{:08x} {:02x}]", crc_portable_ms,
+               Checksum::crc32_accelerated() ? "pclmul" : "table", crc_ms, crc_portable_ms / crc_ms, sha_portable_ms, Checksum::sha1_accelerated() ? "sha-ni" : "portable",
+               sha_ms, sha_portable_ms / sha_ms, crc, digest);
+
+  // a corpus of small ROMs: first scan, then a rescan with nothing changed
+  const std::filesystem::path root = std::filesystem::temp_directory_path() / "umibozu_library_bench";
+  std::filesystem::remove_all(root);
+  File small = make_test_rom({}, 0x19, 0x01);
+  for (int i = 0; i < ROMS; i++) {
+    std::filesystem::create_directories(root / std::to_string(i % 32));
+    small.data[0x150] = i;
+    std::ofstream out(root / std::to_string(i % 32) / fmt::format("rom{}.gb", i), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(small.data.data()), small.data.size());
+  }
+
+  RomLibrary library;
+  const RomLibrary::ScanStats first = library.scan({root.string()});
+  const RomLibrary::ScanStats again = library.scan({root.string()});
+  std::filesystem::remove_all(root);
+
+  fmt::println("[BENCH] library of {} ROMs: first scan {:.1f} ms ({} indexed), rescan {:.1f} ms ({} reused)", ROMS, first.milliseconds, first.indexed, again.milliseconds,
+               again.reused);
+}
+
+TEST_CASE("Patch - repeat loads of a patched 8 MB ROM", "[.benchmark]") {
+  constexpr int LOADS = 20;
+
+  const std::filesystem::path previous = std::filesystem::current_path();
+  const std::filesystem::path root     = std::filesystem::temp_directory_path() / "umibozu_patch_bench";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::filesystem::current_path(root);
+
+  File built = make_test_rom({0x18, 0xFE}, 0x19, 0x08);
+  {
+    std::ofstream out("rom.gb", std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(built.data.data()), built.data.size());
+  }
+  const std::vector<u8> ips = {'P', 'A', 'T', 'C', 'H', 0x10, 0x00, 0x00, 0x00, 0x02, 0xAB, 0xCD, 'E', 'O', 'F'};
+  const File patch{ips, ips.size(), "bench.ips"};
+
+  auto gb = std::make_unique<GB>();
+  Stopwatch stopwatch;
+
+  stopwatch.start();
+  for (int i = 0; i < LOADS; i++) {
+    gb->load_cart(read_file("rom.gb"));
+  }
+  stopwatch.end();
+  const double plain_ms = stopwatch.duration.count() / LOADS;
+
+  stopwatch.start();
+  gb->load_cart(read_file("rom.gb"), patch);
+  stopwatch.end();
+  const double first_ms = stopwatch.duration.count();
+
+  stopwatch.start();
+  for (int i = 0; i < LOADS; i++) {
+    gb->load_cart(read_file("rom.gb"), patch);
+  }
+  stopwatch.end();
+  const double cached_ms = stopwatch.duration.count() / LOADS;
+  gb.reset();
+
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(root);
+  fmt::println("[BENCH] 8 MB ROM load: unpatched {:.2f} ms, patched first load {:.2f} ms, patched from cache {:.2f} ms", plain_ms, first_ms, cached_ms);
+}
+
+TEST_CASE("Archive - compressed 8 MB ROM load vs uncompressed", "[.benchmark]") {
+  constexpr int LOADS = 10;
+
+  const std::filesystem::path previous = std::filesystem::current_path();
+  const std::filesystem::path root     = std::filesystem::temp_directory_path() / "umibozu_archive_bench";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::filesystem::current_path(root);
+
+  // compressible, but not trivially: a short pattern that drifts every 256 bytes, and noise
+  File built = make_test_rom({0x18, 0xFE}, 0x19, 0x08);
+  for (size_t i = 0x150; i < built.data.size(); i++) {
+    built.data[i] = (i % 16 == 0) ? (i * 2654435761u) >> 24 : (i / 256) ^ ((i % 24) * 5);
+  }
+  auto write = [](const char* path, const std::vector<u8>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  };
+  write("rom.gb", built.data);
+  const std::vector<u8> gzip = make_gzip(built.data, "rom.gb");
+  write("rom.gb.gz", gzip);
+  write("rom.zip", make_zip({{"rom.gb", built.data, true}}));
+
+  auto gb = std::make_unique<GB>();
+  Stopwatch stopwatch;
+  auto time_loads = [&](const char* path) {
+    stopwatch.start();
+    for (int i = 0; i < LOADS; i++) {
+      gb->load_cart(read_file(path));
+    }
+    stopwatch.end();
+    return stopwatch.duration.count() / LOADS;
+  };
+
+  const double plain_ms = time_loads("rom.gb");
+  const double gzip_ms  = time_loads("rom.gb.gz");
+  const double zip_ms   = time_loads("rom.zip");
+  gb.reset();
+
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(root);
+  fmt::println("[BENCH] 8 MB ROM load: uncompressed {:.2f} ms, .gz {:.2f} ms, .zip {:.2f} ms ({:.1f} MB/s inflate, {:.1f}% of original size)", plain_ms, gzip_ms, zip_ms,
+               8.0 / ((gzip_ms - plain_ms) / 1000.0), 100.0 * gzip.size() / built.data.size());
+}
+
+TEST_CASE("Tile decode - rows per second", "[.benchmark]") {
+  constexpr int TILES  = 384 * 2;  // both VRAM banks' worth of tiles
+  constexpr int ROUNDS = 2000;
+
+  std::vector<u8> vram(TILES * 16);
+  for (size_t i = 0; i < vram.size(); i++) {
+    vram[i] = (i * 2654435761u) >> 24;
+  }
+  std::vector<TileDecode::Row> rows(TILES * 8);
+
+  // the per-bit loop the PPU used before
+  auto bit_loop = [](const u8* bytes, TileDecode::Row* out) {
+    for (int row = 0; row < 8; row++) {
+      const u8 low  = bytes[row * 2];
+      const u8 high = bytes[row * 2 + 1];
+      for (u8 i = 0; i < 8; i++) {
+        out[row][i] = static_cast<u8>(((high & (1 << i)) != 0 ? 2 : 0) + ((low & (1 << i)) != 0 ? 1 : 0));
+      }
+    }
+  };
+
+  Stopwatch stopwatch;
+  u64 sink    = 0;
+  auto measure = [&](auto decode) {
+    stopwatch.start();
+    for (int round = 0; round < ROUNDS; round++) {
+      for (int t = 0; t < TILES; t++) {
+        decode(vram.data() + t * 16, rows.data() + t * 8);
+      }
+      sink += rows[round % rows.size()][round % 8];
+    }
+    stopwatch.end();
+    return (double)TILES * 8 * ROUNDS / (stopwatch.duration.count() / 1000.0) / 1e6;
+  };
+
+  const double loop     = measure(bit_loop);
+  const double lookup   = measure(TileDecode::tile_portable);
+  const double dispatch = measure(TileDecode::tile);
+
+  fmt::println("[BENCH] tile rows: bit loop {:.0f} M/s, lookup table {:.0f} M/s, {} {:.0f} M/s (sink {})", loop, lookup, TileDecode::accelerated() ? "AVX2" : "portable", dispatch,
+               sink);
+}
+
+TEST_CASE("PPU - frames per second with a busy scene", "[.benchmark]") {
+  constexpr u64 FRAMES = 600;
+
+  File rom        = make_test_rom({0x18, 0xFE});  // JR -2
+  rom.data[0x143] = 0x80;
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(rom);
+  Bus& bus = gb->bus;
+
+  // random tiles and attributes in both banks, 40 sprites spread over the screen,
+  // scrolled BG and a window over the lower half: every path of the renderer runs
+  bus.write8(0xFF40, 0x00);
+  u32 seed = 1;
+  for (u8 bank = 0; bank < 2; bank++) {
+    bus.write8(0xFF4F, bank);
+    for (u16 address = 0x8000; address < 0xA000; address++) {
+      seed = seed * 1664525 + 1013904223;
+      bus.write8(address, seed >> 24);
+    }
+  }
+  bus.write8(0xFF4F, 0);
+  for (u16 i = 0; i < 40; i++) {
+    bus.write8(0xFE00 + i * 4, 16 + (i * 37) % 144);
+    bus.write8(0xFE01 + i * 4, 8 + (i * 53) % 160);
+    bus.write8(0xFE02 + i * 4, i * 7);
+    bus.write8(0xFE03 + i * 4, i * 0x29);
+  }
+  bus.write8(0xFF42, 3);
+  bus.write8(0xFF43, 5);
+  bus.write8(0xFF4A, 72);
+  bus.write8(0xFF4B, 47);
+
+  Stopwatch stopwatch;
+  auto run = [&](u8 lcdc) {
+    bus.write8(0xFF40, lcdc);
+    u64 frames = 0;
+    stopwatch.start();
+    while (frames < FRAMES) {
+      gb->cpu.run_instruction();
+      if (gb->ppu.frame_queued) {
+        gb->ppu.frame_queued = false;
+        frames++;
+      }
+    }
+    stopwatch.end();
+    return FRAMES / (stopwatch.duration.count() / 1000.0);
+  };
+
+  const double bg_only = run(0x91);
+  const double busy    = run(0xE3 | 0x04);  // window, 8x16 sprites
+
+  gb->cart.info.title.clear();
+  fmt::println("[BENCH] PPU: BG only {:.1f} fps, BG + window + sprites {:.1f} fps", bg_only, busy);
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "core/checksum.hpp"
+#include "io.hpp"
+
+// Builds a minimal cartridge image around `program`, which is placed at 0x0150.
+// The entry point at 0x0100 jumps straight to it.
+inline File make_test_rom(const std::vector<u8>& program, u8 mapper_id = 0x00, u8 rom_size_code = 0x00, u8 ram_size_code = 0x00) {
+  std::vector<u8> rom(0x8000 << rom_size_code, 0x00);
+
+  // NOP; JP 0x0150
+  rom[0x100] = 0x00;
+  rom[0x101] = 0xC3;
+  rom[0x102] = 0x50;
+  rom[0x103] = 0x01;
+
+  const std::string title = "UMIBOZU TEST";
+  std::copy(title.begin(), title.end(), rom.begin() + 0x134);
+
+  rom[0x147] = mapper_id;
+  rom[0x148] = rom_size_code;
+  rom[0x149] = ram_size_code;
+
+  std::copy(program.begin(), program.end(), rom.begin() + 0x150);
+
+  u64 size = rom.size();
+  return File{std::move(rom), size, "test.gb"};
+}
+
+// A loop of register-only ALU work that branches on the d-pad state, so
+// instances with different inputs diverge and reconverge every iteration.
+inline std::vector<u8> joypad_alu_loop() {
+  return {
+      0x3E, 0x20,  // LD A,0x20     ; select d-pad
+      0xE0, 0x00,  // LDH (0x00),A
+      // loop: 0x0154
+      0xF0, 0x00,  // LDH A,(0x00)
+      0xE6, 0x0F,  // AND 0x0F
+      0xFE, 0x0F,  // CP 0x0F
+      0x20, 0x0F,  // JR NZ,pressed
+      0x04,        // INC B
+      0x0C,        // INC C
+      0x78,        // LD A,B
+      0x81,        // ADD A,C
+      0xA9,        // XOR C
+      0xB2,        // OR D
+      0x2F,        // CPL
+      0x37,        // SCF
+      0x8B,        // ADC A,E
+      0x3F,        // CCF
+      0x15,        // DEC D
+      0x1D,        // DEC E
+      0x57,        // LD D,A
+      0x18, 0xE9,  // JR loop
+      // pressed: 0x016B
+      0x3C,        // INC A
+      0x90,        // SUB B
+      0x99,        // SBC A,C
+      0xC6, 0x11,  // ADD A,0x11
+      0xD6, 0x05,  // SUB 0x05
+      0xA0,        // AND B
+      0x18, 0xDF,  // JR loop
+  };
+}
+
+// Raw DEFLATE with the fixed Huffman code and greedy matching over a 3-byte hash --
+// far from zlib's ratio, but it exercises literals, lengths and distances.
+inline std::vector<u8> deflate_fixed(std::span<const u8> data) {
+  std::vector<u8> out;
+  u64 bits  = 0;
+  int count = 0;
+
+  auto put = [&](u32 value, int length) {
+    bits |= u64(value) << count;
+    count += length;
+    while (count >= 8) {
+      out.push_back(bits);
+      bits >>= 8;
+      count -= 8;
+    }
+  };
+  // Huffman codes go out most significant bit first
+  auto code = [&](u32 value, int length) {
+    u32 reversed = 0;
+    for (int i = 0; i < length; i++) {
+      reversed |= ((value >> i) & 1) << (length - 1 - i);
+    }
+    put(reversed, length);
+  };
+  auto symbol = [&](int s) {
+    if (s < 144) {
+      code(0x30 + s, 8);
+    } else if (s < 256) {
+      code(0x190 + s - 144, 9);
+    } else if (s < 280) {
+      code(s - 256, 7);
+    } else {
+      code(0xC0 + s - 280, 8);
+    }
+  };
+
+  static constexpr std::array<u16, 29> LENGTH_BASE = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static constexpr std::array<u8, 29> LENGTH_EXTRA = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static constexpr std::array<u16, 30> DISTANCE_BASE = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  static constexpr std::array<u8, 30> DISTANCE_EXTRA = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+  put(1, 1);  // final block
+  put(1, 2);  // fixed Huffman
+
+  std::vector<i64> head(1 << 15, -1);
+  size_t i = 0;
+  while (i < data.size()) {
+    size_t length = 0;
+    size_t distance = 0;
+
+    if (i + 3 <= data.size()) {
+      const u32 hash      = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & 0x7FFF;
+      const i64 candidate = head[hash];
+      head[hash]          = i;
+      if (candidate >= 0 && i - candidate <= 32768) {
+        while (length < 258 && i + length < data.size() && data[candidate + length] == data[i + length]) {
+          length++;
+        }
+        distance = i - candidate;
+      }
+    }
+
+    if (length < 3) {
+      symbol(data[i++]);
+      continue;
+    }
+
+    int l = 28;
+    while (LENGTH_BASE[l] > length) l--;
+    symbol(257 + l);
+    put(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+
+    int d = 29;
+    while (DISTANCE_BASE[d] > distance) d--;
+    code(d, 5);
+    put(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+
+    i += length;
+  }
+
+  symbol(256);
+  put(0, 7);  // flush the last partial byte
+  return out;
+}
+
+inline void put_le(std::vector<u8>& out, u32 value, int width) {
+  for (int i = 0; i < width; i++) {
+    out.push_back(value >> (i * 8));
+  }
+}
+
+// gzip member holding `data`, with an original file name
+inline std::vector<u8> make_gzip(std::span<const u8> data, std::string_view name) {
+  std::vector<u8> out = {0x1F, 0x8B, 0x08, 0x08, 0, 0, 0, 0, 0x00, 0x03};  // deflate, FNAME, unix
+  out.insert(out.end(), name.begin(), name.end());
+  out.push_back(0);
+
+  const std::vector<u8> body = deflate_fixed(data);
+  out.insert(out.end(), body.begin(), body.end());
+  put_le(out, Umibozu::Checksum::crc32(data), 4);
+  put_le(out, data.size(), 4);
+  return out;
+}
+
+struct ZipEntry {
+  std::string name;
+  std::vector<u8> data;
+  bool deflate = true;
+};
+
+// zip archive with the entries in order, each deflated or stored
+inline std::vector<u8> make_zip(const std::vector<ZipEntry>& entries) {
+  std::vector<u8> out;
+  std::vector<u8> directory;
+
+  for (const ZipEntry& entry : entries) {
+    const std::vector<u8> body = entry.deflate ? deflate_fixed(entry.data) : entry.data;
+    const u32 crc              = Umibozu::Checksum::crc32(entry.data);
+    const u32 offset           = out.size();
+
+    put_le(out, 0x04034B50, 4);
+    put_le(out, 20, 2);  // version needed
+    put_le(out, 0, 2);   // flags
+    put_le(out, entry.deflate ? 8 : 0, 2);
+    put_le(out, 0, 4);  // time, date
+    put_le(out, crc, 4);
+    put_le(out, body.size(), 4);
+    put_le(out, entry.data.size(), 4);
+    put_le(out, entry.name.size(), 2);
+    put_le(out, 0, 2);  // extra
+    out.insert(out.end(), entry.name.begin(), entry.name.end());
+    out.insert(out.end(), body.begin(), body.end());
+
+    put_le(directory, 0x02014B50, 4);
+    put_le(directory, 20, 2);  // version made by
+    put_le(directory, 20, 2);  // version needed
+    put_le(directory, 0, 2);
+    put_le(directory, entry.deflate ? 8 : 0, 2);
+    put_le(directory, 0, 4);
+    put_le(directory, crc, 4);
+    put_le(directory, body.size(), 4);
+    put_le(directory, entry.data.size(), 4);
+    put_le(directory, entry.name.size(), 2);
+    put_le(directory, 0, 2);  // extra
+    put_le(directory, 0, 2);  // comment
+    put_le(directory, 0, 2);  // disk
+    put_le(directory, 0, 2);  // internal attributes
+    put_le(directory, 0, 4);  // external attributes
+    put_le(directory, offset, 4);
+    directory.insert(directory.end(), entry.name.begin(), entry.name.end());
+  }
+
+  const u32 directory_offset = out.size();
+  out.insert(out.end(), directory.begin(), directory.end());
+
+  put_le(out, 0x06054B50, 4);
+  put_le(out, 0, 4);  // disk numbers
+  put_le(out, entries.size(), 2);
+  put_le(out, entries.size(), 2);
+  put_le(out, directory.size(), 4);
+  put_le(out, directory_offset, 4);
+  put_le(out, 0, 2);  // comment
+  return out;
+}
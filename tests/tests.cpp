@@ -1,5 +1,21 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
 #include "catch2/catch_test_macros.hpp"
+#include "core/archive.hpp"
+#include "core/checksum.hpp"
 #include "core/gb.hpp"
+#include "core/library.hpp"
+#include "core/lockstep.hpp"
+#include "core/log.hpp"
+#include "core/patch.hpp"
+#include "core/rom_registry.hpp"
+#include "core/tile_decode.hpp"
+#include "test_rom.hpp"
 
 static GB core = {};
 
@@ -11,3 +27,1263 @@ TEST_CASE("Mooneye - MBC1 Bits Bank 2") {
     
 }
 
+
+TEST_CASE("Bus - page table follows mapper and bank registers") {
+  File rom = make_test_rom({}, 0x1A, 0x02, 0x03);  // MBC5+RAM, 8 ROM banks, 4 RAM banks
+  rom.data[0x143] = 0x80;                          // CGB compatible
+  for (u32 bank = 1; bank < 8; bank++) {
+    rom.data[bank * 0x4000] = bank;
+  }
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(rom);
+  Bus& bus = gb->bus;
+
+  REQUIRE(bus.read8(0x4000) == 1);
+  bus.write8(0x2000, 5);
+  REQUIRE(bus.read8(0x4000) == 5);
+  REQUIRE(bus.read8(0x0100) == 0x00);
+
+  // cart RAM is only mapped while enabled
+  REQUIRE(bus.read8(0xA000) == 0xFF);
+  bus.write8(0x0000, 0x0A);
+  bus.write8(0x4000, 1);
+  bus.write8(0xA000, 0x42);
+  bus.write8(0x4000, 0);
+  REQUIRE(bus.read8(0xA000) == 0x00);
+  bus.write8(0x4000, 1);
+  REQUIRE(bus.read8(0xA000) == 0x42);
+  bus.write8(0x0000, 0x00);
+  REQUIRE(bus.read8(0xA000) == 0xFF);
+
+  // VBK / SVBK retarget VRAM, WRAM and its echo
+  bus.write8(0x8000, 0x11);
+  bus.write8(0xFF4F, 1);
+  REQUIRE(bus.read8(0x8000) == 0x00);
+  bus.write8(0xFF4F, 0);
+  REQUIRE(bus.read8(0x8000) == 0x11);
+
+  bus.write8(0xFF70, 3);
+  bus.write8(0xD010, 0x33);
+  REQUIRE(bus.read8(0xF010) == 0x33);
+  bus.write8(0xFF70, 2);
+  REQUIRE(bus.read8(0xD010) != 0x33);
+  REQUIRE(bus.wram_banks[3][0x10] == 0x33);
+}
+
+TEST_CASE("Mapper - MBC2 and HuC1 bank windows") {
+  auto gb = std::make_unique<GB>();
+
+  SECTION("MBC2") {
+    File rom = make_test_rom({}, 0x05, 0x02);
+    for (u32 bank = 1; bank < 8; bank++) {
+      rom.data[bank * 0x4000] = bank;
+    }
+    gb->load_cart(rom);
+    Bus& bus = gb->bus;
+
+    bus.write8(0x2100, 0x03);  // bit 8 set: ROM bank
+    REQUIRE(bus.read8(0x4000) == 3);
+    REQUIRE(gb->mapper.read8(0x4000) == 3);
+    bus.write8(0x2100, 0x00);
+    REQUIRE(bus.read8(0x4000) == 1);
+
+    REQUIRE(bus.read8(0xA000) == 0xFF);
+    bus.write8(0x0000, 0x0A);  // bit 8 clear: RAM enable
+    bus.write8(0xA005, 0x5A);
+    REQUIRE(bus.read8(0xA005) == 0xFA);  // 4-bit RAM, upper nibble reads as 1s
+    REQUIRE(bus.read8(0xA205) == 0xFA);  // mirrored every 512 bytes
+    REQUIRE(bus.read8(0xBE05) == 0xFA);
+  }
+
+  SECTION("HuC1") {
+    gb->load_cart(make_test_rom({}, 0xFF, 0x02, 0x03));
+    Bus& bus = gb->bus;
+
+    bus.write8(0x4000, 0x02);
+    bus.write8(0xA000, 0x77);
+    REQUIRE(gb->cart.ext_ram[0x4000] == 0x77);
+
+    bus.write8(0x0000, 0x0E);  // IR mode
+    REQUIRE(bus.read8(0xA000) == 0xC0);
+    bus.write8(0xA000, 0x01);
+    bus.write8(0x0000, 0x00);
+    REQUIRE(bus.read8(0xA000) == 0x77);
+
+    gb->cart.info.title.clear();  // HuC1 is always battery backed -- skip the .sav on teardown
+  }
+}
+
+TEST_CASE("Bus - OAM DMA copies a page and locks the CPU out for 160 M-cycles") {
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(make_test_rom({}));
+  Bus& bus  = gb->bus;
+  SM83& cpu = gb->cpu;
+
+  for (u16 i = 0; i < 0xA0; i++) {
+    bus.write8(0xC100 + i, i ^ 0x5A);
+  }
+  bus.write8(0xFF80, 0x42);
+
+  cpu.write8(0xFF46, 0xC1);
+  for (u16 i = 0; i < 0xA0; i++) {
+    REQUIRE(bus.oam[i] == (i ^ 0x5A));
+  }
+
+  // 159 more M-cycles of lock-out: only HRAM / IO are visible
+  REQUIRE(cpu.read8(0xC100) == 0xFF);
+  REQUIRE(cpu.read8(0xFF80) == 0x42);
+  cpu.write8(0xC100, 0x00);
+  for (int i = 0; i < 156; i++) {
+    cpu.m_cycle();
+  }
+  REQUIRE(cpu.read8(0xC100) == 0x5A);
+}
+
+TEST_CASE("Bus - IO handler tables follow the system mode") {
+  File rom = make_test_rom({});
+
+  auto dmg = std::make_unique<GB>();
+  dmg->load_cart(rom);
+
+  // CGB-only registers are open bus and ignore writes on DMG
+  dmg->bus.write8(0xFF4F, 1);
+  dmg->bus.write8(0xFF70, 3);
+  REQUIRE(dmg->bus.read8(0xFF4D) == 0xFF);
+  REQUIRE(dmg->bus.read8(0xFF4F) == 0xFF);
+  REQUIRE(dmg->bus.read8(0xFF55) == 0xFF);
+  REQUIRE(dmg->bus.vbk == 0);
+  REQUIRE(dmg->bus.wram == &dmg->bus.wram_banks[1]);
+
+  // plain registers are direct storage, handled ones keep their side effects
+  dmg->bus.write8(0xFF43, 0x12);
+  REQUIRE(dmg->bus.read8(0xFF43) == 0x12);
+  dmg->bus.write8(0xFF06, 0x34);
+  REQUIRE(dmg->bus.timer->modulo == 0x34);
+  dmg->bus.write8(0xFF47, 0b11100100);
+  REQUIRE(dmg->ppu.DMG_BGP[0][3] == dmg->ppu.shade_table[3]);
+  dmg->bus.write8(0xFF30, 0xAB);
+  REQUIRE(dmg->bus.wave_ram[0] == 0xAB);
+
+  rom.data[0x143] = 0x80;
+  auto cgb        = std::make_unique<GB>();
+  cgb->load_cart(rom);
+
+  cgb->bus.write8(0xFF4F, 1);
+  REQUIRE(cgb->bus.read8(0xFF4F) == 0xFF);
+  REQUIRE(cgb->bus.vbk == 1);
+  REQUIRE(cgb->bus.read8(0xFF4D) == 0x00);
+  cgb->bus.write8(0xFF4D, 1);
+  REQUIRE(cgb->bus.read8(0xFF4D) == 0x01);
+
+  cgb->bus.write8(0xFF68, 0x80 | 0x02);  // BCPS: palette 0 colour 1, auto increment
+  cgb->bus.write8(0xFF69, 0x1F);
+  cgb->bus.write8(0xFF69, 0x00);
+  REQUIRE(cgb->ppu.CGB_BGP[0][1] == 0x001F);
+  REQUIRE(cgb->bus.bcps.address == 4);
+}
+
+TEST_CASE("Telemetry - page counters and bank switches roll over at VBlank") {
+  File rom = make_test_rom({0x3E, 0x02, 0xEA, 0x00, 0x20, 0xEA, 0x00, 0x20, 0x18, 0xF6}, 0x19, 0x02);  // LD A,2; LD (2000),A x2; JR -10
+  auto gb  = std::make_unique<GB>();
+  gb->load_cart(rom);
+  MemoryTelemetry& telemetry = gb->bus.telemetry;
+  telemetry.enabled          = true;
+
+  while (telemetry.frames < 2) {
+    gb->cpu.run_instruction();
+  }
+
+  // the loop only ever runs out of page 0x01, and only the first store moves the ROM window
+  REQUIRE(telemetry.last_frame.fetches[0x01] > 0);
+  REQUIRE(telemetry.total.fetches[0x01] >= telemetry.last_frame.fetches[0x01]);
+  REQUIRE(telemetry.total.fetches[0x02] == 0);
+  REQUIRE(telemetry.last_frame.reads[0x01] >= telemetry.last_frame.fetches[0x01]);
+  REQUIRE(telemetry.last_frame.writes[0x20] == telemetry.last_frame.register_writes[1]);
+  REQUIRE(telemetry.last_frame.register_writes[1] > 0);
+  REQUIRE(telemetry.total.bank_switches[1] == 1);
+
+  const std::string csv = telemetry.to_csv();
+  REQUIRE(csv.starts_with("kind,address,reads"));
+  REQUIRE(csv.find("mbc_register,0x2000,") != std::string::npos);
+  REQUIRE(telemetry.to_json().find("\"frames\": 2") != std::string::npos);
+}
+
+TEST_CASE("Cheats - Game Genie overlays ROM pages, GameShark writes at VBlank") {
+  File rom = make_test_rom({0x18, 0xFE}, 0x19, 0x01);  // JR -2, MBC5 with 4 banks
+  rom.data[0x4123]          = 0x00;
+  rom.data[0x4124]          = 0x99;
+  rom.data[0x8000 + 0x0123] = 0x77;  // bank 2
+
+  // 55 at 0x4123 if the bank holds 00 (compare 00 -> BA rotated left twice = EA)
+  std::optional<Cheat> genie = Cheat::parse("551-23B-EEA");
+  REQUIRE(genie);
+  REQUIRE(genie->address == 0x4123);
+  REQUIRE(genie->value == 0x55);
+  REQUIRE(genie->compare == 0x00);
+  REQUIRE_FALSE(Cheat::parse("551-23B-EGA"));
+  REQUIRE_FALSE(Cheat::parse("01420041"));  // GameShark into ROM
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(rom);
+  Bus& bus = gb->bus;
+
+  REQUIRE(gb->cheats.add("551-23B-EEA"));
+  REQUIRE(gb->cheats.add("014200C1", "C100 = 42"));
+  gb->cheats.apply_rom(bus);
+
+  REQUIRE(bus.read8(0x4123) == 0x55);
+  REQUIRE(bus.read8(0x4124) == 0x99);
+  REQUIRE(bus.read_page[0x42] == gb->cart.memory.data() + 0x4200);  // untouched pages stay direct
+
+  bus.write8(0x2000, 2);  // compare fails on bank 2
+  REQUIRE(bus.read8(0x4123) == 0x77);
+  bus.write8(0x2000, 1);
+  REQUIRE(bus.read8(0x4123) == 0x55);
+
+  gb->cheats.cheats[0].enabled = false;
+  gb->cheats.apply_rom(bus);
+  REQUIRE(bus.read8(0x4123) == 0x00);
+
+  REQUIRE(bus.read8(0xC100) == 0x00);
+  while (!gb->ppu.frame_queued) {
+    gb->cpu.run_instruction();
+  }
+  REQUIRE(bus.read8(0xC100) == 0x42);
+
+  // with WRAM traced, the store is stamped dirty but not blamed on a CPU instruction
+  bus.set_provenance(SHADOW_REGION::WRAM, true);
+  bus.write8(0xC100, 0x00);
+  bus.provenance.clear();
+  const u64 since      = bus.dirty_checkpoint();
+  gb->ppu.frame_queued = false;
+  while (!gb->ppu.frame_queued) {
+    gb->cpu.run_instruction();
+  }
+  REQUIRE(bus.read8(0xC100) == 0x42);
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::WRAM, 1, since));
+  REQUIRE(bus.provenance.history(SHADOW_REGION::WRAM, 0x100).empty());
+  bus.set_provenance(SHADOW_REGION::WRAM, false);
+}
+
+TEST_CASE("Provenance - enabled regions record the last writes per byte") {
+  // LD A,n; LD (C123),A; INC A; JR -4 (back to the store)
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(make_test_rom({0x3E, 0x10, 0xEA, 0x23, 0xC1, 0x3C, 0x18, 0xFA}));
+  Bus& bus = gb->bus;
+
+  bus.set_provenance(SHADOW_REGION::WRAM, true);
+  REQUIRE(bus.write_page[0xC1] == nullptr);
+  REQUIRE(bus.write_page[0x80] != nullptr);  // VRAM keeps direct stores
+
+  for (int i = 0; i < 2 + 3 * 6; i++) {
+    gb->cpu.run_instruction();
+  }
+
+  REQUIRE(bus.read8(0xC123) == 0x15);
+  std::vector<WriteRecord> writes = bus.provenance.history(SHADOW_REGION::WRAM, 0x123);
+  REQUIRE(writes.size() == WriteProvenance::DEPTH);
+  REQUIRE(writes[0].pc == 0x0152);
+  REQUIRE(writes[0].bank == 0);
+  REQUIRE(writes[0].cycle > writes[1].cycle);
+  REQUIRE(bus.provenance.history(SHADOW_REGION::WRAM, 0x124).empty());
+
+  bus.set_provenance(SHADOW_REGION::WRAM, false);
+  REQUIRE(bus.write_page[0xC1] == bus.wram_banks[0].data() + 0x100);
+  REQUIRE(bus.provenance.history(SHADOW_REGION::WRAM, 0x123).empty());
+}
+
+TEST_CASE("Dirty - pages changed since a checkpoint") {
+  File rom        = make_test_rom({}, 0x1A, 0x00, 0x03);  // MBC5+RAM, 4 RAM banks
+  rom.data[0x143] = 0x80;
+  auto gb         = std::make_unique<GB>();
+  gb->load_cart(rom);
+  Bus& bus = gb->bus;
+
+  const u64 since = bus.dirty_checkpoint();
+  REQUIRE(bus.write_page[0xC1] == nullptr);  // clean: the first store is stamped on the slow path
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::WRAM, since).empty());
+
+  bus.write8(0xC123, 1);
+  REQUIRE(bus.write_page[0xC1] == bus.wram_banks[0].data() + 0x100);
+  bus.write8(0xC124, 2);
+
+  bus.write8(0xFF70, 3);
+  bus.write8(0xD000, 3);
+  bus.write8(0xFF4F, 1);
+  bus.write8(0x9FFF, 4);
+  bus.write8(0x0000, 0x0A);
+  bus.write8(0x4000, 2);
+  bus.write8(0xA100, 5);
+  bus.write8(0xFE00, 6);
+
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::WRAM, since) == std::vector<u32>{0x01, 0x30});
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::VRAM, since) == std::vector<u32>{0x3F});
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::EXT_RAM, since) == std::vector<u32>{0x41});
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::OAM, since) == std::vector<u32>{0x00});
+
+  // a later checkpoint only sees what came after it
+  const u64 next = bus.dirty_checkpoint();
+  REQUIRE(bus.write_page[0xC1] == nullptr);
+  bus.write8(0xC200, 7);
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::WRAM, next) == std::vector<u32>{0x02});
+  REQUIRE(bus.dirty.changed_since(DIRTY_REGION::WRAM, since).size() == 3);
+  REQUIRE(bus.read8(0xC123) == 1);
+}
+
+TEST_CASE("IO - ROMs are mapped read-only and indexed in place") {
+  File built             = make_test_rom({0x18, 0xFE}, 0x19, 0x01);
+  built.data[0x4000 * 3] = 0x33;
+  const std::string path = (std::filesystem::temp_directory_path() / "umibozu_io_test.gb").string();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(built.data.data()), built.data.size());
+  }
+
+  File rom = read_file(path);
+  std::filesystem::remove(path);  // the mapping outlives the directory entry
+
+  REQUIRE(rom.data.empty());
+#if defined(__unix__) || defined(__APPLE__)
+  REQUIRE(rom.mapping->mapped());
+#endif
+  REQUIRE(rom.bytes().size() == built.data.size());
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(rom);
+  REQUIRE(gb->cart.memory.data() == rom.bytes().data());
+  gb->bus.write8(0x2000, 3);
+  REQUIRE(gb->bus.read8(0x4000) == 0x33);
+
+  REQUIRE_THROWS(read_file(path));
+}
+
+TEST_CASE("ROM registry - instances of a title share one image") {
+  File rom = make_test_rom({0x18, 0xFE}, 0x19, 0x02);
+
+  std::vector<std::unique_ptr<GB>> gbs;
+  for (int i = 0; i < 4; i++) {
+    gbs.push_back(std::make_unique<GB>());
+    gbs.back()->load_cart(rom);
+  }
+
+  for (const auto& gb : gbs) {
+    REQUIRE(gb->cart.image == gbs[0]->cart.image);
+  }
+  REQUIRE(gbs[0]->memory_report().rom_sharers == 4);
+  REQUIRE(gbs[0]->memory_report().per_instance() == sizeof(GB) + PPU::FRAME_BUFFER_BYTES + rom.data.size() / 4);
+
+  File other         = make_test_rom({0x18, 0xFE}, 0x19, 0x02);
+  other.data[0x7FFF] = 0x01;
+  auto different     = std::make_unique<GB>();
+  different->load_cart(other);
+  REQUIRE(different->cart.image != gbs[0]->cart.image);
+  REQUIRE(RomRegistry::key(other.data) == RomRegistry::key(rom.data));  // same header, told apart by the bytes
+
+  RomRegistry::Stats stats = RomRegistry::instance().stats();
+  REQUIRE(stats.images >= 2);
+  REQUIRE(stats.references >= 5);
+
+  // the image goes away with its last cartridge
+  std::weak_ptr<const MappedFile> image = gbs[0]->cart.image;
+  gbs.clear();
+  REQUIRE(image.expired());
+}
+
+TEST_CASE("Cartridge - RAM is sized from the header and saved at that size") {
+  auto gb = std::make_unique<GB>();
+
+  gb->load_cart(make_test_rom({}, 0x19, 0x02));  // MBC5, no RAM
+  REQUIRE(gb->cart.ext_ram.empty());
+  gb->bus.write8(0x0000, 0x0A);
+  REQUIRE(gb->bus.read8(0xA000) == 0xFF);
+
+  gb->load_cart(make_test_rom({}, 0x05, 0x02));  // MBC2
+  REQUIRE(gb->cart.ext_ram.size() == 0x200);
+
+  const std::filesystem::path previous = std::filesystem::current_path();
+  const std::filesystem::path scratch  = std::filesystem::temp_directory_path() / "umibozu_save_test";
+  std::filesystem::create_directories(scratch);
+  std::filesystem::current_path(scratch);
+
+  gb->mapped_saves = true;
+  gb->load_cart(make_test_rom({}, 0x1B, 0x02, 0x03));  // MBC5+RAM+BATTERY, 4 banks
+  REQUIRE(gb->cart.ext_ram.size() == 0x8000);
+  gb->bus.write8(0x0000, 0x0A);
+  gb->bus.write8(0x4000, 0x03);
+  gb->bus.write8(0xA010, 0x42);
+  gb->save_game();
+
+  const std::string save_path = "saves/UMIBOZU TEST.sav";
+  REQUIRE(std::filesystem::file_size(save_path) == 0x8000);
+  REQUIRE(read_file(save_path).bytes()[0x6010] == 0x42);
+
+  // buffered saves read the same file back
+  auto reloaded = std::make_unique<GB>();
+  reloaded->load_cart(make_test_rom({}, 0x1B, 0x02, 0x03));
+  REQUIRE(reloaded->cart.ext_ram_mapping == nullptr);
+  REQUIRE(reloaded->cart.ext_ram[0x6010] == 0x42);
+  reloaded->cart.info.title.clear();
+  gb->cart.info.title.clear();
+
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(scratch);
+}
+
+TEST_CASE("Saves - changed cartridge RAM pages are flushed in the background") {
+  const std::filesystem::path previous = std::filesystem::current_path();
+  const std::filesystem::path scratch  = std::filesystem::temp_directory_path() / "umibozu_flush_test";
+  std::filesystem::create_directories(scratch);
+  std::filesystem::current_path(scratch);
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(make_test_rom({}, 0x1B, 0x02, 0x03));  // MBC5+RAM+BATTERY, 4 banks
+  REQUIRE(gb->saver.running());
+  gb->saver.interval = std::chrono::milliseconds(0);
+
+  Bus& bus = gb->bus;
+  bus.write8(0x0000, 0x0A);
+  bus.write8(0x4000, 0x01);
+  bus.write8(0xA123, 0x5A);
+  bus.write8(0xA124, 0x5B);
+  bus.write8(0xBF00, 0x5C);
+
+  // nothing is written on the emulation thread -- poll only hands the pages over
+  gb->saver.poll(bus);
+  const std::string save_path = "saves/UMIBOZU TEST.sav";
+  for (int i = 0; i < 200 && gb->saver.files_written == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  REQUIRE(gb->saver.files_written == 1);
+  REQUIRE(gb->saver.pages_written == 2);
+  REQUIRE(std::filesystem::file_size(save_path) == 0x8000);
+  REQUIRE(read_file(save_path).bytes()[0x2124] == 0x5B);
+  REQUIRE(read_file(save_path).bytes()[0x3F00] == 0x5C);
+  REQUIRE_FALSE(std::filesystem::exists(save_path + ".tmp"));
+
+  // unchanged RAM is not written again; the exit path waits for the last batch
+  gb->saver.poll(bus);
+  bus.write8(0xA000, 0x11);
+  gb->save_game();
+  REQUIRE(gb->saver.files_written == 2);
+  REQUIRE(read_file(save_path).bytes()[0x2000] == 0x11);
+
+  // a failed write is not lost when nothing else changes: the exit path rewrites the image
+  std::filesystem::create_directories(save_path + ".tmp");  // fopen of the temporary fails
+  bus.write8(0xA001, 0x22);
+  gb->saver.poll(bus);
+  gb->saver.flush(bus);
+  REQUIRE(gb->saver.files_written == 2);
+  REQUIRE(read_file(save_path).bytes()[0x2001] == 0x00);
+
+  std::filesystem::remove(save_path + ".tmp");
+  gb->save_game();
+  REQUIRE(gb->saver.files_written == 3);
+  REQUIRE(read_file(save_path).bytes()[0x2001] == 0x22);
+
+  gb.reset();
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(scratch);
+}
+
+TEST_CASE("RTC - MBC3 clock follows emulated time and persists in the save footer") {
+  constexpr u64 SECOND = RealTimeClock::TICKS_PER_SECOND;
+
+  SECTION("registers") {
+    RealTimeClock rtc;
+    rtc.write(RTC_REGISTER::RTC_HOUR_TIME, 23, 0);
+    rtc.write(RTC_REGISTER::RTC_MINUTE_TIME, 59, 0);
+    rtc.write(RTC_REGISTER::RTC_SECOND_TIME, 58, 0);
+    rtc.write(RTC_REGISTER::RTC_DAY_LOW, 0xFF, 0);
+    rtc.write(RTC_REGISTER::RTC_DAY_HIGH, 0x01, 0);
+
+    // nothing moves until the next latch, which catches up in one step
+    rtc.latch(SECOND * 3 - 1);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_SECOND_TIME) == 0);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_HOUR_TIME) == 0);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_DAY_LOW) == 0x00);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_DAY_HIGH) == 0x80);  // day 511 -> 0 sets the carry
+    rtc.latch(SECOND * 3);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_SECOND_TIME) == 1);
+
+    // halted, the time passing is dropped
+    rtc.write(RTC_REGISTER::RTC_DAY_HIGH, 0x40, SECOND * 3);
+    rtc.latch(SECOND * 100);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_SECOND_TIME) == 1);
+    rtc.write(RTC_REGISTER::RTC_DAY_HIGH, 0x00, SECOND * 100);
+    rtc.latch(SECOND * 102);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_SECOND_TIME) == 3);
+
+    // a value past 59 counts to 63 and wraps without carrying into the minutes
+    rtc.write(RTC_REGISTER::RTC_SECOND_TIME, 62, SECOND * 102);
+    rtc.latch(SECOND * 104);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_SECOND_TIME) == 0);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_MINUTE_TIME) == 0);
+
+    // two days, an hour and a minute in one catch-up
+    rtc.latch(SECOND * (104 + 2 * 86400 + 3600 + 60));
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_DAY_LOW) == 2);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_HOUR_TIME) == 1);
+    REQUIRE(rtc.read(RTC_REGISTER::RTC_MINUTE_TIME) == 1);
+  }
+
+  const std::filesystem::path previous = std::filesystem::current_path();
+  const std::filesystem::path scratch  = std::filesystem::temp_directory_path() / "umibozu_rtc_test";
+  std::filesystem::remove_all(scratch);
+  std::filesystem::create_directories(scratch);
+  std::filesystem::current_path(scratch);
+
+  SECTION("cartridge") {
+    const std::string save_path = "saves/UMIBOZU TEST.sav";
+    auto gb                     = std::make_unique<GB>();
+    gb->rtc_host_time           = false;
+    gb->load_cart(make_test_rom({0x18, 0xFE}, 0x10, 0x02, 0x02));  // MBC3+TIMER+RAM+BATTERY, 8 KiB
+
+    Bus& bus = gb->bus;
+    bus.write8(0x0000, 0x0A);
+    bus.write8(0xA000, 0x77);
+    bus.write8(0x4000, 0x09);  // minutes
+    bus.write8(0xA000, 30);
+
+    // the clock is driven by the emulated time the CPU runs
+    while (gb->timer.clock < SECOND * 2) {
+      gb->cpu.run_instruction();
+    }
+    bus.write8(0x6000, 0x00);
+    bus.write8(0x6000, 0x01);
+    bus.write8(0x4000, 0x08);
+    REQUIRE(bus.read8(0xA000) == 2);
+    bus.write8(0x4000, 0x09);
+    REQUIRE(bus.read8(0xA000) == 30);
+
+    // RAM plus the 48-byte footer: current registers, latched ones, timestamp
+    gb->save_game();
+    REQUIRE(std::filesystem::file_size(save_path) == 0x2000 + 48);
+    const File written = read_file(save_path);
+    std::vector<u8> save(written.bytes().begin(), written.bytes().end());
+    REQUIRE(save[0] == 0x77);
+    REQUIRE(save[0x2000 + 4] == 30);
+    REQUIRE(save[0x2000 + 20] == 2);
+    gb->cart.info.title.clear();
+
+    // an hour later on the host, the clock has moved on by an hour
+    const i64 saved_at = RealTimeClock::unix_now() - 3600;
+    for (int b = 0; b < 8; b++) {
+      save[0x2000 + 40 + b] = (u64)saved_at >> (b * 8);
+    }
+    REQUIRE(write_file_atomic(save_path, save));
+
+    auto reloaded = std::make_unique<GB>();
+    reloaded->load_cart(make_test_rom({0x18, 0xFE}, 0x10, 0x02, 0x02));
+    REQUIRE(reloaded->cart.ext_ram[0] == 0x77);
+    const RTC_INSTANCE& now = reloaded->mapper.get()->rtc.current(reloaded->timer.clock);
+    REQUIRE(now.hour_time == 1);
+    REQUIRE(now.minute_time == 30);
+
+    // switching carts saves the outgoing clock, which resumes from there; mapped saves
+    // keep the footer too
+    reloaded->rtc_host_time = false;
+    reloaded->mapped_saves  = true;
+    reloaded->load_cart(make_test_rom({0x18, 0xFE}, 0x10, 0x02, 0x02));
+    REQUIRE(std::filesystem::file_size(save_path) == 0x2000 + 48);
+    REQUIRE(reloaded->mapper.get()->rtc.current(reloaded->timer.clock).hour_time == 1);
+    REQUIRE(reloaded->mapper.get()->rtc.current(reloaded->timer.clock).minute_time == 30);
+
+    // mapped saves have no writer thread, and switching carts still keeps the clock
+    const u8 seconds = reloaded->mapper.get()->rtc.current(reloaded->timer.clock).second_time;
+    while (reloaded->timer.clock < SECOND) {
+      reloaded->cpu.run_instruction();
+    }
+    reloaded->load_cart(make_test_rom({0x18, 0xFE}, 0x10, 0x02, 0x02));
+    REQUIRE(reloaded->mapper.get()->rtc.current(reloaded->timer.clock).second_time == (seconds + 1) % 60);
+    reloaded->cart.info.title.clear();
+  }
+
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(scratch);
+}
+
+TEST_CASE("Checksum - CRC-32 and SHA-1 kernels agree with the reference") {
+  auto bytes_of = [](std::string_view text) { return std::span<const u8>(reinterpret_cast<const u8*>(text.data()), text.size()); };
+  REQUIRE(Checksum::crc32(bytes_of("123456789")) == 0xCBF43926);
+  REQUIRE(Checksum::to_hex(Checksum::sha1(bytes_of("abc"))) == "a9993e364706816aba3e25717850c26c9cd0d89d");
+  REQUIRE(Checksum::to_hex(Checksum::sha1({})) == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+  // every tail length around the 16- and 64-byte kernel boundaries, and split streams
+  std::vector<u8> data(1100);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (i * 131) ^ (i >> 3);
+  }
+  for (size_t length = 0; length <= data.size(); length += 13) {
+    const std::span<const u8> bytes(data.data(), length);
+    REQUIRE(Checksum::crc32(bytes) == Checksum::crc32_portable(bytes));
+    REQUIRE(Checksum::sha1(bytes) == Checksum::sha1_portable(bytes));
+    REQUIRE(Checksum::crc32(bytes.subspan(length / 3), Checksum::crc32(bytes.first(length / 3))) == Checksum::crc32_portable(bytes));
+  }
+}
+
+TEST_CASE("Library - scans headers, reindexes changed files only and searches") {
+  const std::filesystem::path root = std::filesystem::temp_directory_path() / "umibozu_library_test";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root / "sub");
+
+  auto write_rom = [](const std::filesystem::path& path, File rom, const char* title, u8 cgb_flag) {
+    std::copy_n(title, std::strlen(title), rom.data.begin() + 0x134);
+    std::fill(rom.data.begin() + 0x134 + std::strlen(title), rom.data.begin() + 0x143, 0);
+    rom.data[0x143] = cgb_flag;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(rom.data.data()), rom.data.size());
+  };
+  write_rom(root / "alpha.gb", make_test_rom({}), "ALPHA", 0x00);
+  write_rom(root / "sub" / "beta.GBC", make_test_rom({}, 0x1B, 0x02, 0x03), "BETA QUEST", 0x80);
+  std::ofstream(root / "notes.txt") << "not a rom";
+  std::ofstream(root / "tiny.gb") << "short";
+
+  RomLibrary library;
+  RomLibrary::ScanStats stats = library.scan({root.string()}, 2);
+  REQUIRE(library.entries().size() == 2);
+  REQUIRE(stats.indexed == 3);
+  REQUIRE(stats.removed == 1);  // tiny.gb has no header
+
+  const RomLibrary::Entry& beta = *library.search({.text = "quest"}).at(0);
+  REQUIRE(beta.title == "BETA QUEST");
+  REQUIRE(beta.mapper_id == 0x1B);
+  REQUIRE(beta.ram_banks == 4);
+  REQUIRE(beta.cgb());
+  REQUIRE(beta.crc32 == Checksum::crc32(read_file(beta.path).bytes()));
+  REQUIRE(library.search({.text = "ALPHA.GB"}).size() == 1);
+  REQUIRE(library.search({.cgb = false}).size() == 1);
+  REQUIRE(library.search({.mapper_id = 0x1B}).size() == 1);
+
+  // the index round-trips, and a rescan only reads what changed
+  const std::string index = (root / "library.idx").string();
+  REQUIRE(library.save(index));
+  RomLibrary reloaded;
+  REQUIRE(reloaded.load(index));
+  REQUIRE(reloaded.entries().size() == 2);
+  REQUIRE(reloaded.entries()[1].sha1 == library.entries()[1].sha1);
+
+  std::filesystem::remove(root / "alpha.gb");
+  write_rom(root / "gamma.gb", make_test_rom({}), "GAMMA", 0xC0);
+  stats = reloaded.scan({root.string()});
+  REQUIRE(stats.reused == 1);
+  REQUIRE(stats.indexed == 2);  // gamma.gb, and tiny.gb again
+  REQUIRE(reloaded.search({.text = "alpha"}).empty());
+  REQUIRE(reloaded.search({.cgb = true}).size() == 2);
+
+  // overlapping roots and a symlink reach the same files, which are indexed once
+  std::filesystem::create_symlink(root / "gamma.gb", root / "sub" / "link.gb");
+  stats = reloaded.scan({root.string(), (root / "sub").string()});
+  REQUIRE(reloaded.entries().size() == 2);
+  REQUIRE(stats.reused == 2);
+  REQUIRE(stats.removed == 1);  // tiny.gb, still no header
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Patch - IPS, BPS and UPS apply in one pass and are cached") {
+  File rom                = make_test_rom({0x18, 0xFE});
+  std::vector<u8>& source = rom.data;
+  for (size_t i = 0x150; i < source.size(); i++) {
+    source[i] = i * 7;
+  }
+
+  auto append = [](std::vector<u8>& out, std::string_view text) { out.insert(out.end(), text.begin(), text.end()); };
+  auto number = [](std::vector<u8>& out, u64 value) {
+    while (true) {
+      const u8 x = value & 0x7F;
+      value >>= 7;
+      if (value == 0) {
+        out.push_back(x | 0x80);
+        return;
+      }
+      out.push_back(x);
+      value--;
+    }
+  };
+  auto crc = [](std::vector<u8>& out, u32 value) {
+    for (int i = 0; i < 4; i++) {
+      out.push_back(value >> (i * 8));
+    }
+  };
+
+  SECTION("IPS") {
+    std::vector<u8> ips;
+    append(ips, "PATCH");
+    ips.insert(ips.end(), {0x00, 0x01, 0x50, 0x00, 0x03, 0xAA, 0xBB, 0xCC});  // 3 bytes at 0x150
+    ips.insert(ips.end(), {0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x10, 0x77});  // RLE: 16 x 0x77 at 0x200
+    ips.insert(ips.end(), {0x00, 0x80, 0x00, 0x00, 0x02, 0x12, 0x34});        // past the end: grows
+    append(ips, "EOF");
+
+    const std::vector<u8> patched = Patch::apply(source, ips);
+    REQUIRE(patched.size() == 0x8002);
+    REQUIRE(patched[0x151] == 0xBB);
+    REQUIRE(patched[0x20F] == 0x77);
+    REQUIRE(patched[0x210] == source[0x210]);
+    REQUIRE(patched[0x8001] == 0x34);
+  }
+
+  // target: four bytes changed at 0x100 and those four appended at the end
+  std::vector<u8> target(source);
+  const std::vector<u8> changed = {1, 2, 3, 4};
+  std::copy(changed.begin(), changed.end(), target.begin() + 0x100);
+  target.insert(target.end(), changed.begin(), changed.end());
+
+  SECTION("BPS") {
+    std::vector<u8> bps;
+    append(bps, "BPS1");
+    number(bps, source.size());
+    number(bps, target.size());
+    number(bps, 0);
+    number(bps, ((0x100 - 1) << 2) | 0);  // SourceRead
+    number(bps, ((4 - 1) << 2) | 1);      // TargetRead
+    bps.insert(bps.end(), changed.begin(), changed.end());
+    number(bps, ((source.size() - 0x104 - 1) << 2) | 2);  // SourceCopy from +0x104
+    number(bps, 0x104 << 1);
+    number(bps, ((4 - 1) << 2) | 3);  // TargetCopy from +0x100
+    number(bps, 0x100 << 1);
+    crc(bps, Checksum::crc32(source));
+    crc(bps, Checksum::crc32(target));
+    crc(bps, Checksum::crc32(bps));
+
+    REQUIRE(Patch::detect(bps) == Patch::FORMAT::BPS);
+    REQUIRE(Patch::apply(source, bps) == target);
+
+    std::vector<u8> other(source);
+    other[0x4000] ^= 1;
+    REQUIRE_THROWS(Patch::apply(other, bps));  // made for a different ROM
+    bps[10] ^= 1;
+    REQUIRE_THROWS(Patch::apply(source, bps));  // damaged
+  }
+
+  SECTION("UPS") {
+    std::vector<u8> ups;
+    append(ups, "UPS1");
+    number(ups, source.size());
+    number(ups, target.size());
+
+    auto at     = [](const std::vector<u8>& v, size_t i) -> u8 { return i < v.size() ? v[i] : 0; };
+    size_t last = 0;
+    for (size_t i = 0; i < target.size(); i++) {
+      if ((at(source, i) ^ at(target, i)) == 0) continue;
+      number(ups, i - last);
+      for (; i < target.size() && (at(source, i) ^ at(target, i)) != 0; i++) {
+        ups.push_back(at(source, i) ^ at(target, i));
+      }
+      ups.push_back(0);
+      last = i + 1;
+    }
+    crc(ups, Checksum::crc32(source));
+    crc(ups, Checksum::crc32(target));
+    crc(ups, Checksum::crc32(ups));
+
+    REQUIRE(Patch::apply(source, ups) == target);
+
+    // the patched image is cached by content and mapped on the next load
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "umibozu_patch_test";
+    std::filesystem::remove_all(root);
+    const File patch{ups, ups.size(), "test.ups"};
+
+    const File first = Patch::apply_cached(rom, patch, root.string());
+    REQUIRE(first.mapping == nullptr);
+    const File again = Patch::apply_cached(rom, patch, root.string());
+    REQUIRE(again.mapping != nullptr);
+    REQUIRE(std::equal(again.bytes().begin(), again.bytes().end(), target.begin(), target.end()));
+
+    const std::filesystem::path previous = std::filesystem::current_path();
+    std::filesystem::current_path(root);
+    auto gb = std::make_unique<GB>();
+    gb->load_cart(rom, patch);
+    REQUIRE(gb->cart.patch_path == "test.ups");
+    REQUIRE(gb->bus.read8(0x0102) == 3);
+    REQUIRE(std::filesystem::exists("cache/patched"));
+
+    std::filesystem::current_path(previous);
+    std::filesystem::remove_all(root);
+  }
+}
+
+TEST_CASE("Archive - gzip and zip ROMs inflate into the ROM buffer") {
+  File rom                = make_test_rom({0x18, 0xFE});
+  std::vector<u8>& source = rom.data;
+  for (size_t i = 0x150; i < source.size(); i++) {
+    source[i] = (i / 256) ^ ((i % 24) * 5);  // repeats within each 256-byte block, which drifts
+  }
+
+  auto write = [](const std::filesystem::path& path, const std::vector<u8>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  };
+
+  SECTION("dynamic Huffman blocks") {
+    // zlib -9 output for 600 bytes over a skewed five-letter alphabet
+    const std::vector<u8> deflated = {
+        0x4D, 0x91, 0x89, 0x15, 0xC3, 0x30, 0x08, 0x43, 0x67, 0x43, 0x62, 0xFF, 0x99, 0x6A, 0x7D, 0xD1, 0xBE, 0xA6, 0x49, 0x83, 0x1D, 0xAC, 0x8B, 0x19, 0xAD, 0xF4, 0x9E,
+        0x99, 0x91, 0x2D, 0x0F, 0xD5, 0xAC, 0x76, 0xFC, 0xAA, 0xF7, 0x6C, 0x36, 0xA4, 0x2E, 0xC6, 0x7E, 0x2D, 0x4A, 0x8B, 0xAC, 0x54, 0x7C, 0xD8, 0x74, 0x88, 0x0E, 0x05,
+        0x31, 0x78, 0x6F, 0x1D, 0x3C, 0x73, 0x2F, 0xFD, 0x02, 0x62, 0x0C, 0x5E, 0x0E, 0x4E, 0x5A, 0xFE, 0x38, 0x72, 0xFB, 0x8F, 0x23, 0x78, 0xEF, 0x28, 0xC2, 0xDE, 0x6F,
+        0x79, 0x85, 0x2F, 0x9B, 0x6A, 0xC3, 0x54, 0x75, 0x14, 0xB3, 0x80, 0xAE, 0xD5, 0x57, 0x5F, 0x18, 0x59, 0x56, 0x9F, 0xC1, 0x7B, 0xD7, 0x9E, 0xDF, 0x20, 0x4B, 0x28,
+        0x5D, 0xA0, 0x7A, 0xEE, 0xE7, 0x37, 0xE7, 0x9B, 0xC7, 0x39, 0x83, 0x2A, 0x47, 0xEA, 0x17, 0xAF, 0x53, 0x80, 0xDA, 0xCA, 0x96, 0x0F, 0x02, 0xA5, 0x69, 0x45, 0xBC,
+        0x8F, 0x12, 0xBC, 0xF3, 0xDB, 0x3C, 0x09, 0xDE, 0x99, 0x46, 0xFE, 0x0B, 0x56, 0xBF, 0x19, 0x50, 0xB6, 0x84, 0xBE, 0x70, 0xE4, 0xF3, 0xFA, 0xEB, 0x17, 0x26, 0x06,
+        0x20, 0x22, 0xC2, 0xDD, 0x4D, 0xEC, 0x06, 0xE5, 0x4D, 0x7E, 0xD8, 0x49, 0xD7, 0xDE, 0x10, 0x9A, 0xBD, 0x75, 0x61, 0xAA, 0x09, 0x30, 0x88, 0x4E, 0xE1, 0xE7, 0x15,
+        0x62, 0x4F, 0x87, 0x50, 0x55, 0x94, 0xA7, 0x9F, 0x84, 0x2F, 0x90, 0x57, 0x7F, 0x00,
+    };
+    std::vector<u8> expected;
+    for (int i = 0; i < 600; i++) {
+      expected.push_back("AAAABBBCCD"[(i * i ^ (i >> 3)) % 10]);
+    }
+
+    REQUIRE(Archive::inflate(deflated) == expected);
+    REQUIRE(Checksum::crc32(expected) == 0xDAA0F9C9);
+    REQUIRE_THROWS(Archive::inflate(std::span(deflated).first(100)));  // truncated
+  }
+
+  SECTION("stored and fixed Huffman blocks") {
+    const std::vector<u8> fixed = deflate_fixed(source);
+    REQUIRE(fixed.size() < source.size() / 4);
+    REQUIRE(Archive::inflate(fixed) == source);
+    REQUIRE(Archive::inflate(fixed, source.size()) == source);
+    REQUIRE_THROWS(Archive::inflate(fixed, source.size() - 1));  // more than the archive declared
+
+    // two stored blocks, the second starting mid-bit-buffer
+    std::vector<u8> stored = {0x00, 0x05, 0x00, 0xFA, 0xFF, 'h', 'e', 'l', 'l', 'o', 0x01, 0x01, 0x00, 0xFE, 0xFF, '!'};
+    const std::vector<u8> text = {'h', 'e', 'l', 'l', 'o', '!'};
+    REQUIRE(Archive::inflate(stored) == text);
+    stored[3] = 0x00;
+    REQUIRE_THROWS(Archive::inflate(stored));  // NLEN doesn't complement LEN
+  }
+
+  const std::filesystem::path previous = std::filesystem::current_path();
+  const std::filesystem::path root     = std::filesystem::temp_directory_path() / "umibozu_archive_test";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::filesystem::current_path(root);
+
+  SECTION("gzip") {
+    std::vector<u8> gzip = make_gzip(source, "test.gb");
+    write("test.gb.gz", gzip);
+
+    const File file = read_file("test.gb.gz");
+    REQUIRE(file.file_size == source.size());
+    REQUIRE(std::equal(file.bytes().begin(), file.bytes().end(), source.begin(), source.end()));
+
+    auto gb = std::make_unique<GB>();
+    gb->load_cart(file);
+    REQUIRE(gb->cart.info.title == "UMIBOZU TEST");
+    gb->cart.info.title.clear();
+
+    // a plain ROM that happens to start with the gzip magic is not an archive
+    REQUIRE(Archive::detect("test.gb", gzip) == Archive::FORMAT::NONE);
+
+    gzip[gzip.size() - 8] ^= 1;
+    REQUIRE_THROWS(Archive::extract_rom(gzip, Archive::FORMAT::GZIP));
+
+    // a declared size below what the stream inflates to stops the decoder, not the CRC check
+    gzip[gzip.size() - 8] ^= 1;
+    gzip[gzip.size() - 3] -= 1;
+    REQUIRE_THROWS_WITH(Archive::extract_rom(gzip, Archive::FORMAT::GZIP), "archive: inflates past the declared size");
+    gzip[gzip.size() - 1] = 0x10;
+    REQUIRE_THROWS_WITH(Archive::extract_rom(gzip, Archive::FORMAT::GZIP), "archive: gzip declares more than any ROM holds");
+  }
+
+  SECTION("zip") {
+    const std::vector<u8> readme = {'r', 'e', 'a', 'd', ' ', 'm', 'e'};
+    std::vector<u8> zip          = make_zip({{"README.txt", readme, false}, {"Game/Test.GBC", source, true}});
+    write("test.zip", zip);
+
+    std::string entry;
+    const std::vector<u8> extracted = Archive::extract_rom(zip, Archive::detect("test.zip", zip), &entry);
+    REQUIRE(entry == "Game/Test.GBC");
+    REQUIRE(extracted == source);
+
+    const File file = read_file("test.zip");
+    REQUIRE(std::equal(file.bytes().begin(), file.bytes().end(), source.begin(), source.end()));
+
+    // stored ROM entries load too; archives without one are rejected
+    REQUIRE(Archive::extract_rom(make_zip({{"rom.gb", source, false}}), Archive::FORMAT::ZIP) == source);
+    REQUIRE_THROWS(Archive::extract_rom(make_zip({{"README.txt", readme, true}}), Archive::FORMAT::ZIP));
+  }
+
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Tile decode - lookup and AVX2 kernels match the bit loop") {
+  auto reference = [](u8 high, u8 low) {
+    TileDecode::Row row;
+    for (int i = 0; i < 8; i++) {
+      row[i] = ((high >> i) & 1) * 2 + ((low >> i) & 1);
+    }
+    return row;
+  };
+
+  int mismatches = 0;
+  for (u32 high = 0; high < 0x100; high++) {
+    for (u32 low = 0; low < 0x100; low++) {
+      mismatches += TileDecode::row(high, low) != reference(high, low);
+    }
+  }
+  REQUIRE(mismatches == 0);
+
+  std::array<u8, 16> bytes;
+  for (int t = 0; t < 512; t++) {
+    for (int i = 0; i < 16; i++) {
+      bytes[i] = (t * 37 + i * 101) ^ (t >> 2) * 13;
+    }
+    std::array<TileDecode::Row, 8> rows;
+    std::array<TileDecode::Row, 8> portable;
+    TileDecode::tile(bytes.data(), rows.data());
+    TileDecode::tile_portable(bytes.data(), portable.data());
+    REQUIRE(rows == portable);
+    REQUIRE(rows[5] == reference(bytes[11], bytes[10]));
+  }
+}
+
+TEST_CASE("Bus - GDMA and HDMA copy 16-byte blocks and stall the CPU") {
+  File rom        = make_test_rom({0x18, 0xFE});  // JR -2
+  rom.data[0x143] = 0x80;
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(rom);
+  Bus& bus = gb->bus;
+
+  for (u16 i = 0; i < 0x40; i++) {
+    bus.write8(0xC000 + i, i + 1);
+  }
+
+  auto start_dma = [&](u16 src, u16 dst, u8 hdma5) {
+    bus.write8(0xFF51, src >> 8);
+    bus.write8(0xFF52, src & 0xFF);
+    bus.write8(0xFF53, dst >> 8);
+    bus.write8(0xFF54, dst & 0xFF);
+    bus.write8(0xFF55, hdma5);
+  };
+
+  SECTION("GDMA") {
+    start_dma(0xC000, 0x8100, 0x01);  // 2 blocks
+    REQUIRE(bus.io[HDMA5] == 0xFF);
+    REQUIRE(bus.dma_stall_cycles == 16);
+    for (u16 i = 0; i < 0x20; i++) {
+      REQUIRE(bus.vram_banks[0][0x100 + i] == i + 1);
+    }
+    REQUIRE(bus.vram_banks[0][0x120] == 0);
+
+    gb->cpu.run_instruction();
+    REQUIRE(bus.dma_stall_cycles == 0);
+  }
+
+  SECTION("HDMA") {
+    gb->bus.write8(0xFF40, 0x91);
+    start_dma(0xC000, 0x8000, 0x83);  // 4 blocks, one per HBlank
+
+    u8 last_ly    = bus.io[LY];
+    int scanlines = 0;
+    while (bus.io[HDMA5] != 0xFF && scanlines < 200) {
+      gb->cpu.run_instruction();
+      if (bus.io[LY] != last_ly) {
+        last_ly = bus.io[LY];
+        scanlines++;
+      }
+    }
+
+    REQUIRE(bus.io[HDMA5] == 0xFF);
+    REQUIRE(scanlines >= 3);
+    for (u16 i = 0; i < 0x40; i++) {
+      REQUIRE(bus.vram_banks[0][i] == i + 1);
+    }
+  }
+}
+
+TEST_CASE("Tile cache - VRAM writes by CPU, GDMA and HDMA invalidate decoded tiles") {
+  File rom        = make_test_rom({0x18, 0xFE});  // JR -2
+  rom.data[0x143] = 0x80;
+
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(rom);
+  Bus& bus                  = gb->bus;
+  Umibozu::TileCache& cache = gb->ppu.tiles;
+
+  // the cached row must always be what VRAM holds right now, in all four orientations
+  auto matches_vram = [&](u8 bank, u16 tile, u8 y) {
+    const u8* bytes                    = bus.vram_banks[bank].data() + tile * 16;
+    const Umibozu::TileDecode::Row row = Umibozu::TileDecode::row(bytes[y * 2 + 1], bytes[y * 2]);
+    const Umibozu::TileDecode::Row up  = Umibozu::TileDecode::row(bytes[(7 - y) * 2 + 1], bytes[(7 - y) * 2]);
+
+    Umibozu::TileDecode::Row mirrored;
+    std::reverse_copy(row.begin(), row.end(), mirrored.begin());
+
+    cache.sync(bus);
+    return cache.row(bus, bank, tile, y, false, false) == row && cache.row(bus, bank, tile, y, true, false) == mirrored &&
+           cache.row(bus, bank, tile, 7 - y, false, true) == row && cache.row(bus, bank, tile, y, false, true) == up;
+  };
+
+  for (u16 i = 0; i < 0x100; i++) {
+    bus.write8(0xC000 + i, (i * 37) ^ 0x5A);
+  }
+
+  // CPU stores, to a tile that is already cached
+  REQUIRE(matches_vram(0, 0x10, 3));
+  bus.write8(0x8106, 0xF0);
+  bus.write8(0x8107, 0x3C);
+  REQUIRE(matches_vram(0, 0x10, 3));
+
+  // GDMA into bank 1, across a page
+  bus.write8(0xFF4F, 1);
+  REQUIRE(matches_vram(1, 0x7F, 7));
+  REQUIRE(matches_vram(1, 0x80, 0));
+  bus.write8(0xFF51, 0xC0);
+  bus.write8(0xFF52, 0x00);
+  bus.write8(0xFF53, 0x87);
+  bus.write8(0xFF54, 0xF0);
+  bus.write8(0xFF55, 0x01);
+  REQUIRE(matches_vram(1, 0x7F, 7));
+  REQUIRE(matches_vram(1, 0x80, 0));
+  bus.write8(0xFF4F, 0);
+
+  // HDMA, one block per HBlank while the PPU renders through the cache
+  REQUIRE(matches_vram(0, 0x20, 5));
+  bus.write8(0xFF40, 0x91);
+  bus.write8(0xFF51, 0xC0);
+  bus.write8(0xFF52, 0x80);
+  bus.write8(0xFF53, 0x82);
+  bus.write8(0xFF54, 0x00);
+  bus.write8(0xFF55, 0x83);
+  while (bus.io[HDMA5] != 0xFF) {
+    gb->cpu.run_instruction();
+  }
+  REQUIRE(bus.vram_banks[0][0x200] == bus.read8(0xC080));
+  for (u16 tile = 0x20; tile < 0x24; tile++) {
+    REQUIRE(matches_vram(0, tile, 5));
+  }
+
+  // a reset clears VRAM, so nothing decoded before it may survive
+  bus.reset();
+  REQUIRE(matches_vram(0, 0x10, 3));
+}
+
+TEST_CASE("PPU - scanline compositor draws BG, window and sprites into 160 pixels") {
+  auto gb = std::make_unique<GB>();
+  gb->load_cart(make_test_rom({0x18, 0xFE}));  // JR -2
+  Bus& bus = gb->bus;
+  PPU& ppu = gb->ppu;
+
+  bus.write8(0xFF40, 0x00);
+
+  // one tile row per tile, as "leftmost pixel first" colour indices
+  auto set_tile = [&](u16 tile, u8 y, const char* pixels) {
+    u8 low  = 0;
+    u8 high = 0;
+    for (u8 x = 0; x < 8; x++) {
+      low |= ((pixels[x] - '0') & 1) << (7 - x);
+      high |= ((pixels[x] - '0') >> 1) << (7 - x);
+    }
+    bus.write8(0x8000 + tile * 16 + y * 2, low);
+    bus.write8(0x8000 + tile * 16 + y * 2 + 1, high);
+  };
+  for (u8 y = 0; y < 8; y++) {
+    set_tile(1, y, "31111111");
+    set_tile(2, y, "22222222");
+    set_tile(3, y, "33000000");
+  }
+  set_tile(5, 7, "33000000");
+
+  for (u16 i = 0; i < 0x400; i++) {
+    bus.write8(0x9800 + i, 1);  // BG
+    bus.write8(0x9C00 + i, 2);  // window
+  }
+
+  // y, x, tile, flags -- all on lines 0-7 except the 8x16 one
+  const u8 sprites[][4] = {
+      {16, 28, 3, 0x00},   // plain: 20-21
+      {16, 158, 3, 0x20},  // X flip over the window: 156-157
+      {16, 48, 3, 0x80},   // behind BG colours 1-3: hidden at 40-41
+      {16, 68, 3, 0x10},   // OBP1: 60-61
+      {16, 4, 3, 0x20},    // X flip, half off the left edge: 2-3
+      {20, 88, 4, 0x40},   // Y flip: in 8x16 mode line 4 is tile 5's last row, 80-81
+  };
+  for (u16 i = 0; i < 40; i++) {
+    for (u8 b = 0; b < 4; b++) {
+      bus.write8(0xFE00 + i * 4 + b, i < std::size(sprites) ? sprites[i][b] : 0);
+    }
+  }
+
+  bus.write8(0xFF47, 0xE4);
+  bus.write8(0xFF48, 0xE4);
+  bus.write8(0xFF49, 0x1B);
+  bus.write8(0xFF43, 3);    // SCX
+  bus.write8(0xFF4A, 0);    // WY
+  bus.write8(0xFF4B, 107);  // WX: the window starts at x = 100
+
+  // every pixel of the frame is drawn, there is no clearing pass to rely on
+  std::fill_n(ppu.db.write_buf, SCREEN_WIDTH * SCREEN_HEIGHT, 0x1234);
+  std::fill_n(ppu.db.disp_buf, SCREEN_WIDTH * SCREEN_HEIGHT, 0x1234);
+
+  auto render = [&](u8 lcdc) {
+    bus.write8(0xFF40, lcdc);
+    const u64 target = ppu.frames + 2;
+    while (ppu.frames < target) {
+      gb->cpu.run_instruction();
+    }
+    return ppu.db.disp_buf + 4 * SCREEN_WIDTH;
+  };
+
+  const u16* line = render(0xF3);  // LCD, window map 0x9C00, window, 0x8000 tiles, OBJ, BG
+  REQUIRE(line[4] == LIGHTGREY);
+  REQUIRE(line[5] == BLACK);  // SCX 3: the leftmost column of the second tile
+  REQUIRE(line[99] == LIGHTGREY);
+  REQUIRE(line[100] == DARKGREY);
+  REQUIRE(line[159] == DARKGREY);
+  REQUIRE(line[20] == BLACK);
+  REQUIRE(line[22] == LIGHTGREY);
+  REQUIRE(line[155] == DARKGREY);
+  REQUIRE(line[156] == BLACK);
+  REQUIRE(line[40] == LIGHTGREY);
+  REQUIRE(line[60] == WHITE);
+  REQUIRE(line[1] == LIGHTGREY);
+  REQUIRE(line[2] == BLACK);
+  REQUIRE(line[80] == LIGHTGREY);
+  REQUIRE(std::none_of(ppu.db.disp_buf, ppu.db.disp_buf + SCREEN_WIDTH * SCREEN_HEIGHT, [](u16 pixel) { return pixel == 0x1234; }));
+
+  line = render(0xF7);  // 8x16 sprites
+  REQUIRE(line[80] == BLACK);
+  REQUIRE(line[81] == BLACK);
+  REQUIRE(line[82] == LIGHTGREY);
+
+  gb->cart.info.title.clear();
+}
+
+TEST_CASE("PPU - frames render into caller memory with any stride") {
+  constexpr size_t STRIDE = 200;
+
+  File rom        = make_test_rom({0x18, 0xFE});  // JR -2
+  rom.data[0x143] = 0x80;
+
+  // the same random scene in two instances, one drawing into its own buffers
+  std::array<std::unique_ptr<GB>, 2> gbs;
+  for (auto& gb : gbs) {
+    gb = std::make_unique<GB>();
+    gb->load_cart(rom);
+    gb->bus.write8(0xFF40, 0x00);
+
+    u32 seed = 7;
+    for (u16 address = 0x8000; address < 0xA000; address++) {
+      seed = seed * 1664525 + 1013904223;
+      gb->bus.write8(address, seed >> 24);
+    }
+    gb->bus.write8(0xFF68, 0x80);
+    for (u8 i = 0; i < 0x40; i++) {
+      gb->bus.write8(0xFF69, i * 13);
+    }
+    gb->bus.write8(0xFF40, 0x91);
+  }
+
+  std::vector<u16> texture(STRIDE * SCREEN_HEIGHT, 0x1234);
+  gbs[1]->ppu.set_output(texture.data(), STRIDE);
+
+  for (auto& gb : gbs) {
+    const u64 target = gb->ppu.frames + 2;
+    while (gb->ppu.frames < target) {
+      gb->cpu.run_instruction();
+    }
+  }
+
+  size_t mismatches = 0;
+  size_t padding    = 0;
+  for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+    const u16* line = texture.data() + y * STRIDE;
+    mismatches += !std::equal(line, line + SCREEN_WIDTH, gbs[0]->ppu.db.disp_buf + y * SCREEN_WIDTH);
+    padding += std::count(line + SCREEN_WIDTH, line + STRIDE, 0x1234);
+  }
+  REQUIRE(mismatches == 0);
+  REQUIRE(padding == (STRIDE - SCREEN_WIDTH) * SCREEN_HEIGHT);
+  REQUIRE(gbs[1]->ppu.output_line(3) == texture.data() + 3 * STRIDE);
+
+  // detached, the PPU goes back to its own buffers
+  gbs[1]->ppu.set_output(nullptr, 0);
+  REQUIRE(gbs[1]->ppu.output_line(3) == gbs[1]->ppu.db.write_buf + 3 * SCREEN_WIDTH);
+
+  // with the LCD off no line is drawn: the memory comes back blank, not as it was handed over
+  std::fill(texture.begin(), texture.end(), 0x1234);
+  gbs[1]->bus.write8(0xFF40, 0x00);
+  gbs[1]->ppu.set_output(texture.data(), STRIDE);
+  for (int i = 0; i < 20000; i++) {
+    gbs[1]->cpu.run_instruction();
+  }
+  gbs[1]->ppu.set_output(nullptr, 0);
+  REQUIRE(std::count(texture.begin(), texture.end(), WHITE) == SCREEN_WIDTH * SCREEN_HEIGHT);
+
+  for (auto& gb : gbs) {
+    gb->cart.info.title.clear();
+  }
+}
+
+TEST_CASE("Log - disabled levels compile out") {
+  int evaluated = 0;
+  auto argument = [&] { return ++evaluated; };
+
+  LOG_TRACE(PPU, "trace from tests: {}", argument());
+  Log::flush();
+
+  // arguments are only evaluated when the level is compiled in
+  REQUIRE(evaluated == (Log::enabled<LOG_CATEGORY::PPU, LOG_LEVEL::TRACE> ? 1 : 0));
+}
+
+TEST_CASE("Lockstep - lanes match independent scalar instances") {
+  constexpr size_t LANES = 34;  // spans two vector blocks
+  constexpr size_t STEPS = 50000;
+
+  const File rom = make_test_rom(joypad_alu_loop());
+
+  for (bool use_avx2 : {true, false}) {
+    std::vector<std::unique_ptr<GB>> lockstep_gbs, scalar_gbs;
+    std::vector<GB*> lanes;
+
+    for (size_t i = 0; i < LANES; i++) {
+      for (auto* set : {&lockstep_gbs, &scalar_gbs}) {
+        auto& gb = set->emplace_back(std::make_unique<GB>());
+        gb->load_cart(rom);
+        gb->bus.joypad.DOWN       = (i % 3 == 0) ? 0 : 1;
+        gb->bus.telemetry.enabled = true;
+
+        // bank 0 differs on this lane: INC C at 0x015D becomes DEC C
+        if (i == 1) {
+          REQUIRE(gb->cheats.add("0D1-5DF"));
+          gb->cheats.apply_rom(gb->bus);
+        }
+      }
+      lanes.push_back(lockstep_gbs.back().get());
+    }
+
+    Lockstep engine(lanes);
+    engine.use_avx2 = engine.use_avx2 && use_avx2;
+
+    for (size_t step = 0; step < STEPS; step++) {
+      engine.step();
+    }
+    engine.sync_to_lanes();
+
+    for (auto& gb : scalar_gbs) {
+      for (size_t step = 0; step < STEPS; step++) {
+        gb->cpu.run_instruction();
+      }
+    }
+
+    REQUIRE(engine.vector_steps > 0);
+
+    for (size_t i = 0; i < LANES; i++) {
+      const GB& a = *lockstep_gbs[i];
+      const GB& b = *scalar_gbs[i];
+
+      REQUIRE(a.cpu.AF == b.cpu.AF);
+      REQUIRE(a.cpu.BC == b.cpu.BC);
+      REQUIRE(a.cpu.DE == b.cpu.DE);
+      REQUIRE(a.cpu.HL == b.cpu.HL);
+      REQUIRE(a.cpu.SP == b.cpu.SP);
+      REQUIRE(a.cpu.PC == b.cpu.PC);
+      REQUIRE(a.bus.io[LY] == b.bus.io[LY]);
+      REQUIRE(a.ppu.dots == b.ppu.dots);
+      REQUIRE(a.timer.get_full_div() == b.timer.get_full_div());
+      REQUIRE(a.bus.telemetry.total.fetches == b.bus.telemetry.total.fetches);
+      REQUIRE(a.bus.telemetry.frame.fetches == b.bus.telemetry.frame.fetches);
+    }
+  }
+}